@@ -0,0 +1,512 @@
+// Набор замеров производительности (make bench).
+//
+// Для каждой точки входа (и для каждого набора параметров из перебора) измеряется время одного
+// вызова: число вызовов подбирается так, чтобы замер длился не меньше --min-time секунд,
+// замер повторяется --repeats раз, в результат идут медиана и минимум.
+// Для функций, обрабатывающих массив за вызов, "вызов" - один обработанный элемент
+// (items_per_call = 1), для остальных items_per_call - сколько значений обрабатывает один вызов.
+//
+// Результаты - JSON в stdout (или в файл --output), по объекту на строку внутри массива results,
+// ход замеров - в stderr. С --baseline FILE каждый результат сравнивается с прошлым запуском
+// (файл, записанный этой же программой); изменение медианы больше --threshold
+// в худшую сторону - регрессия, тогда код завершения 1.
+//
+//   make bench BENCH_ARGS="--output data/bench_baseline.json"
+//   make bench BENCH_ARGS="--baseline data/bench_baseline.json --filter pdf_main"
+
+#include "distributions.h"
+#include "parallel.h"
+#include "plot_io.h"
+
+#include <errno.h>
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+#define BENCH_POINTS 1024            // Точек x для замеров плотности (перебираются по кругу)
+#define BENCH_BLOCK 4096             // Значений за вызов для векторных функций
+#define BENCH_MAX_RESULTS 256
+#define BENCH_MAX_REPEATS 101
+
+// Результат вызова складывается сюда, чтобы компилятор не выбросил сами вызовы
+static volatile double bench_sink;
+
+typedef struct {
+    double mu, lambda, v;
+    MixtureParams mixture;
+    double *xs;                      // BENCH_POINTS точек
+    double *sample;                  // Выборка
+    int sample_size;
+    double *out;                     // Буфер результатов (BENCH_BLOCK значений)
+    EmpiricalHistogram *hist;
+    PlotData *plot;
+} BenchContext;
+
+// Выполняет iterations вызовов
+typedef void (*BenchFunction)(BenchContext *ctx, long long iterations);
+
+typedef struct {
+    char name[48];
+    char params[64];
+    double items_per_call;
+    double ns_per_call;              // Медиана по повторам
+    double min_ns_per_call;
+    long long iterations;            // Вызовов в одном повторе
+    int has_baseline;
+    double baseline_ns_per_call;
+} BenchResult;
+
+typedef struct {
+    double min_time;
+    int repeats;
+    const char *filter;
+    const char *output;
+    const char *baseline;
+    double threshold;
+    BenchResult results[BENCH_MAX_RESULTS];
+    int count;
+    int failed;                      // Точки входа, вернувшие ошибку
+} BenchSuite;
+
+static double run_timed(BenchFunction function, BenchContext *ctx, long long iterations) {
+    double start = wall_time();
+    function(ctx, iterations);
+    return wall_time() - start;
+}
+
+// batch - сколько "вызовов" выполняет одна итерация function (для векторных функций - длина массива)
+static void measure(BenchSuite *suite, const char *name, const char *params, double items_per_call, int batch,
+                    BenchFunction function, BenchContext *ctx) {
+    if (suite->filter != NULL && strstr(name, suite->filter) == NULL) {
+        return;
+    }
+    if (suite->count == BENCH_MAX_RESULTS) {
+        fprintf(stderr, "Слишком много замеров, %s %s пропущен\n", name, params);
+        return;
+    }
+
+    // Прогрев и подбор числа вызовов: удваиваем, пока замер не займет хотя бы десятую часть min_time
+    long long iterations = 1;
+    double elapsed = run_timed(function, ctx, iterations);
+    while (elapsed < 0.1 * suite->min_time && iterations < (1LL << 40)) {
+        iterations *= 2;
+        elapsed = run_timed(function, ctx, iterations);
+    }
+    double per_call = elapsed / iterations;
+    if (per_call > 0 && per_call * iterations < suite->min_time) {
+        iterations = (long long)ceil(suite->min_time / per_call);
+    }
+
+    double times[BENCH_MAX_REPEATS];
+    for (int r = 0; r < suite->repeats; r++) {
+        times[r] = run_timed(function, ctx, iterations) / ((double)iterations * batch) * 1e9;
+    }
+    qsort(times, suite->repeats, sizeof(double), compare_doubles);
+
+    BenchResult *result = &suite->results[suite->count++];
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->params, sizeof(result->params), "%s", params);
+    result->items_per_call = items_per_call;
+    result->ns_per_call = times[suite->repeats / 2];
+    result->min_ns_per_call = times[0];
+    result->iterations = iterations * batch;
+    fprintf(stderr, "%-20s %-28s %14.2f нс/вызов %16.0f вызовов/с\n", name, params,
+            result->ns_per_call, 1e9 / result->ns_per_call);
+}
+
+// --- ЗАМЕРЯЕМЫЕ ФУНКЦИИ ---
+
+static void bench_pdf_main(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += pdf_main(ctx->xs[i & (BENCH_POINTS - 1)], ctx->mu, ctx->lambda, ctx->v);
+    }
+    bench_sink = sum;
+}
+
+static void bench_pdf_main_batch(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        pdf_main_batch(ctx->xs, ctx->out, BENCH_POINTS, ctx->mu, ctx->lambda, ctx->v);
+    }
+    bench_sink = ctx->out[0];
+}
+
+static void bench_pdf_mixture(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += pdf_mixture(ctx->xs[i & (BENCH_POINTS - 1)], &ctx->mixture);
+    }
+    bench_sink = sum;
+}
+
+static void bench_pdf_mixture_batch(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        pdf_mixture_batch(ctx->xs, ctx->out, BENCH_POINTS, &ctx->mixture);
+    }
+    bench_sink = ctx->out[0];
+}
+
+static void bench_pdf_empirical(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += pdf_empirical(ctx->xs[i & (BENCH_POINTS - 1)], ctx->sample, ctx->sample_size);
+    }
+    bench_sink = sum;
+}
+
+static void bench_pdf_histogram(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += pdf_histogram(ctx->xs[i & (BENCH_POINTS - 1)], ctx->hist);
+    }
+    bench_sink = sum;
+}
+
+static void bench_generate_main(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += generate_main(ctx->mu, ctx->lambda, ctx->v);
+    }
+    bench_sink = sum;
+}
+
+static void bench_generate_main_n(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        generate_main_n(ctx->mu, ctx->lambda, ctx->v, ctx->out, BENCH_BLOCK, rng_default());
+    }
+    bench_sink = ctx->out[0];
+}
+
+static void bench_generate_mixture(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += generate_mixture(&ctx->mixture);
+    }
+    bench_sink = sum;
+}
+
+static void bench_generate_mixture_n(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        generate_mixture_n(&ctx->mixture, ctx->out, BENCH_BLOCK, rng_default());
+    }
+    bench_sink = ctx->out[0];
+}
+
+static void bench_generate_empirical(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        sum += generate_empirical(ctx->sample, ctx->sample_size);
+    }
+    bench_sink = sum;
+}
+
+static void bench_generate_empirical_n(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        generate_empirical_n(ctx->sample, ctx->sample_size, ctx->out, BENCH_BLOCK, rng_default());
+    }
+    bench_sink = ctx->out[0];
+}
+
+static void bench_moments_empirical(BenchContext *ctx, long long iterations) {
+    double sum = 0.0;
+    for (long long i = 0; i < iterations; i++) {
+        double mean, variance, skewness, kurtosis;
+        moments_empirical(ctx->sample, ctx->sample_size, &mean, &variance, &skewness, &kurtosis);
+        sum += mean + variance + skewness + kurtosis;
+    }
+    bench_sink = sum;
+}
+
+static int bench_io_status;          // Ошибки записи файлов графиков
+
+static void bench_save_plot_data(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        if (save_plot_data(ctx->plot) != 0) bench_io_status = -1;
+    }
+}
+
+static void bench_save_plot_data_binary(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        if (save_plot_data_binary(ctx->plot, NULL) != 0) bench_io_status = -1;
+    }
+}
+
+static void bench_stream_plot_case(BenchContext *ctx, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        if (stream_plot_case("bench", &ctx->mixture, 0, ctx->sample, ctx->sample_size) != 0) bench_io_status = -1;
+    }
+}
+
+// --- НАБОР ЗАМЕРОВ ---
+
+static void run_suite(BenchSuite *suite) {
+    static const double shapes[] = {0.05, 0.5, 1.0, 5.0, 50.0};
+    static const int shape_count = sizeof(shapes) / sizeof(shapes[0]);
+    static const int sizes[] = {1000, 100000, 10000000};
+
+    BenchContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.lambda = 1.0;
+    ctx.xs = (double*)malloc(BENCH_POINTS * sizeof(double));
+    ctx.out = (double*)malloc(BENCH_BLOCK * sizeof(double));
+    double *sample = (double*)malloc(sizes[2] * sizeof(double));
+    if (!ctx.xs || !ctx.out || !sample) {
+        fprintf(stderr, "Ошибка выделения памяти!\n");
+        suite->failed = 1;
+        free(ctx.xs);
+        free(ctx.out);
+        free(sample);
+        return;
+    }
+    for (int i = 0; i < BENCH_POINTS; i++) {
+        ctx.xs[i] = -5.0 + 10.0 * (i + 0.5) / BENCH_POINTS;
+    }
+    RngState rng;
+    rng_seed(&rng, 20240601);
+    generate_main_n(0.0, 1.0, 1.0, sample, sizes[2], &rng);
+    seed_random(1);
+
+    char params[64];
+
+    // Плотность и генерация основного распределения: от почти вырожденного до почти нормального
+    for (int k = 0; k < shape_count; k++) {
+        ctx.v = shapes[k];
+        snprintf(params, sizeof(params), "v=%g", ctx.v);
+        measure(suite, "pdf_main", params, 1, 1, bench_pdf_main, &ctx);
+        measure(suite, "pdf_main_batch", params, 1, BENCH_POINTS, bench_pdf_main_batch, &ctx);
+        measure(suite, "generate_main", params, 1, 1, bench_generate_main, &ctx);
+        measure(suite, "generate_main_n", params, 1, BENCH_BLOCK, bench_generate_main_n, &ctx);
+    }
+
+    // Смеси: одинаковые и сильно различающиеся формы компонент
+    MixtureParams mixtures[2] = {
+        {0.0, 1.0, 0.5, 0.0, 1.0, 2.0, 0.5},
+        {-3.0, 1.0, 0.05, 3.0, 2.0, 50.0, 0.3}
+    };
+    for (int k = 0; k < 2; k++) {
+        ctx.mixture = mixtures[k];
+        snprintf(params, sizeof(params), "v1=%g,v2=%g,p=%g", ctx.mixture.v1, ctx.mixture.v2, ctx.mixture.p);
+        measure(suite, "pdf_mixture", params, 1, 1, bench_pdf_mixture, &ctx);
+        measure(suite, "pdf_mixture_batch", params, 1, BENCH_POINTS, bench_pdf_mixture_batch, &ctx);
+        measure(suite, "generate_mixture", params, 1, 1, bench_generate_mixture, &ctx);
+        measure(suite, "generate_mixture_n", params, 1, BENCH_BLOCK, bench_generate_mixture_n, &ctx);
+    }
+
+    // Эмпирическое распределение и моменты по выборкам разного объема
+    ctx.sample = sample;
+    for (int k = 0; k < 3; k++) {
+        ctx.sample_size = sizes[k];
+        snprintf(params, sizeof(params), "n=%d", ctx.sample_size);
+        if (sizes[k] <= 100000) {
+            // Каждый вызов строит гистограмму заново
+            measure(suite, "pdf_empirical", params, sizes[k], 1, bench_pdf_empirical, &ctx);
+        }
+        ctx.hist = build_empirical_histogram(sample, ctx.sample_size);
+        if (ctx.hist) {
+            measure(suite, "pdf_histogram", params, 1, 1, bench_pdf_histogram, &ctx);
+            free_empirical_histogram(ctx.hist);
+            ctx.hist = NULL;
+        }
+        measure(suite, "generate_empirical", params, 1, 1, bench_generate_empirical, &ctx);
+        measure(suite, "generate_empirical_n", params, 1, BENCH_BLOCK, bench_generate_empirical_n, &ctx);
+        measure(suite, "moments_empirical", params, sizes[k], 1, bench_moments_empirical, &ctx);
+    }
+
+    // Запись данных графиков: 10000 точек кривой и выборки разного объема.
+    // Файлы data/plot_data_bench.* удаляются после замеров
+    int messages = plot_messages_enabled();
+    set_plot_messages(0);
+    MixtureParams main_params = {0.0, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0};
+    ctx.mixture = main_params;
+    int plot_sizes[2] = {10000, 1000000};
+    for (int k = 0; k < 2; k++) {
+        ctx.sample_size = plot_sizes[k];
+        ctx.plot = generate_plot_data("bench", &ctx.mixture, 0, sample, plot_sizes[k]);
+        if (!ctx.plot) {
+            suite->failed = 1;
+            continue;
+        }
+        snprintf(params, sizeof(params), "points=%d,n=%d", ctx.plot->points_count, plot_sizes[k]);
+        bench_io_status = 0;
+        double items = ctx.plot->points_count + plot_sizes[k];
+        measure(suite, "save_plot_data", params, items, 1, bench_save_plot_data, &ctx);
+        measure(suite, "save_plot_data_binary", params, items, 1, bench_save_plot_data_binary, &ctx);
+        measure(suite, "stream_plot_case", params, items, 1, bench_stream_plot_case, &ctx);
+        if (bench_io_status != 0) {
+            fprintf(stderr, "Ошибка записи данных графика (нет каталога data?)\n");
+            suite->failed = 1;
+        }
+        free_plot_data(ctx.plot);
+        ctx.plot = NULL;
+    }
+    remove("data/plot_data_bench.txt");
+    remove("data/plot_data_bench.bin");
+    set_plot_messages(messages);
+
+    free(ctx.xs);
+    free(ctx.out);
+    free(sample);
+}
+
+// --- СРАВНЕНИЕ С БАЗОВЫМ ЗАПУСКОМ ---
+
+// Читает результаты прошлого запуска: файл этой программы, по результату на строку
+static int load_baseline(BenchSuite *suite) {
+    FILE *file = fopen(suite->baseline, "r");
+    if (!file) {
+        fprintf(stderr, "Не удалось открыть базовый файл %s\n", suite->baseline);
+        return -1;
+    }
+    char line[1024];
+    int matched = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char name[48], params[64];
+        double ns;
+        if (sscanf(line, " {\"name\":\"%47[^\"]\",\"params\":\"%63[^\"]\",\"items_per_call\":%*f,\"ns_per_call\":%lf",
+                   name, params, &ns) != 3) {
+            continue;
+        }
+        for (int i = 0; i < suite->count; i++) {
+            BenchResult *result = &suite->results[i];
+            if (strcmp(result->name, name) == 0 && strcmp(result->params, params) == 0) {
+                result->has_baseline = 1;
+                result->baseline_ns_per_call = ns;
+                matched++;
+            }
+        }
+    }
+    fclose(file);
+    return matched;
+}
+
+// Печатает сравнение в stderr, возвращает число регрессий
+static int compare_with_baseline(const BenchSuite *suite) {
+    int regressions = 0;
+    fprintf(stderr, "\nСравнение с %s (порог %.0f%%):\n", suite->baseline, 100 * suite->threshold);
+    for (int i = 0; i < suite->count; i++) {
+        const BenchResult *result = &suite->results[i];
+        if (!result->has_baseline) {
+            fprintf(stderr, "%-20s %-28s нет в базовом файле\n", result->name, result->params);
+            continue;
+        }
+        double change = result->ns_per_call / result->baseline_ns_per_call - 1.0;
+        const char *verdict = "";
+        if (change > suite->threshold) {
+            verdict = "  РЕГРЕССИЯ";
+            regressions++;
+        } else if (change < -suite->threshold) {
+            verdict = "  ускорение";
+        }
+        fprintf(stderr, "%-20s %-28s %12.2f -> %12.2f нс %+7.1f%%%s\n", result->name, result->params,
+                result->baseline_ns_per_call, result->ns_per_call, 100 * change, verdict);
+    }
+    return regressions;
+}
+
+// --- ВЫВОД ---
+
+static void write_json(const BenchSuite *suite, FILE *out) {
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(out, "{\n\"version\":1,\n\"timestamp\":\"%s\",\n\"cores\":%d,\n", stamp, available_cores());
+#ifdef __VERSION__
+    fprintf(out, "\"compiler\":\"%s\",\n", __VERSION__);
+#endif
+    fprintf(out, "\"min_time\":%g,\n\"repeats\":%d,\n\"results\":[\n", suite->min_time, suite->repeats);
+    for (int i = 0; i < suite->count; i++) {
+        const BenchResult *result = &suite->results[i];
+        fprintf(out, "{\"name\":\"%s\",\"params\":\"%s\",\"items_per_call\":%.17g,\"ns_per_call\":%.6g,"
+                     "\"min_ns_per_call\":%.6g,\"calls_per_second\":%.6g,\"iterations\":%lld",
+                result->name, result->params, result->items_per_call, result->ns_per_call,
+                result->min_ns_per_call, 1e9 / result->ns_per_call, result->iterations);
+        if (result->has_baseline) {
+            fprintf(out, ",\"baseline_ns_per_call\":%.6g,\"change\":%.6g", result->baseline_ns_per_call,
+                    result->ns_per_call / result->baseline_ns_per_call - 1.0);
+        }
+        fprintf(out, "}%s\n", (i + 1 < suite->count) ? "," : "");
+    }
+    fprintf(out, "]\n}\n");
+}
+
+static void print_usage(void) {
+    fprintf(stderr,
+        "Использование: bench.o [флаги]\n"
+        "  --min-time SEC     Длительность одного повтора замера (0.1)\n"
+        "  --repeats R        Число повторов, в результат идет медиана (5)\n"
+        "  --filter TEXT      Только замеры, в имени которых есть TEXT\n"
+        "  --output FILE      Записать JSON в файл (по умолчанию stdout)\n"
+        "  --baseline FILE    Сравнить с прошлым запуском\n"
+        "  --threshold FRAC   Допустимое замедление при сравнении (0.1)\n");
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = (BenchSuite*)calloc(1, sizeof(BenchSuite));
+    if (!suite) return 1;
+    suite->min_time = 0.1;
+    suite->repeats = 5;
+    suite->threshold = 0.1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *flag = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        char *end = NULL;
+        int ok = value != NULL;
+        errno = 0;
+        if (ok && strcmp(flag, "--min-time") == 0) {
+            suite->min_time = strtod(value, &end);
+            ok = *end == '\0' && suite->min_time > 0;
+        } else if (ok && strcmp(flag, "--repeats") == 0) {
+            suite->repeats = (int)strtol(value, &end, 10);
+            ok = *end == '\0' && suite->repeats >= 1 && suite->repeats <= BENCH_MAX_REPEATS;
+        } else if (ok && strcmp(flag, "--threshold") == 0) {
+            suite->threshold = strtod(value, &end);
+            ok = *end == '\0' && suite->threshold >= 0;
+        } else if (ok && strcmp(flag, "--filter") == 0) {
+            suite->filter = value;
+        } else if (ok && strcmp(flag, "--output") == 0) {
+            suite->output = value;
+        } else if (ok && strcmp(flag, "--baseline") == 0) {
+            suite->baseline = value;
+        } else {
+            ok = 0;
+        }
+        if (!ok || errno != 0) {
+            fprintf(stderr, "Некорректный флаг: %s\n", flag);
+            print_usage();
+            free(suite);
+            return 2;
+        }
+        i++;
+    }
+
+    run_suite(suite);
+
+    int regressions = 0;
+    if (suite->baseline != NULL) {
+        if (load_baseline(suite) < 0) {
+            suite->failed = 1;
+        } else {
+            regressions = compare_with_baseline(suite);
+        }
+    }
+
+    FILE *out = stdout;
+    if (suite->output != NULL) {
+        out = fopen(suite->output, "w");
+        if (!out) {
+            fprintf(stderr, "Не удалось открыть %s\n", suite->output);
+            free(suite);
+            return 1;
+        }
+    }
+    write_json(suite, out);
+    if (out != stdout) fclose(out);
+
+    if (regressions > 0) {
+        fprintf(stderr, "Регрессий: %d\n", regressions);
+    }
+    int status = (suite->failed || regressions > 0) ? 1 : 0;
+    free(suite);
+    return status;
+}
@@ -0,0 +1,170 @@
+#include "bootstrap.h"
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+typedef struct {
+    const double *centered;      // d_i = x_i - x
+    int n;
+    int m;                       // Объем повторной выборки
+    double center;               // x
+    int replicates;
+    uint64_t seed;
+    unsigned char *counts;       // По потокам: n счетчиков кратностей по модулю 256
+    int *overflow;               // По потокам: индексы, чей счетчик перешел через 256
+    int overflow_capacity;       // m / 256 + 1 на поток
+    double *stats;               // BOOT_STATISTICS * B значений
+} BootstrapJob;
+
+// Характеристики повторной выборки по суммам S_k = sum c_i d_i^k
+static void replicate_moments(const BootstrapJob *job, double s1, double s2, double s3, double s4, int b) {
+    // Сдвиг к собственному среднему повторной выборки: delta = S_1 / m мало (порядка s / sqrt(m)),
+    // поэтому вычитание почти не теряет точности
+    double m = job->m;
+    double delta = s1 / m;
+    MomentAccumulator acc;
+    acc.n = job->m;
+    acc.mean = job->center + delta;
+    acc.m2 = s2 - delta * s1;
+    acc.m3 = s3 - 3 * delta * s2 + 2 * delta * delta * s1;
+    acc.m4 = s4 - 4 * delta * s3 + 6 * delta * delta * s2 - 3 * delta * delta * delta * s1;
+    if (acc.m2 < 0) acc.m2 = 0.0;    // Все значения повторной выборки одинаковые
+
+    int B = job->replicates;
+    double *stats = job->stats;
+    moments_from_accumulator(&acc, &stats[BOOT_MEAN * B + b], &stats[BOOT_VARIANCE * B + b],
+                             &stats[BOOT_SKEWNESS * B + b], &stats[BOOT_KURTOSIS * B + b]);
+}
+
+static void bootstrap_task(void *ctx, int worker, int workers) {
+    BootstrapJob *job = (BootstrapJob*)ctx;
+    unsigned char *counts = job->counts + (size_t)worker * job->n;
+    int *overflow = job->overflow + (size_t)worker * job->overflow_capacity;
+    const double *d = job->centered;
+    int n = job->n;
+
+    // Повторные выборки этого потока; генератор каждой определяется только ее номером b
+    int begin = (int)((long long)job->replicates * worker / workers);
+    int end = (int)((long long)job->replicates * (worker + 1) / workers);
+    for (int b = begin; b < end; b++) {
+        RngState rng;
+        rng_seed_stream(&rng, job->seed, (uint64_t)b);
+
+        // Вектор кратностей: m равновероятных индексов. Байтовые счетчики (n байт) помещаются
+        // в кэш там, где int уже не помещается; кратность 256 и больше почти невероятна
+        // и учитывается отдельным списком переполнений
+        int overflows = 0;
+        for (int k = 0; k < job->m; k++) {
+            uint64_t i = rng_bounded(&rng, (uint64_t)n);
+            if (++counts[i] == 0) {
+                overflow[overflows++] = (int)i;
+            }
+        }
+
+        // Один последовательный проход: суммы и обнуление счетчиков для следующей выборки
+        double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0;
+        for (int i = 0; i < n; i++) {
+            double c = counts[i];
+            double d1 = d[i];
+            double d2 = d1 * d1;
+            s1 += c * d1;
+            s2 += c * d2;
+            s3 += c * d2 * d1;
+            s4 += c * d2 * d2;
+            counts[i] = 0;
+        }
+        for (int k = 0; k < overflows; k++) {
+            double d1 = d[overflow[k]];
+            double d2 = d1 * d1;
+            s1 += 256 * d1;
+            s2 += 256 * d2;
+            s3 += 256 * d2 * d1;
+            s4 += 256 * d2 * d2;
+        }
+        replicate_moments(job, s1, s2, s3, s4, b);
+    }
+}
+
+// --- БУТСТРЭП ---
+
+void default_bootstrap_options(BootstrapOptions *options) {
+    options->replicates = 1000;
+    options->resample_size = 0;
+    options->confidence = 0.95;
+    options->seed = 1;
+}
+
+int bootstrap_moments(const double *sample, int sample_size, const BootstrapOptions *options,
+                      ThreadPool *pool, BootstrapResult *result, double *replicates) {
+    BootstrapOptions defaults;
+    if (options == NULL) {
+        default_bootstrap_options(&defaults);
+        options = &defaults;
+    }
+    if (sample == NULL || sample_size < 2 || result == NULL || options->replicates < 2 ||
+        options->resample_size < 0 || !(options->confidence > 0 && options->confidence < 1)) {
+        return -1;
+    }
+
+    int B = options->replicates;
+    int workers = thread_pool_size(pool);
+    BootstrapJob job;
+    job.n = sample_size;
+    job.m = (options->resample_size > 0) ? options->resample_size : sample_size;
+    job.replicates = B;
+    job.seed = options->seed;
+
+    double *centered = (double*)malloc(sample_size * sizeof(double));
+    job.counts = (unsigned char*)calloc((size_t)workers * sample_size, 1);
+    job.overflow_capacity = job.m / 256 + 1;
+    job.overflow = (int*)malloc((size_t)workers * job.overflow_capacity * sizeof(int));
+    job.stats = (replicates != NULL) ? replicates
+                                     : (double*)malloc((size_t)BOOT_STATISTICS * B * sizeof(double));
+    if (!centered || !job.counts || !job.overflow || !job.stats) {
+        free(centered);
+        free(job.counts);
+        free(job.overflow);
+        if (job.stats != replicates) free(job.stats);
+        return -1;
+    }
+
+    // moments_empirical не меняет выборку
+    moments_empirical_parallel((double*)sample, sample_size, pool, &result->estimate[BOOT_MEAN],
+                               &result->estimate[BOOT_VARIANCE], &result->estimate[BOOT_SKEWNESS],
+                               &result->estimate[BOOT_KURTOSIS]);
+    job.center = result->estimate[BOOT_MEAN];
+    for (int i = 0; i < sample_size; i++) {
+        centered[i] = sample[i] - job.center;
+    }
+    job.centered = centered;
+
+    thread_pool_run(pool, bootstrap_task, &job);
+
+    result->replicates = B;
+    result->resample_size = job.m;
+    result->confidence = options->confidence;
+    double alpha = 1.0 - options->confidence;
+    int status = 0;
+    for (int s = 0; s < BOOT_STATISTICS; s++) {
+        double *values = job.stats + (size_t)s * B;
+
+        MomentAccumulator acc;
+        init_moment_accumulator(&acc);
+        add_many_to_moment_accumulator(&acc, values, B);
+        result->bias[s] = acc.mean - result->estimate[s];
+        result->std_error[s] = sqrt(acc.m2 / (B - 1));
+
+        // Процентильный интервал; упорядочивать значения нужно, только если их просили вернуть
+        result->lower[s] = quantile_empirical(values, B, 0, 0.5 * alpha);
+        result->upper[s] = quantile_empirical(values, B, (int)(0.5 * alpha * (B - 1)), 1.0 - 0.5 * alpha);
+        if (replicates != NULL && sort_parallel(values, B, pool) != 0) {
+            status = -1;
+            break;
+        }
+    }
+
+    free(centered);
+    free(job.counts);
+    free(job.overflow);
+    if (job.stats != replicates) free(job.stats);
+    return status;
+}
@@ -0,0 +1,78 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include "distributions.h"
+#include "parallel.h"
+
+// --- БУТСТРЭП ВЫБОРОЧНЫХ МОМЕНТОВ ---
+// B повторных выборок объема m из исходной выборки x_1..x_n (выбор с возвращением).
+// Повторная выборка не строится: она однозначно задается вектором кратностей c_1..c_n
+// (полиномиальное распределение с суммой m), а моменты зависят только от сумм
+//   S_k = sum c_i d_i^k,  d_i = x_i - x,  k = 1..4,
+// где x - среднее исходной выборки. По S_k центральные суммы повторной выборки
+// пересчитываются к ее собственному среднему и превращаются в моменты теми же формулами,
+// что и в moments_from_accumulator. Одна повторная выборка стоит m случайных индексов
+// (приращения счетчиков) и одного последовательного прохода по n значениям;
+// память - n байтовых счетчиков на поток вместо копии выборки на каждую повторную выборку.
+// Повторная выборка b использует генератор rng_seed_stream(seed, b), а не генератор потока,
+// который ее считает (о разбиении работы между потоками - в parallel.h).
+
+/**
+ * @brief Оцениваемые характеристики (индексы в массивах BootstrapResult).
+ */
+typedef enum {
+    BOOT_MEAN,
+    BOOT_VARIANCE,
+    BOOT_SKEWNESS,
+    BOOT_KURTOSIS,
+    BOOT_STATISTICS       // Число характеристик
+} BootstrapStatistic;
+
+/**
+ * @brief Настройки бутстрэпа.
+ */
+typedef struct {
+    int replicates;        // Число повторных выборок B
+    int resample_size;     // Объем повторной выборки m (0 - равен объему исходной)
+    double confidence;     // Уровень доверия интервалов, 0 < confidence < 1
+    uint64_t seed;         // Начальное значение генераторов
+} BootstrapOptions;
+
+/**
+ * @brief Результаты бутстрэпа: для каждой характеристики (индекс BootstrapStatistic)
+ *        оценка по исходной выборке, смещение, стандартная ошибка и процентильный интервал.
+ */
+typedef struct {
+    int replicates;
+    int resample_size;
+    double confidence;
+    double estimate[BOOT_STATISTICS];    // По исходной выборке
+    double bias[BOOT_STATISTICS];        // Среднее по повторным выборкам минус estimate
+    double std_error[BOOT_STATISTICS];   // Стандартное отклонение по повторным выборкам
+    double lower[BOOT_STATISTICS];       // Квантиль уровня (1 - confidence) / 2
+    double upper[BOOT_STATISTICS];       // Квантиль уровня (1 + confidence) / 2
+} BootstrapResult;
+
+/**
+ * @brief Заполняет настройки значениями по умолчанию.
+ * @note B = 1000, m = n, уровень доверия 0.95, seed = 1.
+ */
+void default_bootstrap_options(BootstrapOptions *options);
+
+/**
+ * @brief Бутстрэп среднего, дисперсии, асимметрии и эксцесса.
+ * @param sample Исходная выборка.
+ * @param sample_size Объем исходной выборки n (не меньше 2).
+ * @param options Настройки (NULL - по умолчанию).
+ * @param pool Пул потоков (NULL - один поток).
+ * @param result Результаты.
+ * @param replicates Массив для значений характеристик по повторным выборкам
+ *                   (BOOT_STATISTICS * B значений: характеристика s - в [s * B, (s + 1) * B),
+ *                   по возрастанию) или NULL.
+ * @return 0 при успехе, -1 при ошибке (некорректные параметры, нет памяти).
+ * @note Время O(B (m + n)), дополнительная память O(n * потоки + B).
+ */
+int bootstrap_moments(const double *sample, int sample_size, const BootstrapOptions *options,
+                      ThreadPool *pool, BootstrapResult *result, double *replicates);
+
+#endif
@@ -0,0 +1,686 @@
+#include "cli.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "bootstrap.h"
+#include "gof.h"
+#include "plot_io.h"
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+#define CLI_MAX_TOKENS 64          // Аргументов в строке пакета
+#define CLI_LINE_LENGTH 4096
+#define CLI_CACHE_SIZE 16          // Подготовленных распределений
+#define CLI_NAME_LENGTH 64
+#define CLI_TABLE_TOLERANCE 1e-12  // Таблица F(x) для критериев согласия (как в goodness_of_fit)
+
+typedef enum {
+    CLI_TEXT,
+    CLI_CSV,
+    CLI_JSON
+} CliFormat;
+
+// Один сценарий
+typedef struct {
+    char name[CLI_NAME_LENGTH];
+    int is_mixture;
+    MixtureParams params;
+    int n;
+    uint64_t seed;
+    int seed_set;              // seed задан явно
+    int gof;                   // Критерии согласия
+    int bootstrap;             // Число повторных выборок (0 - без бутстрэпа)
+    int resample;              // Анализировать бутстрэп-выборку из сгенерированной (как в тесте 3.3.2)
+    int plot;                  // Записать data/plot_data_<name>.bin
+    PlotGridOptions grid;
+} CliScenario;
+
+// Параметры, которые задаются только в командной строке
+typedef struct {
+    int threads;
+    CliFormat format;
+    const char *batch;
+    int help;
+} CliGlobal;
+
+// Подготовленное распределение
+typedef struct {
+    int is_mixture;
+    MixtureParams params;
+    SHDist dist;               // Основное распределение
+    Mixture *mixture;          // Смесь
+    InversionTable *table;     // Строится при первой проверке согласия
+} CliPrepared;
+
+typedef struct {
+    ThreadPool *pool;
+    CliFormat format;
+    CliPrepared cache[CLI_CACHE_SIZE];
+    int cached;                // Занятых записей
+    int next_slot;             // Запись, вытесняемая при заполненном кэше
+    double *sample;            // Буферы выборок, растут до наибольшего n
+    double *resampled;
+    int capacity;
+    int rows;                  // Выведено сценариев (для заголовка CSV)
+} CliSession;
+
+// Результаты сценария
+typedef struct {
+    double theory[BOOT_STATISTICS];
+    double sample[BOOT_STATISTICS];
+    double generation_time;
+    double total_time;
+    int has_gof;
+    GofReport gof;
+    int has_bootstrap;
+    BootstrapResult bootstrap;
+    int plot_status;           // 0 - записан, -1 - ошибка, 1 - не требовался
+} CliResult;
+
+static const char *STATISTIC_NAMES[BOOT_STATISTICS] = {"mean", "variance", "skewness", "kurtosis"};
+
+static void print_usage(FILE *out) {
+    fprintf(out,
+        "Использование: spreadings [флаги]    (без флагов - интерактивное меню)\n"
+        "Сценарий:\n"
+        "  --dist main|mixture     Распределение (main)\n"
+        "  --mu, --lambda, --v     Параметры (первой компоненты смеси): 0, 1, 1\n"
+        "  --mu2, --lambda2, --v2  Параметры второй компоненты: 0, 1, 1\n"
+        "  --p P                   Вес первой компоненты: 0.5\n"
+        "  --n N                   Объем выборки (10000; 0 - только теория и график)\n"
+        "  --seed S                Начальное значение генератора (1)\n"
+        "  --case NAME             Имя сценария (и файла графика)\n"
+        "  --gof                   Критерии согласия\n"
+        "  --bootstrap B           Бутстрэп-интервалы моментов по B повторным выборкам\n"
+        "  --resample              Анализировать бутстрэп-выборку из сгенерированной\n"
+        "  --plot                  Записать data/plot_data_<case>.bin\n"
+        "  --grid N                Точек кривой графика (10000)\n"
+        "  --adaptive              Адаптивная сетка кривой графика\n"
+        "Запуск:\n"
+        "  --batch FILE            Сценарии из файла, по одному на строку\n"
+        "  --threads T             Число потоков (0 - по числу ядер)\n"
+        "  --format text|csv|json  Формат вывода (text)\n"
+        "  --help                  Эта справка\n");
+}
+
+static int parse_double(const char *text, double *value) {
+    char *end;
+    errno = 0;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !isfinite(parsed)) {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+static int parse_int(const char *text, long long min, long long max, long long *value) {
+    char *end;
+    errno = 0;
+    long long parsed = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < min || parsed > max) {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+static void default_scenario(CliScenario *scenario) {
+    memset(scenario, 0, sizeof(*scenario));
+    MixtureParams params = {0, 1, 1.0, 0, 1, 1.0, 0.5};
+    scenario->params = params;
+    scenario->n = 10000;
+    scenario->seed = 1;
+    default_plot_grid_options(&scenario->grid);
+}
+
+// Разбирает флаги; global == NULL - флаги запуска запрещены (строка пакета).
+// Возвращает 0 или -1 с сообщением в stderr
+static int parse_arguments(int argc, char **argv, CliScenario *scenario, CliGlobal *global, const char *where) {
+    for (int i = 0; i < argc; i++) {
+        const char *flag = argv[i];
+
+        // Флаги без значения
+        if (strcmp(flag, "--gof") == 0) {
+            scenario->gof = 1;
+            continue;
+        }
+        if (strcmp(flag, "--resample") == 0) {
+            scenario->resample = 1;
+            continue;
+        }
+        if (strcmp(flag, "--plot") == 0) {
+            scenario->plot = 1;
+            continue;
+        }
+        if (strcmp(flag, "--adaptive") == 0) {
+            scenario->grid.adaptive = 1;
+            continue;
+        }
+        if (global != NULL && strcmp(flag, "--help") == 0) {
+            global->help = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "%s: неизвестный флаг или нет значения: %s\n", where, flag);
+            return -1;
+        }
+        const char *value = argv[++i];
+        double number;
+        long long integer;
+        int ok = 1;
+
+        if (strcmp(flag, "--dist") == 0) {
+            if (strcmp(value, "main") == 0) {
+                scenario->is_mixture = 0;
+            } else if (strcmp(value, "mixture") == 0) {
+                scenario->is_mixture = 1;
+            } else {
+                ok = 0;
+            }
+        } else if (strcmp(flag, "--mu") == 0) {
+            ok = parse_double(value, &scenario->params.mu1) == 0;
+        } else if (strcmp(flag, "--lambda") == 0) {
+            ok = parse_double(value, &number) == 0 && number > 0;
+            if (ok) scenario->params.lambda1 = number;
+        } else if (strcmp(flag, "--v") == 0) {
+            ok = parse_double(value, &number) == 0 && number > 0;
+            if (ok) scenario->params.v1 = number;
+        } else if (strcmp(flag, "--mu2") == 0) {
+            ok = parse_double(value, &scenario->params.mu2) == 0;
+        } else if (strcmp(flag, "--lambda2") == 0) {
+            ok = parse_double(value, &number) == 0 && number > 0;
+            if (ok) scenario->params.lambda2 = number;
+        } else if (strcmp(flag, "--v2") == 0) {
+            ok = parse_double(value, &number) == 0 && number > 0;
+            if (ok) scenario->params.v2 = number;
+        } else if (strcmp(flag, "--p") == 0) {
+            ok = parse_double(value, &number) == 0 && number >= 0 && number <= 1;
+            if (ok) scenario->params.p = number;
+        } else if (strcmp(flag, "--n") == 0) {
+            ok = parse_int(value, 0, INT32_MAX, &integer) == 0;
+            if (ok) scenario->n = (int)integer;
+        } else if (strcmp(flag, "--seed") == 0) {
+            char *end;
+            errno = 0;
+            unsigned long long seed = strtoull(value, &end, 10);
+            ok = end != value && *end == '\0' && errno == 0 && value[0] != '-';
+            if (ok) {
+                scenario->seed = seed;
+                scenario->seed_set = 1;
+            }
+        } else if (strcmp(flag, "--case") == 0) {
+            // Имя становится частью имени файла графика и строк CSV/JSON
+            ok = strlen(value) < CLI_NAME_LENGTH && strpbrk(value, "/\\\",") == NULL;
+            if (ok) snprintf(scenario->name, sizeof(scenario->name), "%s", value);
+        } else if (strcmp(flag, "--bootstrap") == 0) {
+            ok = parse_int(value, 2, INT32_MAX, &integer) == 0;
+            if (ok) scenario->bootstrap = (int)integer;
+        } else if (strcmp(flag, "--grid") == 0) {
+            ok = parse_int(value, 2, INT32_MAX, &integer) == 0;
+            if (ok) scenario->grid.points_count = (int)integer;
+        } else if (global != NULL && strcmp(flag, "--threads") == 0) {
+            ok = parse_int(value, 0, 4096, &integer) == 0;
+            if (ok) global->threads = (int)integer;
+        } else if (global != NULL && strcmp(flag, "--format") == 0) {
+            if (strcmp(value, "text") == 0) {
+                global->format = CLI_TEXT;
+            } else if (strcmp(value, "csv") == 0) {
+                global->format = CLI_CSV;
+            } else if (strcmp(value, "json") == 0) {
+                global->format = CLI_JSON;
+            } else {
+                ok = 0;
+            }
+        } else if (global != NULL && strcmp(flag, "--batch") == 0) {
+            global->batch = value;
+        } else {
+            fprintf(stderr, "%s: неизвестный флаг: %s\n", where, flag);
+            return -1;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "%s: некорректное значение %s %s\n", where, flag, value);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// --- ПОДГОТОВЛЕННЫЕ РАСПРЕДЕЛЕНИЯ ---
+
+static void free_prepared(CliPrepared *prepared) {
+    free_mixture(prepared->mixture);
+    free_inversion_table(prepared->table);
+    memset(prepared, 0, sizeof(*prepared));
+}
+
+// Подготовленное распределение сценария: из кэша или новое (вытесняет самое старое)
+static CliPrepared* find_prepared(CliSession *session, const CliScenario *scenario) {
+    for (int k = 0; k < session->cached; k++) {
+        CliPrepared *prepared = &session->cache[k];
+        if (prepared->is_mixture == scenario->is_mixture &&
+            memcmp(&prepared->params, &scenario->params, sizeof(MixtureParams)) == 0) {
+            return prepared;
+        }
+    }
+
+    CliPrepared *prepared;
+    if (session->cached < CLI_CACHE_SIZE) {
+        prepared = &session->cache[session->cached++];
+    } else {
+        prepared = &session->cache[session->next_slot];
+        session->next_slot = (session->next_slot + 1) % CLI_CACHE_SIZE;
+        free_prepared(prepared);
+    }
+
+    prepared->is_mixture = scenario->is_mixture;
+    prepared->params = scenario->params;
+    if (scenario->is_mixture) {
+        prepared->mixture = create_mixture_from_params(&scenario->params);
+        if (prepared->mixture == NULL) {
+            free_prepared(prepared);
+            return NULL;
+        }
+    } else if (prepare_sh_dist(&prepared->dist, scenario->params.mu1, scenario->params.lambda1,
+                               scenario->params.v1) != 0) {
+        free_prepared(prepared);
+        return NULL;
+    }
+    return prepared;
+}
+
+// Буферы выборок на n значений
+static int reserve_samples(CliSession *session, int n) {
+    if (n <= session->capacity) return 0;
+    double *sample = (double*)realloc(session->sample, (size_t)n * sizeof(double));
+    if (!sample) return -1;
+    session->sample = sample;
+    double *resampled = (double*)realloc(session->resampled, (size_t)n * sizeof(double));
+    if (!resampled) return -1;
+    session->resampled = resampled;
+    session->capacity = n;
+    return 0;
+}
+
+// --- ВЫПОЛНЕНИЕ СЦЕНАРИЯ ---
+
+// Возвращает 0, 1 - часть результатов не получена, -1 - сценарий не выполнен
+static int run_scenario(CliSession *session, const CliScenario *scenario, CliResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->plot_status = 1;
+    double start = wall_time();
+
+    CliPrepared *prepared = find_prepared(session, scenario);
+    if (prepared == NULL) {
+        fprintf(stderr, "%s: некорректные параметры распределения\n", scenario->name);
+        return -1;
+    }
+    if (scenario->is_mixture) {
+        moments_mixture_k(prepared->mixture, &result->theory[BOOT_MEAN], &result->theory[BOOT_VARIANCE],
+                          &result->theory[BOOT_SKEWNESS], &result->theory[BOOT_KURTOSIS]);
+    } else {
+        moments_sh_dist(&prepared->dist, &result->theory[BOOT_MEAN], &result->theory[BOOT_VARIANCE],
+                        &result->theory[BOOT_SKEWNESS], &result->theory[BOOT_KURTOSIS]);
+    }
+
+    int n = scenario->n;
+    double *sample = NULL;
+    if (n > 0) {
+        if (reserve_samples(session, n) != 0) {
+            fprintf(stderr, "%s: нет памяти под выборку из %d значений\n", scenario->name, n);
+            return -1;
+        }
+        double generation_start = wall_time();
+        if (scenario->is_mixture) {
+            generate_mixture_k_parallel(prepared->mixture, session->sample, n, scenario->seed, session->pool);
+        } else {
+            generate_sh_dist_parallel(&prepared->dist, session->sample, n, scenario->seed, session->pool);
+        }
+        sample = session->sample;
+        if (scenario->resample) {
+            // Индексы берутся из потока генератора, не пересекающегося с потоком генерации
+            generate_empirical_parallel(sample, n, session->resampled, n, scenario->seed ^ 0x9E3779B97F4A7C15ULL,
+                                        session->pool);
+            sample = session->resampled;
+        }
+        result->generation_time = wall_time() - generation_start;
+
+        moments_empirical_parallel(sample, n, session->pool, &result->sample[BOOT_MEAN], &result->sample[BOOT_VARIANCE],
+                                   &result->sample[BOOT_SKEWNESS], &result->sample[BOOT_KURTOSIS]);
+    }
+
+    // График - до проверки согласия, которая упорядочивает выборку
+    if (scenario->plot) {
+        result->plot_status = stream_plot_case_grid(scenario->name, &scenario->params, scenario->is_mixture,
+                                                    &scenario->grid, sample, n);
+        if (result->plot_status != 0) {
+            fprintf(stderr, "%s: не удалось записать data/plot_data_%s.bin\n", scenario->name, scenario->name);
+        }
+    }
+
+    if (scenario->bootstrap > 0 && n >= 2) {
+        BootstrapOptions options;
+        default_bootstrap_options(&options);
+        options.replicates = scenario->bootstrap;
+        options.seed = scenario->seed;
+        result->has_bootstrap = bootstrap_moments(sample, n, &options, session->pool, &result->bootstrap, NULL) == 0;
+        if (!result->has_bootstrap) {
+            fprintf(stderr, "%s: ошибка бутстрэпа\n", scenario->name);
+        }
+    }
+
+    if (scenario->gof && n > 0) {
+        if (prepared->table == NULL) {
+            prepared->table = build_inversion_table(&scenario->params, scenario->is_mixture, CLI_TABLE_TOLERANCE);
+        }
+        result->has_gof = prepared->table != NULL && sort_parallel(sample, n, session->pool) == 0 &&
+                          goodness_of_fit_sorted(sample, n, prepared->table, 0, session->pool, &result->gof) == 0;
+        if (!result->has_gof) {
+            fprintf(stderr, "%s: ошибка проверки согласия\n", scenario->name);
+        }
+    }
+
+    result->total_time = wall_time() - start;
+    int failed = (scenario->plot && result->plot_status != 0) ||
+                 (scenario->bootstrap > 0 && n >= 2 && !result->has_bootstrap) ||
+                 (scenario->gof && n > 0 && !result->has_gof);
+    return failed ? 1 : 0;
+}
+
+// --- ВЫВОД ---
+
+static void print_text(const CliScenario *scenario, const CliResult *result) {
+    const MixtureParams *p = &scenario->params;
+    if (scenario->is_mixture) {
+        printf("[%s] смесь: mu=(%g, %g), lambda=(%g, %g), v=(%g, %g), p=%g; n=%d, seed=%llu\n", scenario->name,
+               p->mu1, p->mu2, p->lambda1, p->lambda2, p->v1, p->v2, p->p, scenario->n,
+               (unsigned long long)scenario->seed);
+    } else {
+        printf("[%s] основное: mu=%g, lambda=%g, v=%g; n=%d, seed=%llu\n", scenario->name,
+               p->mu1, p->lambda1, p->v1, scenario->n, (unsigned long long)scenario->seed);
+    }
+    printf("  Теория:   M=%.6f, D=%.6f, γ1=%.6f, γ2=%.6f\n", result->theory[BOOT_MEAN],
+           result->theory[BOOT_VARIANCE], result->theory[BOOT_SKEWNESS], result->theory[BOOT_KURTOSIS]);
+    if (scenario->n > 0) {
+        printf("  Выборка:  M=%.6f, D=%.6f, γ1=%.6f, γ2=%.6f\n", result->sample[BOOT_MEAN],
+               result->sample[BOOT_VARIANCE], result->sample[BOOT_SKEWNESS], result->sample[BOOT_KURTOSIS]);
+        printf("  Генерация: %.4f с (%.1f млн/с)\n", result->generation_time,
+               (result->generation_time > 0) ? scenario->n / result->generation_time / 1e6 : 0.0);
+    }
+    if (result->has_bootstrap) {
+        const BootstrapResult *boot = &result->bootstrap;
+        printf("  Бутстрэп (B=%d, %.0f%%):", boot->replicates, 100 * boot->confidence);
+        for (int s = 0; s < BOOT_STATISTICS; s++) {
+            printf(" %s [%.4f, %.4f]%s", STATISTIC_NAMES[s], boot->lower[s], boot->upper[s],
+                   (s + 1 < BOOT_STATISTICS) ? "," : "\n");
+        }
+    }
+    if (result->has_gof) {
+        const GofReport *gof = &result->gof;
+        printf("  Согласие: KS D=%.5f p=%.4f; AD A2=%.4f p=%.4f; хи-квадрат %.2f (%d интервалов) p=%.4f\n",
+               gof->ks_statistic, gof->ks_p_value, gof->ad_statistic, gof->ad_p_value,
+               gof->chi2_statistic, gof->chi2_bins, gof->chi2_p_value);
+    }
+    if (result->plot_status == 0) {
+        printf("  График: data/plot_data_%s.bin\n", scenario->name);
+    }
+    printf("  Время: %.4f с\n", result->total_time);
+}
+
+// Число для CSV/JSON: пусто (null) для отсутствующих и нечисловых значений
+static void print_number(double value, int present, const char *missing) {
+    if (present && isfinite(value)) {
+        printf("%.17g", value);
+    } else {
+        printf("%s", missing);
+    }
+}
+
+static void print_csv(CliSession *session, const CliScenario *scenario, const CliResult *result) {
+    if (session->rows == 0) {
+        printf("case,dist,mu1,lambda1,v1,mu2,lambda2,v2,p,n,seed,generation_seconds,total_seconds");
+        for (int s = 0; s < BOOT_STATISTICS; s++) printf(",theory_%s", STATISTIC_NAMES[s]);
+        for (int s = 0; s < BOOT_STATISTICS; s++) printf(",sample_%s", STATISTIC_NAMES[s]);
+        for (int s = 0; s < BOOT_STATISTICS; s++) printf(",%s_lower,%s_upper", STATISTIC_NAMES[s], STATISTIC_NAMES[s]);
+        printf(",ks_statistic,ks_p_value,ad_statistic,ad_p_value,chi2_statistic,chi2_bins,chi2_p_value\n");
+    }
+
+    const MixtureParams *p = &scenario->params;
+    int has_sample = scenario->n > 0;
+    printf("%s,%s", scenario->name, scenario->is_mixture ? "mixture" : "main");
+    double params[7] = {p->mu1, p->lambda1, p->v1, p->mu2, p->lambda2, p->v2, p->p};
+    for (int k = 0; k < 7; k++) {
+        printf(",");
+        print_number(params[k], scenario->is_mixture || k < 3, "");
+    }
+    printf(",%d,%llu,", scenario->n, (unsigned long long)scenario->seed);
+    print_number(result->generation_time, has_sample, "");
+    printf(",");
+    print_number(result->total_time, 1, "");
+    for (int s = 0; s < BOOT_STATISTICS; s++) {
+        printf(",");
+        print_number(result->theory[s], 1, "");
+    }
+    for (int s = 0; s < BOOT_STATISTICS; s++) {
+        printf(",");
+        print_number(result->sample[s], has_sample, "");
+    }
+    for (int s = 0; s < BOOT_STATISTICS; s++) {
+        printf(",");
+        print_number(result->bootstrap.lower[s], result->has_bootstrap, "");
+        printf(",");
+        print_number(result->bootstrap.upper[s], result->has_bootstrap, "");
+    }
+    const GofReport *gof = &result->gof;
+    double gof_values[7] = {gof->ks_statistic, gof->ks_p_value, gof->ad_statistic, gof->ad_p_value,
+                            gof->chi2_statistic, gof->chi2_bins, gof->chi2_p_value};
+    for (int k = 0; k < 7; k++) {
+        printf(",");
+        print_number(gof_values[k], result->has_gof, "");
+    }
+    printf("\n");
+}
+
+static void print_json(const CliScenario *scenario, const CliResult *result) {
+    const MixtureParams *p = &scenario->params;
+    int has_sample = scenario->n > 0;
+    // Имя сценария не содержит кавычек, обратной косой черты и запятых (проверяется при разборе)
+    printf("{\"case\":\"%s\",\"dist\":\"%s\",\"params\":{", scenario->name, scenario->is_mixture ? "mixture" : "main");
+    const char *param_names[7] = {"mu1", "lambda1", "v1", "mu2", "lambda2", "v2", "p"};
+    double params[7] = {p->mu1, p->lambda1, p->v1, p->mu2, p->lambda2, p->v2, p->p};
+    int count = scenario->is_mixture ? 7 : 3;
+    for (int k = 0; k < count; k++) {
+        printf("%s\"%s\":", (k > 0) ? "," : "", param_names[k]);
+        print_number(params[k], 1, "null");
+    }
+    printf("},\"n\":%d,\"seed\":%llu,\"generation_seconds\":", scenario->n, (unsigned long long)scenario->seed);
+    print_number(result->generation_time, has_sample, "null");
+    printf(",\"total_seconds\":");
+    print_number(result->total_time, 1, "null");
+
+    printf(",\"theory\":{");
+    for (int s = 0; s < BOOT_STATISTICS; s++) {
+        printf("%s\"%s\":", (s > 0) ? "," : "", STATISTIC_NAMES[s]);
+        print_number(result->theory[s], 1, "null");
+    }
+    printf("}");
+    if (has_sample) {
+        printf(",\"sample\":{");
+        for (int s = 0; s < BOOT_STATISTICS; s++) {
+            printf("%s\"%s\":", (s > 0) ? "," : "", STATISTIC_NAMES[s]);
+            print_number(result->sample[s], 1, "null");
+        }
+        printf("}");
+    }
+    if (result->has_bootstrap) {
+        const BootstrapResult *boot = &result->bootstrap;
+        printf(",\"bootstrap\":{\"replicates\":%d,\"confidence\":%g", boot->replicates, boot->confidence);
+        for (int s = 0; s < BOOT_STATISTICS; s++) {
+            printf(",\"%s\":{\"lower\":", STATISTIC_NAMES[s]);
+            print_number(boot->lower[s], 1, "null");
+            printf(",\"upper\":");
+            print_number(boot->upper[s], 1, "null");
+            printf(",\"std_error\":");
+            print_number(boot->std_error[s], 1, "null");
+            printf("}");
+        }
+        printf("}");
+    }
+    if (result->has_gof) {
+        const GofReport *gof = &result->gof;
+        printf(",\"gof\":{\"ks_statistic\":");
+        print_number(gof->ks_statistic, 1, "null");
+        printf(",\"ks_p_value\":");
+        print_number(gof->ks_p_value, 1, "null");
+        printf(",\"ad_statistic\":");
+        print_number(gof->ad_statistic, 1, "null");
+        printf(",\"ad_p_value\":");
+        print_number(gof->ad_p_value, 1, "null");
+        printf(",\"chi2_statistic\":");
+        print_number(gof->chi2_statistic, 1, "null");
+        printf(",\"chi2_bins\":%d,\"chi2_p_value\":", gof->chi2_bins);
+        print_number(gof->chi2_p_value, 1, "null");
+        printf("}");
+    }
+    if (result->plot_status == 0) {
+        printf(",\"plot\":\"data/plot_data_%s.bin\"", scenario->name);
+    }
+    printf("}\n");
+}
+
+static int execute_scenario(CliSession *session, CliScenario *scenario, int index) {
+    if (scenario->name[0] == '\0') {
+        snprintf(scenario->name, sizeof(scenario->name), "scenario%d", index);
+    }
+    CliResult result;
+    int status = run_scenario(session, scenario, &result);
+    if (status >= 0) {
+        switch (session->format) {
+            case CLI_TEXT:
+                print_text(scenario, &result);
+                break;
+            case CLI_CSV:
+                print_csv(session, scenario, &result);
+                break;
+            case CLI_JSON:
+                print_json(scenario, &result);
+                break;
+        }
+        session->rows++;
+    }
+    fflush(stdout);
+    return status;
+}
+
+// --- ПАКЕТ СЦЕНАРИЕВ ---
+
+static int run_batch(CliSession *session, const char *path, const CliScenario *defaults) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Не удалось открыть файл пакета %s\n", path);
+        return 1;
+    }
+
+    char line[CLI_LINE_LENGTH];
+    int line_number = 0;
+    int index = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char where[64];
+        snprintf(where, sizeof(where), "%s:%d", path, line_number);
+        if (strchr(line, '\n') == NULL && !feof(file)) {
+            fprintf(stderr, "%s: строка длиннее %d символов\n", where, CLI_LINE_LENGTH - 1);
+            failed = 1;
+            // Остаток длинной строки пропускается
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n') {}
+            continue;
+        }
+
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char *tokens[CLI_MAX_TOKENS];
+        int count = 0;
+        int overflow = 0;
+        char *cursor = line;
+        while (*cursor) {
+            while (*cursor && isspace((unsigned char)*cursor)) cursor++;
+            if (!*cursor) break;
+            if (count == CLI_MAX_TOKENS) {
+                overflow = 1;
+                break;
+            }
+            tokens[count++] = cursor;
+            while (*cursor && !isspace((unsigned char)*cursor)) cursor++;
+            if (*cursor) *cursor++ = '\0';
+        }
+        if (count == 0) continue;
+
+        index++;
+        CliScenario scenario = *defaults;
+        if (overflow) {
+            fprintf(stderr, "%s: больше %d аргументов\n", where, CLI_MAX_TOKENS);
+            failed = 1;
+            continue;
+        }
+        scenario.seed_set = 0;
+        if (parse_arguments(count, tokens, &scenario, NULL, where) != 0) {
+            failed = 1;
+            continue;
+        }
+        if (!scenario.seed_set) {
+            scenario.seed = defaults->seed + (uint64_t)(index - 1);
+        }
+        if (execute_scenario(session, &scenario, index) != 0) {
+            failed = 1;
+        }
+    }
+    fclose(file);
+    return failed;
+}
+
+// --- ТОЧКА ВХОДА ---
+
+int run_cli(int argc, char **argv) {
+    CliScenario defaults;
+    default_scenario(&defaults);
+    CliGlobal global = {0, CLI_TEXT, NULL, 0};
+    if (parse_arguments(argc - 1, argv + 1, &defaults, &global, "spreadings") != 0) {
+        print_usage(stderr);
+        return 2;
+    }
+    if (global.help) {
+        print_usage(stdout);
+        return 0;
+    }
+
+    CliSession session;
+    memset(&session, 0, sizeof(session));
+    session.format = global.format;
+    session.pool = create_thread_pool(global.threads);
+    if (session.pool == NULL) {
+        fprintf(stderr, "Не удалось создать пул потоков\n");
+        return 1;
+    }
+
+    int status;
+    if (global.batch != NULL) {
+        status = run_batch(&session, global.batch, &defaults);
+    } else {
+        status = (execute_scenario(&session, &defaults, 1) == 0) ? 0 : 1;
+    }
+
+    for (int k = 0; k < session.cached; k++) {
+        free_prepared(&session.cache[k]);
+    }
+    free(session.sample);
+    free(session.resampled);
+    free_thread_pool(session.pool);
+    return status;
+}
@@ -0,0 +1,36 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include "distributions.h"
+#include "parallel.h"
+
+// --- РЕЖИМ КОМАНДНОЙ СТРОКИ ---
+// Неинтерактивный запуск без меню: один сценарий по флагам или пакет сценариев из файла.
+// Сценарий: распределение и параметры, объем выборки n и seed; для выборки считаются
+// выборочные моменты (и теоретические для сравнения), по желанию - данные графика,
+// бутстрэп-интервалы моментов и критерии согласия.
+//
+//   spreadings --dist main --mu 0 --lambda 1 --v 1 --n 1000000 --seed 7 --gof
+//   spreadings --dist mixture --mu -3 --mu2 3 --p 0.3 --n 10000 --plot --case 3.3.1.2
+//   spreadings --batch data/batch_plots.txt --threads 4 --format csv
+//
+// Файл пакета: по сценарию на строку, в строке - те же флаги сценария; '#' начинает комментарий.
+// Флаги сценария из командной строки служат значениями по умолчанию для всех строк пакета.
+// Без явного --seed сценарий k пакета (с 1) получает seed + k - 1. Выборка однозначно
+// определяется seed и числом потоков (см. generate_main_parallel).
+// Пул потоков, буферы выборок и подготовленные распределения (константы, смеси, таблицы
+// функции распределения для критериев согласия) создаются один раз и переиспользуются
+// сценариями с теми же параметрами.
+// Форматы вывода: text - для чтения, csv - строка на сценарий с заголовком,
+// json - объект на строку (JSON Lines). Ошибки пишутся в stderr.
+
+/**
+ * @brief Выполняет программу в режиме командной строки.
+ * @param argc Число аргументов (как в main).
+ * @param argv Аргументы (как в main).
+ * @return Код завершения: 0 - все сценарии выполнены, 1 - ошибка в сценарии,
+ *         2 - некорректные аргументы.
+ */
+int run_cli(int argc, char **argv);
+
+#endif
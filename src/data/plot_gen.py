@@ -3,8 +3,60 @@ import matplotlib.pyplot as plt
 import glob
 import os
 
+# Заголовок двоичного файла (128 байт) - см. PlotFileHeader в plot_io.h.
+# Порядок байт полей заголовка тот же, что у столбцов: первый символ поля dtype ('<' или '>')
+def plot_header_dtype(byte_order):
+    return np.dtype([
+        ('magic', 'S8'),
+        ('version', byte_order + 'u4'),
+        ('dtype', 'S4'),
+        ('points_count', byte_order + 'i8'),
+        ('empirical_size', byte_order + 'i8'),
+        ('x_offset', byte_order + 'u8'),
+        ('y_offset', byte_order + 'u8'),
+        ('empirical_offset', byte_order + 'u8'),
+        ('title', 'S72'),
+    ])
+
+def read_plot_data_binary(filename):
+    """Читает двоичный файл графика: столбцы отображаются в память через np.memmap, без разбора текста"""
+    # magic и dtype - байтовые строки, их можно прочитать до того, как известен порядок байт
+    raw = np.fromfile(filename, dtype=plot_header_dtype('<'), count=1)
+    if len(raw) != 1 or raw[0]['magic'] != b'SHPLOT':
+        raise ValueError(f"{filename}: неверный формат файла")
+    byte_order = raw[0]['dtype'][:1].decode()
+    if byte_order not in ('<', '>'):
+        raise ValueError(f"{filename}: неизвестный порядок байт {raw[0]['dtype']!r}")
+    header = np.fromfile(filename, dtype=plot_header_dtype(byte_order), count=1)[0]
+    if header['version'] != 1:
+        raise ValueError(f"{filename}: неподдерживаемая версия {header['version']}")
+    
+    dtype = np.dtype(header['dtype'].decode())
+    points_count = int(header['points_count'])
+    empirical_size = int(header['empirical_size'])
+    
+    def column(offset, count):
+        if count == 0:
+            return np.empty(0, dtype=dtype)
+        return np.memmap(filename, dtype=dtype, mode='r', offset=int(offset), shape=(count,))
+    
+    return {
+        'title': header['title'].decode('utf-8', errors='replace'),
+        'theoretical_x': column(header['x_offset'], points_count),
+        'theoretical_y': column(header['y_offset'], points_count),
+        'empirical_data': column(header['empirical_offset'], empirical_size),
+        'points_count': points_count,
+        'empirical_size': empirical_size
+    }
+
 def read_plot_data(filename):
-    """Читает данные из файла, сгенерированного C программой"""
+    """Читает данные из файла, сгенерированного C программой (.bin - двоичный, иначе текстовый)"""
+    if filename.endswith('.bin'):
+        return read_plot_data_binary(filename)
+    return read_plot_data_text(filename)
+
+def read_plot_data_text(filename):
+    """Читает данные из текстового файла старого формата"""
     theoretical_x = []
     theoretical_y = []
     empirical_data = []
@@ -96,8 +148,9 @@ def main():
     """Основная функция для генерации всех графиков"""
     print("Поиск файлов с данными...")
     
-    # Ищем все файлы с данными
-    data_files = glob.glob("plot_data_*.txt")
+    # Ищем все файлы с данными: двоичные, а текстовые - только если двоичного варианта нет
+    data_files = glob.glob("plot_data_*.bin")
+    data_files += [f for f in glob.glob("plot_data_*.txt") if f[:-4] + ".bin" not in data_files]
     
     if not data_files:
         print("Файлы с данными не найдены!")
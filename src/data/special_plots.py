@@ -1,56 +1,49 @@
 import numpy as np
 import matplotlib.pyplot as plt
 import os
-from scipy.stats import gaussian_kde
 import scipy.stats as stats
 
-def read_plot_data(filename):
-    """Читает данные из файла, сгенерированного C программой"""
-    theoretical_x = []
-    theoretical_y = []
-    empirical_data = []
-    
-    with open(filename, 'r') as f:
-        lines = f.readlines()
-    
-    # Парсим метаданные
-    title = lines[0].strip('# \n')
-    points_count = int(lines[1].split(':')[1].strip())
-    empirical_size = int(lines[2].split(':')[1].strip())
-    
-    # Читаем теоретические данные
-    theoretical_section = False
-    empirical_section = False
-    
-    for line in lines[3:]:
-        line = line.strip()
-        if not line:
-            continue
-            
-        if line.startswith('# empirical_data:'):
-            empirical_section = True
-            theoretical_section = False
-            continue
-            
-        if empirical_section:
-            if line and not line.startswith('#'):
-                empirical_data.append(float(line))
-        else:
-            if line and not line.startswith('#'):
-                parts = line.split()
-                if len(parts) >= 2:
-                    theoretical_x.append(float(parts[0]))
-                    theoretical_y.append(float(parts[1]))
-                    theoretical_section = True
-    
-    return {
-        'title': title,
-        'theoretical_x': np.array(theoretical_x),
-        'theoretical_y': np.array(theoretical_y),
-        'empirical_data': np.array(empirical_data),
-        'points_count': points_count,
-        'empirical_size': empirical_size
-    }
+from plot_gen import read_plot_data
+
+def silverman_bandwidth(sample):
+    """Ширина окна по правилу Сильвермана (как kde_bandwidth в kde.c)"""
+    q1, q3 = np.percentile(sample, [25, 75])
+    scale = np.std(sample, ddof=1)
+    if 0 < (q3 - q1) / 1.349 < scale:
+        scale = (q3 - q1) / 1.349
+    return 0.9 * scale * len(sample) ** -0.2
+
+def binned_kde(sample, x, bandwidth=None, grid_size=4096):
+    """Ядерная оценка с нормальным ядром на сетке (как build_kernel_density в kde.c):
+    линейное разбиение выборки по узлам, свертка с ядром через БПФ, интерполяция в точки x.
+    Стоит O(n + m log m) вместо O(n * len(x)) у scipy.stats.gaussian_kde"""
+    sample = np.asarray(sample, dtype=float)
+    h = silverman_bandwidth(sample) if bandwidth is None else bandwidth
+    lo, hi = sample.min() - 4 * h, sample.max() + 4 * h
+    step = (hi - lo) / (grid_size - 1)
+    
+    # Линейное разбиение
+    position = (sample - lo) / step
+    index = np.minimum(position.astype(np.int64), grid_size - 2)
+    fraction = position - index
+    counts = (np.bincount(index, weights=1 - fraction, minlength=grid_size) +
+              np.bincount(index + 1, weights=fraction, minlength=grid_size))
+    
+    # Ядро на смещениях -reach..reach и свертка без заворачивания
+    reach = min(grid_size - 1, int(np.ceil(6 * h / step)))
+    offsets = np.arange(-reach, reach + 1) * step / h
+    kernel = np.exp(-0.5 * offsets ** 2) / (np.sqrt(2 * np.pi) * h * len(sample))
+    size = 1 << int(np.ceil(np.log2(grid_size + 2 * reach + 1)))
+    density = np.fft.irfft(np.fft.rfft(counts, size) * np.fft.rfft(kernel, size), size)
+    density = np.maximum(density[reach:reach + grid_size], 0)
+    
+    grid = lo + step * np.arange(grid_size)
+    return np.interp(x, grid, density, left=0, right=0)
+
+def plot_data_file(name):
+    """Имя файла данных теста: двоичный, если есть, иначе текстовый"""
+    binary = f"plot_data_{name}.bin"
+    return binary if os.path.exists(binary) else f"plot_data_{name}.txt"
 
 def create_mega_plot_332():
     """Мега сложный график для теста 3.3.2 с тремя распределениями"""
@@ -61,9 +54,9 @@ def create_mega_plot_332():
     
     # Читаем все три распределения
     try:
-        main_data = read_plot_data("plot_data_3.3.2_main.txt")
-        empirical_main_data = read_plot_data("plot_data_3.3.2_empirical_main.txt")
-        empirical_bootstrap_data = read_plot_data("plot_data_3.3.2_empirical_bootstrap.txt")
+        main_data = read_plot_data(plot_data_file("3.3.2_main"))
+        empirical_main_data = read_plot_data(plot_data_file("3.3.2_empirical_main"))
+        empirical_bootstrap_data = read_plot_data(plot_data_file("3.3.2_empirical_bootstrap"))
     except FileNotFoundError as e:
         print(f"Ошибка: {e}")
         print("Сначала запусти C программу для генерации данных!")
@@ -77,17 +70,15 @@ def create_mega_plot_332():
              'b-', linewidth=3, label='Теоретическое основное f(x)', alpha=0.8)
     
     # 2. KDE из выборки основного распределения
+    kde_x = np.linspace(-4, 4, 200)
     if len(empirical_main_data['empirical_data']) > 0:
-        kde_main = gaussian_kde(empirical_main_data['empirical_data'])
-        kde_x = np.linspace(-4, 4, 200)
-        kde_y_main = kde_main(kde_x)
+        kde_y_main = binned_kde(empirical_main_data['empirical_data'], kde_x)
         ax1.plot(kde_x, kde_y_main, 'r--', linewidth=2, 
                 label='KDE из выборки основного f(x)', alpha=0.8)
     
     # 3. KDE из бутстрэп-выборки
     if len(empirical_bootstrap_data['empirical_data']) > 0:
-        kde_bootstrap = gaussian_kde(empirical_bootstrap_data['empirical_data'])
-        kde_y_bootstrap = kde_bootstrap(kde_x)
+        kde_y_bootstrap = binned_kde(empirical_bootstrap_data['empirical_data'], kde_x)
         ax1.plot(kde_x, kde_y_bootstrap, 'g:', linewidth=2, 
                 label='KDE из выборки эмпирического fe(x)', alpha=0.8)
     
@@ -149,19 +140,15 @@ def create_error_plot(main_data, empirical_main_data, empirical_bootstrap_data):
     """График ошибок между распределениями"""
     fig, ax = plt.subplots(figsize=(12, 6))
     
-    # Вычисляем KDE для обоих эмпирических распределений
-    kde_main = gaussian_kde(empirical_main_data['empirical_data'])
-    kde_bootstrap = gaussian_kde(empirical_bootstrap_data['empirical_data'])
-    
     # Общий диапазон x
     x_common = np.linspace(-4, 4, 200)
     
     # Теоретическая плотность в этих точках (интерполяция)
     theoretical_interp = np.interp(x_common, main_data['theoretical_x'], main_data['theoretical_y'])
     
-    # KDE плотности
-    kde_y_main = kde_main(x_common)
-    kde_y_bootstrap = kde_bootstrap(x_common)
+    # KDE плотности для обоих эмпирических распределений
+    kde_y_main = binned_kde(empirical_main_data['empirical_data'], x_common)
+    kde_y_bootstrap = binned_kde(empirical_bootstrap_data['empirical_data'], x_common)
     
     # Вычисляем ошибки
     error_main = np.abs(theoretical_interp - kde_y_main)
@@ -205,7 +192,7 @@ def create_special_plots():
     test_cases = ["3.3.1.1", "3.3.1.2", "3.3.1.3", "3.3.1.4"]
     
     for test_case in test_cases:
-        filename = f"plot_data_{test_case}.txt"
+        filename = plot_data_file(test_case)
         if os.path.exists(filename):
             print(f"Обработка {filename}...")
             # Можно добавить создание отдельных графиков если нужно
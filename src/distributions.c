@@ -1,4 +1,5 @@
 #include "distributions.h"
+#include "distributions_shapes.h"
 
 #include <gsl/gsl_sf_bessel.h>
 
@@ -10,302 +11,2203 @@ double bessel_k(double nu, double x) {
     return gsl_sf_bessel_Knu(nu, x);
 }
 
+double bessel_k_scaled(double nu, double x) {
+    return gsl_sf_bessel_Knu_scaled(nu, x);
+}
+
+// --- БЫСТРОЕ ВЫЧИСЛЕНИЕ ФУНКЦИЙ БЕССЕЛЯ ---
+
+#define BESSEL_CACHE_SIZE 256   // Степень двойки
+
+typedef struct {
+    double nu, x, value;
+    int used;            // 0 - пусто, 1 - K_nu(x), 2 - K_nu(x) e^x
+} BesselCacheEntry;
+
+static _Thread_local BesselCacheEntry bessel_cache[BESSEL_CACHE_SIZE];
+static _Thread_local uint64_t bessel_cache_miss_count;
+
+// kind: 1 - K_nu(x), 2 - K_nu(x) e^x
+static double bessel_cache_lookup(double nu, double x, int kind) {
+    // Ячейка выбирается по битам аргументов (прямое отображение, вытесняется старое значение).
+    // У "круглых" x ненулевые только старшие биты, поэтому перед умножением старшая половина
+    // подмешивается в младшую, а номер группы из 4 ячеек берется из старших бит произведения.
+    // Ячейка в группе - целый порядок 0..3, так что K_0..K_3 одного x друг друга не вытесняют
+    uint64_t bits_x, bits_nu;
+    memcpy(&bits_x, &x, sizeof(bits_x));
+    memcpy(&bits_nu, &nu, sizeof(bits_nu));
+    int order = (nu >= 0 && nu <= 3 && nu == (int)nu) ? (int)nu : -1;
+    uint64_t hash = bits_x + (uint64_t)(kind - 1) * 0x94D049BB133111EBULL;
+    if (order < 0) {
+        hash ^= bits_nu * 0x9E3779B97F4A7C15ULL;
+        order = 0;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    int slot = (int)((hash >> 58) << 2) | order;
+    BesselCacheEntry *entry = &bessel_cache[slot & (BESSEL_CACHE_SIZE - 1)];
+    
+    if (entry->used == kind && entry->x == x && entry->nu == nu) {
+        return entry->value;
+    }
+    bessel_cache_miss_count++;
+    entry->nu = nu;
+    entry->x = x;
+    entry->value = (kind == 1) ? bessel_k(nu, x) : bessel_k_scaled(nu, x);
+    entry->used = kind;
+    return entry->value;
+}
+
+double bessel_k_cached(double nu, double x) {
+    return bessel_cache_lookup(nu, x, 1);
+}
+
+uint64_t bessel_cache_misses(void) {
+    return bessel_cache_miss_count;
+}
+
+#define BESSEL_ORDERS 4          // nu = 0, 1, 2, 3
+#define BESSEL_DEGREE 16
+#define BESSEL_MAX_SEGMENTS 4096
+
+// Значение полинома Чебышева sum' c_k T_k(s) на [-1, 1] (схема Кленшоу)
+static double chebyshev_eval(const double *c, int degree, double s) {
+    double b1 = 0.0, b2 = 0.0;
+    for (int k = degree; k >= 1; k--) {
+        double b0 = 2.0 * s * b1 - b2 + c[k];
+        b2 = b1;
+        b1 = b0;
+    }
+    return s * b1 - b2 + 0.5 * c[0];
+}
+
+// log K_nu(x) + x по таблице; t = log x
+static double bessel_table_log_scaled(const BesselTable *table, int nu, double t) {
+    double position = (t - table->log_min) * table->inv_width;
+    int segment = (int)position;
+    if (segment >= table->segments) segment = table->segments - 1;
+    double s = 2.0 * (position - segment) - 1.0;
+    const double *c = table->coef + ((long long)nu * table->segments + segment) * (table->degree + 1);
+    return chebyshev_eval(c, table->degree, s);
+}
+
+// Заполняет коэффициенты для заданного числа частей и возвращает найденную погрешность
+static double fill_bessel_table(BesselTable *table) {
+    int n = table->degree + 1;
+    double width = 1.0 / table->inv_width;
+    double max_error = 0.0;
+    double f[BESSEL_DEGREE + 1];
+    
+    for (int nu = 0; nu < BESSEL_ORDERS; nu++) {
+        for (int segment = 0; segment < table->segments; segment++) {
+            double mid = table->log_min + (segment + 0.5) * width;
+            double *c = table->coef + ((long long)nu * table->segments + segment) * n;
+            
+            // Значения в узлах Чебышева и коэффициенты разложения
+            for (int j = 0; j < n; j++) {
+                double t = mid + 0.5 * width * cos(M_PI * (j + 0.5) / n);
+                double x = exp(t);
+                f[j] = gsl_sf_bessel_lnKnu(nu, x) + x;
+            }
+            for (int k = 0; k < n; k++) {
+                double sum = 0.0;
+                for (int j = 0; j < n; j++) {
+                    sum += f[j] * cos(M_PI * k * (j + 0.5) / n);
+                }
+                c[k] = 2.0 * sum / n;
+            }
+            
+            // Проверка посередине между соседними узлами и на краях части
+            for (int j = 0; j <= n; j++) {
+                double s = (j == n) ? 1.0 : cos(M_PI * j / n);
+                double t = mid + 0.5 * width * s;
+                double x = exp(t);
+                double exact = gsl_sf_bessel_lnKnu(nu, x) + x;
+                // Ошибка в логарифме - это относительная ошибка самой функции
+                double error = fabs(expm1(chebyshev_eval(c, table->degree, s) - exact));
+                if (!(error <= max_error)) max_error = error; // NaN тоже считается ошибкой
+            }
+        }
+    }
+    return max_error;
+}
+
+BesselTable* build_bessel_table(double x_min, double x_max, double tolerance) {
+    if (!(x_min > 0) || !(x_max > x_min) || !(tolerance > 0)) {
+        return NULL;
+    }
+    
+    BesselTable *table = (BesselTable*)calloc(1, sizeof(BesselTable));
+    if (!table) return NULL;
+    table->x_min = x_min;
+    table->x_max = x_max;
+    table->degree = BESSEL_DEGREE;
+    table->log_min = log(x_min);
+    
+    // Начинаем с одной части на единицу log x и удваиваем, пока не достигнута точность
+    int segments = (int)ceil(log(x_max) - log(x_min));
+    if (segments < 1) segments = 1;
+    for (; segments <= BESSEL_MAX_SEGMENTS; segments *= 2) {
+        free(table->coef);
+        table->segments = segments;
+        table->inv_width = segments / (log(x_max) - table->log_min);
+        table->coef = (double*)malloc((long long)BESSEL_ORDERS * segments * (BESSEL_DEGREE + 1) * sizeof(double));
+        if (!table->coef) break;
+        table->max_rel_error = fill_bessel_table(table);
+        // Запас в 2 раза на точки, не попавшие в проверку
+        if (table->max_rel_error <= 0.5 * tolerance) {
+            return table;
+        }
+    }
+    
+    free_bessel_table(table);
+    return NULL;
+}
+
+double bessel_table_k(const BesselTable *table, double nu, double x) {
+    int order = (int)nu;
+    if (table == NULL || order != nu || order < 0 || order >= BESSEL_ORDERS ||
+        !(x >= table->x_min && x <= table->x_max)) {
+        return bessel_k_cached(nu, x);
+    }
+    return exp(bessel_table_log_scaled(table, order, log(x)) - x);
+}
+
+void free_bessel_table(BesselTable *table) {
+    if (table) {
+        free(table->coef);
+        free(table);
+    }
+}
+
+static const BesselTable *active_bessel_table = NULL;
+
+void use_bessel_table(const BesselTable *table) {
+    active_bessel_table = table;
+}
+
+double bessel_k_fast(double nu, double x) {
+    if (active_bessel_table) {
+        return bessel_table_k(active_bessel_table, nu, x);
+    }
+    return bessel_k_cached(nu, x);
+}
+
+// K_nu(x) e^x: таблица хранит как раз его логарифм, иначе - кэш
+static double bessel_k_scaled_fast(double nu, double x) {
+    const BesselTable *table = active_bessel_table;
+    int order = (int)nu;
+    if (table && order == nu && order >= 0 && order < BESSEL_ORDERS && x >= table->x_min && x <= table->x_max) {
+        return exp(bessel_table_log_scaled(table, order, log(x)));
+    }
+    return bessel_cache_lookup(nu, x, 2);
+}
+
+// --- СПЕЦИАЛИЗАЦИИ ДЛЯ ФИКСИРОВАННЫХ v ---
+// Для v из списка SH_FIXED_SHAPES (distributions_shapes.h, создается gen_shapes.c) функции
+// Бесселя, нормировка и границы отбора GIG - константы времени компиляции, а плотность
+// и цикл генерации собираются отдельно для каждого v, так что v тоже подставляется константой.
+// Выбор ядра - точное сравнение v со списком; для остальных v работает общий путь.
+// Границы отбора те же, что дает prepare_gig_sampler, поэтому выборки совпадают с общим путем
+// до бита. Функции Бесселя в константах округлены правильно, а общий путь берет их из GSL,
+// так что плотности и моменты могут отличаться в последнем знаке.
+
+typedef enum {
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) SHAPE_##id,
+    SH_FIXED_SHAPES(X)
+#undef X
+    SHAPE_GENERIC        // v не из списка
+} FixedShapeId;
+
+typedef struct {
+    double k1, k2, k3;   // K_1(v), K_2(v), K_3(v)
+    double norm;         // 1 / (2 sqrt(v) K_1(v))
+    GIGSampler gig;
+} FixedShape;
+
+static const FixedShape fixed_shapes[] = {
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+    { k1, k2, k3, norm, { v, 0.25 * (v), -0.5 * (v), shift, u_min, u_max } },
+    SH_FIXED_SHAPES(X)
+#undef X
+    { 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0 } } // SHAPE_GENERIC: не используется (список может быть пустым)
+};
+
+static inline FixedShapeId fixed_shape(double v) {
+    (void)v;
+#define X(id, v_, k1, k2, k3, norm, shift, u_min, u_max) if (v == (v_)) return SHAPE_##id;
+    SH_FIXED_SHAPES(X)
+#undef X
+    return SHAPE_GENERIC;
+}
+
+void bessel_k_ratios(double v, double *k1_over_k2, double *k3_over_k2) {
+    double k1, k2, k3;
+    FixedShapeId shape = fixed_shape(v);
+    if (shape != SHAPE_GENERIC) {
+        k1 = fixed_shapes[shape].k1;
+        k2 = fixed_shapes[shape].k2;
+        k3 = fixed_shapes[shape].k3;
+    } else {
+        // Множитель e^v у всех трех одинаков и в отношениях сокращается
+        k1 = bessel_k_scaled_fast(1.0, v);
+        k2 = bessel_k_scaled_fast(2.0, v);
+        k3 = bessel_k_scaled_fast(3.0, v);
+    }
+    if (k1_over_k2) *k1_over_k2 = k1 / k2;
+    if (k3_over_k2) *k3_over_k2 = k3 / k2;
+}
+
+// Плотность: те же операции, что и в pdf_main, с v и нормировкой в виде констант
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+    static double pdf_main_##id(double x, double mu, double lambda_) { \
+        double x_standard = (x - mu) / lambda_; \
+        return (1.0 / lambda_) * (norm) * exp(-(v) * sqrt(1 + (x_standard * x_standard) / (v))); \
+    }
+SH_FIXED_SHAPES(X)
+#undef X
+
 // --- ОСНОВНОЕ РАСПРЕДЕЛЕНИЕ (СГР) ---
 
 double pdf_main(double x, double mu, double lambda_, double v) {
+    switch (fixed_shape(v)) {
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+        case SHAPE_##id: return pdf_main_##id(x, mu, lambda_);
+        SH_FIXED_SHAPES(X)
+#undef X
+        case SHAPE_GENERIC: break;
+    }
+    
     // ПРАВИЛЬНАЯ формула с учетом сдвиг-масштаба
     double x_standard = (x - mu) / lambda_;
-    double z = 1 / (2 * sqrt(v) * bessel_k(1, v));  // ← Используем bessel_k вместо kn
+    double z = 1 / (2 * sqrt(v) * bessel_k_fast(1, v));  // ← Используем bessel_k вместо kn
     double exp_arg = -v * sqrt(1 + (x_standard * x_standard) / v);
     return (1.0 / lambda_) * z * exp(exp_arg);
 }
 
-void moments_main(double mu, double lambda, double v, double *mean, double *variance, double *skewness, double *kurtosis) {
-    // Проверка корректности параметров
-    if (lambda <= 0 || v <= 0) {
-        if (mean) *mean = 0;
-        if (variance) *variance = 0;
-        if (skewness) *skewness = 0;
-        if (kurtosis) *kurtosis = 0;
-        return;
+void moments_main(double mu, double lambda, double v, double *mean, double *variance, double *skewness, double *kurtosis) {
+    // Проверка корректности параметров
+    if (lambda <= 0 || v <= 0) {
+        if (mean) *mean = 0;
+        if (variance) *variance = 0;
+        if (skewness) *skewness = 0;
+        if (kurtosis) *kurtosis = 0;
+        return;
+    }
+    
+    // Математическое ожидание: M = mu
+    if (mean) *mean = mu;
+    
+    // Для симметричного гиперболического распределения:
+    // Асимметрия всегда равна 0 (распределение симметричное)
+    if (skewness) *skewness = 0.0;
+    
+    // Вычисляем дисперсию и эксцесс по формулам из варианта (через отношения функций Бесселя)
+    double k1_over_k2, k3_over_k2;
+    bessel_k_ratios(v, &k1_over_k2, &k3_over_k2);
+    
+    // Дисперсия: D = lambda^2 * (K_2(v) / K_1(v))
+    if (variance) {
+        *variance = lambda * lambda / k1_over_k2;
+    }
+    
+    // Эксцесс: γ₂ = 3 * K_3(v) * K_1(v) / (K_2(v))^2 - 3
+    if (kurtosis) {
+        *kurtosis = 3.0 * k3_over_k2 * k1_over_k2 - 3.0;
+    }
+}
+
+// Вспомогательная функция для генерации равномерного распределения
+double uniform_random() {
+    return uniform_random_r(rng_default());
+}
+
+double uniform_random_r(RngState *rng) {
+    return rng_uniform(rng);
+}
+
+// Вспомогательная функция для генерации стандартной нормальной величины.
+// Раньше здесь был Бокс-Мюллер (log, sqrt и cos на каждый вызов, вторая величина терялась),
+// теперь - табличный метод зиккурата из rng.c.
+double normal_random() {
+    return normal_random_r(rng_default());
+}
+
+double normal_random_r(RngState *rng) {
+    return rng_normal(rng);
+}
+
+void normal_random_n(double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    rng_normal_n(rng ? rng : rng_default(), out, n);
+}
+
+// --- ГЕНЕРАЦИЯ ОБОБЩЕННОГО ОБРАТНОГО ГАУССОВСКОГО (GIG) РАСПРЕДЕЛЕНИЯ ---
+// СГР - это нормальная смесь: X = mu + lambda * sqrt(W) * Z, Z ~ N(0, 1),
+// а W имеет плотность, пропорциональную exp(-v/2 * (w + 1/w)), т.е. GIG(1, v, v).
+// W генерируется методом отношения равномерных (Hörmann, Leydold, 2014):
+// точка (U, V) равномерно выбирается в прямоугольнике, X = U/V + сдвиг принимается,
+// если V^2 <= g(X) / g(моды). Число попыток в среднем ограничено сверху для любых v.
+
+void prepare_gig_sampler(GIGSampler *gig, double omega) {
+    // Для порядка 1 мода g(x) = exp(-omega/2 * (x + 1/x)) всегда в точке x = 1
+    gig->omega = omega;
+    gig->s = 0.25 * omega;
+    gig->nc = -0.5 * omega; // log(sqrt(g(1)))
+    
+    if (omega > 3.0) {
+        // Со сдвигом на моду: границы по U - экстремумы (x - 1) * sqrt(g(x)),
+        // корни кубического уравнения y^3 + a*y^2 + b*y + c = 0 (формула Кардано)
+        double a = -(4.0 / omega + 1.0);
+        double b = -1.0;
+        double c = 1.0;
+        double p = b - a * a / 3.0;
+        double q = (2.0 * a * a * a) / 27.0 - (a * b) / 3.0 + c;
+        double fi = acos(-q / (2.0 * sqrt(-(p * p * p) / 27.0)));
+        double fak = 2.0 * sqrt(-p / 3.0);
+        double y1 = fak * cos(fi / 3.0) - a / 3.0;
+        double y2 = fak * cos(fi / 3.0 + 4.0 / 3.0 * M_PI) - a / 3.0;
+        
+        gig->shift = 1.0;
+        gig->u_min = (y2 - 1.0) * exp(-gig->s * (y2 + 1.0 / y2) - gig->nc);
+        gig->u_max = (y1 - 1.0) * exp(-gig->s * (y1 + 1.0 / y1) - gig->nc);
+    } else {
+        // Без сдвига: правая граница - максимум x * sqrt(g(x)),
+        // положительный корень omega/2 * y^2 - 2 * y - omega/2 = 0
+        double ym = (2.0 + sqrt(4.0 + omega * omega)) / omega;
+        
+        gig->shift = 0.0;
+        gig->u_min = 0.0;
+        gig->u_max = ym * exp(-gig->s * (ym + 1.0 / ym) - gig->nc);
+    }
+}
+
+// Одна попытка отбора по двум равномерным величинам на (0, 1); при успехе пишет значение в *x
+static inline int gig_try(const GIGSampler *gig, double r1, double r2, double *x) {
+    double u = gig->u_min + (gig->u_max - gig->u_min) * r1;
+    *x = u / r2 + gig->shift;
+    return *x > 0.0 && log(r2) <= -gig->s * (*x + 1.0 / *x) - gig->nc;
+}
+
+double generate_gig_r(const GIGSampler *gig, RngState *rng) {
+    double x;
+    while (!gig_try(gig, rng_uniform_open(rng), rng_uniform_open(rng), &x)) {
+    }
+    return x;
+}
+
+// Буфер равномерных величин на (0, 1): генератор заполняет его пачками, цикл отбора только читает
+#define UNIFORM_BATCH 256
+
+typedef struct {
+    double u[UNIFORM_BATCH];
+    int pos, count;
+    RngState *rng;
+    SamplerStats *stats;     // Подключенная статистика или NULL
+} UniformBuffer;
+
+static void init_uniform_buffer(UniformBuffer *ub, RngState *rng, SamplerStats *stats) {
+    ub->pos = 0;
+    ub->count = 0;
+    ub->rng = rng;
+    ub->stats = stats;
+}
+
+// hint - сколько величин, скорее всего, еще понадобится (чтобы не генерировать лишнего)
+static inline double next_uniform(UniformBuffer *ub, long long hint) {
+    if (ub->pos == ub->count) {
+        int count = (hint > 0 && hint < UNIFORM_BATCH) ? (int)hint : UNIFORM_BATCH;
+        for (int i = 0; i < count; i++) {
+            ub->u[i] = rng_uniform_open(ub->rng);
+        }
+        ub->pos = 0;
+        ub->count = count;
+        if (ub->stats) ub->stats->rng_draws += (uint64_t)count;
+    }
+    return ub->u[ub->pos++];
+}
+
+// --- СТАТИСТИКА ГЕНЕРАТОРА ---
+
+static _Thread_local SamplerStats *attached_stats;
+
+void init_sampler_stats(SamplerStats *stats) {
+    memset(stats, 0, sizeof(SamplerStats));
+}
+
+void merge_sampler_stats(SamplerStats *target, const SamplerStats *source) {
+    target->values += source->values;
+    target->proposals += source->proposals;
+    target->acceptances += source->acceptances;
+    if (source->max_attempts > target->max_attempts) {
+        target->max_attempts = source->max_attempts;
+    }
+    for (int k = 0; k < SAMPLER_HISTOGRAM_SIZE; k++) {
+        target->attempts_histogram[k] += source->attempts_histogram[k];
+    }
+    target->rng_draws += source->rng_draws;
+}
+
+SamplerStats* attach_sampler_stats(SamplerStats *stats) {
+    SamplerStats *previous = attached_stats;
+    attached_stats = stats;
+    return previous;
+}
+
+double sampler_acceptance_rate(const SamplerStats *stats) {
+    return (stats->proposals > 0) ? (double)stats->acceptances / (double)stats->proposals : 0.0;
+}
+
+// Учет одного принятого значения, потребовавшего attempts попыток
+static void record_attempts(SamplerStats *stats, uint64_t attempts) {
+    stats->values++;
+    stats->proposals += attempts;
+    stats->acceptances++;
+    if (attempts > stats->max_attempts) {
+        stats->max_attempts = attempts;
+    }
+    int bucket = (attempts < SAMPLER_HISTOGRAM_SIZE) ? (int)attempts - 1 : SAMPLER_HISTOGRAM_SIZE - 1;
+    stats->attempts_histogram[bucket]++;
+}
+
+// --- ГЕНЕРАЦИЯ ОСНОВНОГО РАСПРЕДЕЛЕНИЯ ---
+
+// Одно значение основного распределения; gig подготовлен для v один раз на всю выборку,
+// remaining - сколько значений осталось сгенерировать
+static inline double draw_main(const GIGSampler *gig, double mu, double lambda, UniformBuffer *ub, long long remaining) {
+    double w;
+    uint64_t attempts = 0;
+    
+    // Отбор без ограничения числа попыток: вероятность принятия не меньше ~0.5 при любом v
+    for (;;) {
+        double r1 = next_uniform(ub, 2 * remaining);
+        double r2 = next_uniform(ub, 2 * remaining);
+        attempts++;
+        if (gig_try(gig, r1, r2, &w)) {
+            break;
+        }
+    }
+    
+    double z;
+    if (ub->stats) {
+        record_attempts(ub->stats, attempts);
+        z = rng_normal_counted(ub->rng, &ub->stats->rng_draws);
+    } else {
+        z = normal_random_r(ub->rng);
+    }
+    double x_standard = z * sqrt(w);
+    
+    return mu + lambda * x_standard;
+}
+
+// Цикл генерации для фиксированного v: границы отбора - константы из fixed_shapes
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+    static void generate_main_##id(double mu, double lambda, double *out, int n, UniformBuffer *ub) { \
+        for (int i = 0; i < n; i++) { \
+            out[i] = draw_main(&fixed_shapes[SHAPE_##id].gig, mu, lambda, ub, n - i); \
+        } \
+    }
+SH_FIXED_SHAPES(X)
+#undef X
+
+double generate_main(double mu, double lambda, double v) {
+    return generate_main_r(mu, lambda, v, rng_default());
+}
+
+double generate_main_r(double mu, double lambda, double v, RngState *rng) {
+    double x = 0.0;
+    generate_main_n(mu, lambda, v, &x, 1, rng);
+    return x;
+}
+
+void generate_main_n(double mu, double lambda, double v, double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    if (lambda <= 0 || v <= 0) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    
+    UniformBuffer ub;
+    init_uniform_buffer(&ub, rng, attached_stats);
+    switch (fixed_shape(v)) {
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+        case SHAPE_##id: generate_main_##id(mu, lambda, out, n, &ub); return;
+        SH_FIXED_SHAPES(X)
+#undef X
+        case SHAPE_GENERIC: break;
+    }
+    
+    // Константы генератора зависят только от v и считаются один раз на весь массив
+    GIGSampler gig;
+    prepare_gig_sampler(&gig, v);
+    for (int i = 0; i < n; i++) {
+        out[i] = draw_main(&gig, mu, lambda, &ub, n - i);
+    }
+}
+
+// --- ПОДГОТОВЛЕННОЕ ОСНОВНОЕ РАСПРЕДЕЛЕНИЕ ---
+
+int prepare_sh_dist(SHDist *dist, double mu, double lambda, double v) {
+    memset(dist, 0, sizeof(SHDist));
+    dist->mu = mu;
+    dist->lambda = lambda;
+    dist->v = v;
+    if (lambda <= 0 || v <= 0) {
+        dist->valid = 0;
+        return -1;
+    }
+    dist->valid = 1;
+    
+    // Для v из SH_FIXED_SHAPES функции Бесселя и генератор GIG уже посчитаны
+    FixedShapeId shape = fixed_shape(v);
+    double k1;
+    if (shape != SHAPE_GENERIC) {
+        k1 = fixed_shapes[shape].k1;
+        dist->gig = fixed_shapes[shape].gig;
+    } else {
+        k1 = bessel_k_fast(1.0, v);
+        prepare_gig_sampler(&dist->gig, v);
+    }
+    
+    dist->inv_lambda = 1.0 / lambda;
+    dist->inv_v = 1.0 / v;
+    dist->norm = dist->inv_lambda / (2 * sqrt(v) * k1);
+    dist->log_norm = log(dist->norm);
+    
+    // Те же формулы, что и в moments_main: произведение K_3 K_1 уходит в 0 уже при v > ~354,
+    // поэтому моменты считаются по отношениям
+    double k1_over_k2, k3_over_k2;
+    bessel_k_ratios(v, &k1_over_k2, &k3_over_k2);
+    dist->mean = mu;
+    dist->variance = lambda * lambda / k1_over_k2;
+    dist->skewness = 0.0;
+    dist->kurtosis = 3.0 * k3_over_k2 * k1_over_k2 - 3.0;
+    return 0;
+}
+
+double pdf_sh_dist(double x, const SHDist *dist) {
+    if (!dist->valid) return 0.0;
+    double x_standard = (x - dist->mu) * dist->inv_lambda;
+    return dist->norm * exp(-dist->v * sqrt(1 + x_standard * x_standard * dist->inv_v));
+}
+
+double logpdf_sh_dist(double x, const SHDist *dist) {
+    if (!dist->valid) return -INFINITY;
+    double x_standard = (x - dist->mu) * dist->inv_lambda;
+    return dist->log_norm - dist->v * sqrt(1 + x_standard * x_standard * dist->inv_v);
+}
+
+void moments_sh_dist(const SHDist *dist, double *mean, double *variance, double *skewness, double *kurtosis) {
+    // Для некорректных параметров все поля нулевые, как и в moments_main
+    if (mean) *mean = dist->valid ? dist->mean : 0.0;
+    if (variance) *variance = dist->variance;
+    if (skewness) *skewness = dist->skewness;
+    if (kurtosis) *kurtosis = dist->kurtosis;
+}
+
+double generate_sh_dist(const SHDist *dist, RngState *rng) {
+    double x = 0.0;
+    generate_sh_dist_n(dist, &x, 1, rng);
+    return x;
+}
+
+void generate_sh_dist_n(const SHDist *dist, double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    if (!dist->valid) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    
+    UniformBuffer ub;
+    init_uniform_buffer(&ub, rng, attached_stats);
+    switch (fixed_shape(dist->v)) {
+#define X(id, v, k1, k2, k3, norm, shift, u_min, u_max) \
+        case SHAPE_##id: generate_main_##id(dist->mu, dist->lambda, out, n, &ub); return;
+        SH_FIXED_SHAPES(X)
+#undef X
+        case SHAPE_GENERIC: break;
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = draw_main(&dist->gig, dist->mu, dist->lambda, &ub, n - i);
+    }
+}
+
+// --- ВЫБОР С ВЕСАМИ (ALIAS-ТАБЛИЦА) ---
+
+// Заполняет prob и alias по весам с положительной суммой total; work - рабочий массив на count элементов
+static void fill_alias_table(const double *weights, int count, double total, double *prob, int *alias, int *work) {
+    // Масштабируем веса так, чтобы средняя ячейка имела вес 1
+    for (int i = 0; i < count; i++) {
+        prob[i] = weights[i] * count / total;
+        alias[i] = i;
+    }
+    // Рабочие списки "малых" (< 1) и "больших" (>= 1) ячеек: в одном массиве с двух концов
+    int small_top = 0;
+    int large_bottom = count;
+    for (int i = 0; i < count; i++) {
+        if (prob[i] < 1.0) {
+            work[small_top++] = i;
+        } else {
+            work[--large_bottom] = i;
+        }
+    }
+    
+    // Каждую малую ячейку дополняем до 1 за счет большой
+    while (small_top > 0 && large_bottom < count) {
+        int small = work[--small_top];
+        int large = work[large_bottom];
+        alias[small] = large;
+        prob[large] -= 1.0 - prob[small];
+        if (prob[large] < 1.0) {
+            // Большая ячейка стала малой
+            large_bottom++;
+            work[small_top++] = large;
+        }
+    }
+    // Оставшиеся ячейки (в том числе из-за ошибок округления) заполнены целиком
+    while (small_top > 0) prob[work[--small_top]] = 1.0;
+    while (large_bottom < count) prob[work[large_bottom++]] = 1.0;
+}
+
+AliasTable* build_alias_table(const double *weights, int count) {
+    if (weights == NULL || count <= 0) {
+        return NULL;
+    }
+    
+    double total = 0.0;
+    for (int i = 0; i < count; i++) {
+        if (!(weights[i] >= 0)) return NULL; // Отрицательный вес или NaN
+        total += weights[i];
+    }
+    if (!(total > 0)) {
+        return NULL;
+    }
+    
+    AliasTable *table = (AliasTable*)malloc(sizeof(AliasTable));
+    if (!table) return NULL;
+    table->size = count;
+    table->prob = (double*)malloc(count * sizeof(double));
+    table->alias = (int*)malloc(count * sizeof(int));
+    int *work = (int*)malloc(count * sizeof(int));
+    if (!table->prob || !table->alias || !work) {
+        free(work);
+        free_alias_table(table);
+        return NULL;
+    }
+    
+    fill_alias_table(weights, count, total, table->prob, table->alias, work);
+    free(work);
+    return table;
+}
+
+int draw_alias(const AliasTable *table, RngState *rng) {
+    // Одна равномерная величина: целая часть - ячейка, дробная - выбор между ячейкой и ее alias
+    double u = rng_uniform(rng) * table->size;
+    int i = (int)u;
+    return (u - i < table->prob[i]) ? i : table->alias[i];
+}
+
+void draw_alias_n(const AliasTable *table, int *out, int n, RngState *rng) {
+    if (table == NULL || out == NULL || n <= 0) {
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = draw_alias(table, rng);
+    }
+}
+
+void free_alias_table(AliasTable *table) {
+    if (table) {
+        free(table->prob);
+        free(table->alias);
+        free(table);
+    }
+}
+
+// --- СМЕСЬ РАСПРЕДЕЛЕНИЙ ---
+
+// Двухкомпонентная смесь как частный случай Mixture - целиком на стеке, без malloc
+typedef struct {
+    Mixture mixture;
+    double weight[2], mu[2], lambda[2], v[2];
+    SHDist components[2];
+    AliasTable alias;
+    double prob[2];
+    int alias_index[2];
+} MixturePair;
+
+// Что подготовить в компонентах: генерации не нужны функции Бесселя, а одному значению -
+// и генераторы обеих компонент (нужен только генератор выпавшей)
+typedef enum {
+    MIXTURE_VIEW_FULL,       // prepare_sh_dist: плотности, моменты и генерация
+    MIXTURE_VIEW_SAMPLERS,   // Только параметры и генератор GIG каждой компоненты
+    MIXTURE_VIEW_WEIGHTS     // Только веса и alias-таблица, компоненты не заполняются
+} MixtureViewLevel;
+
+// Параметры и генератор GIG компоненты без функций Бесселя (достаточно для draw_main)
+static void prepare_sh_sampler(SHDist *dist, double mu, double lambda, double v) {
+    memset(dist, 0, sizeof(SHDist));
+    dist->mu = mu;
+    dist->lambda = lambda;
+    dist->v = v;
+    dist->valid = (lambda > 0 && v > 0);
+    if (!dist->valid) {
+        return;
+    }
+    FixedShapeId shape = fixed_shape(v);
+    if (shape != SHAPE_GENERIC) {
+        dist->gig = fixed_shapes[shape].gig;
+    } else {
+        prepare_gig_sampler(&dist->gig, v);
+    }
+}
+
+// Возвращает смесь, все массивы которой лежат в pair, или NULL при некорректном p
+static const Mixture* view_mixture_params(const MixtureParams *params, MixturePair *pair, MixtureViewLevel level) {
+    if (params == NULL || params->p < 0 || params->p > 1) {
+        return NULL;
+    }
+    
+    pair->weight[0] = params->p;
+    pair->weight[1] = 1.0 - params->p;
+    pair->mu[0] = params->mu1;
+    pair->mu[1] = params->mu2;
+    pair->lambda[0] = params->lambda1;
+    pair->lambda[1] = params->lambda2;
+    pair->v[0] = params->v1;
+    pair->v[1] = params->v2;
+    for (int k = 0; k < 2 && level != MIXTURE_VIEW_WEIGHTS; k++) {
+        if (level == MIXTURE_VIEW_FULL) {
+            prepare_sh_dist(&pair->components[k], pair->mu[k], pair->lambda[k], pair->v[k]);
+        } else {
+            prepare_sh_sampler(&pair->components[k], pair->mu[k], pair->lambda[k], pair->v[k]);
+        }
+    }
+    
+    int work[2];
+    fill_alias_table(pair->weight, 2, 1.0, pair->prob, pair->alias_index, work);
+    pair->alias.size = 2;
+    pair->alias.prob = pair->prob;
+    pair->alias.alias = pair->alias_index;
+    
+    pair->mixture.count = 2;
+    pair->mixture.weight = pair->weight;
+    pair->mixture.mu = pair->mu;
+    pair->mixture.lambda = pair->lambda;
+    pair->mixture.v = pair->v;
+    pair->mixture.components = pair->components;
+    pair->mixture.alias = &pair->alias;
+    return &pair->mixture;
+}
+
+double pdf_mixture(double x, MixtureParams *params) {
+    if (params == NULL || params->p < 0 || params->p > 1) {
+        return 0.0;
+    }
+    
+    // Плотность первого распределения
+    double pdf1 = pdf_main(x, params->mu1, params->lambda1, params->v1);
+    
+    // Плотность второго распределения  
+    double pdf2 = pdf_main(x, params->mu2, params->lambda2, params->v2);
+    
+    return params->p * pdf1 + (1.0 - params->p) * pdf2;
+}
+
+void moments_mixture(MixtureParams *params, double *mean, double *variance, double *skewness, double *kurtosis) {
+    MixturePair pair;
+    moments_mixture_k(view_mixture_params(params, &pair, MIXTURE_VIEW_FULL), mean, variance, skewness, kurtosis);
+}
+
+double generate_mixture(MixtureParams *params) {
+    return generate_mixture_r(params, rng_default());
+}
+
+double generate_mixture_r(MixtureParams *params, RngState *rng) {
+    // Сначала компонента, затем генератор только для нее. Равномерные величины расходуются
+    // так же, как в generate_mixture_n при n = 1
+    MixturePair pair;
+    if (view_mixture_params(params, &pair, MIXTURE_VIEW_WEIGHTS) == NULL) {
+        return 0.0;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    int k = draw_alias(&pair.alias, rng);
+    if (attached_stats) attached_stats->rng_draws++;
+    return generate_main_r(pair.mu[k], pair.lambda[k], pair.v[k], rng);
+}
+
+void generate_mixture_n(MixtureParams *params, double *out, int n, RngState *rng) {
+    MixturePair pair;
+    generate_mixture_k_n(view_mixture_params(params, &pair, MIXTURE_VIEW_SAMPLERS), out, n, rng);
+}
+
+// --- СМЕСЬ ИЗ K КОМПОНЕНТ ---
+
+Mixture* create_mixture(int count, const double *weights, const double *mu, const double *lambda, const double *v) {
+    if (count <= 0 || !weights || !mu || !lambda || !v) {
+        return NULL;
+    }
+    
+    Mixture *mixture = (Mixture*)calloc(1, sizeof(Mixture));
+    if (!mixture) return NULL;
+    mixture->count = count;
+    mixture->weight = (double*)malloc(count * sizeof(double));
+    mixture->mu = (double*)malloc(count * sizeof(double));
+    mixture->lambda = (double*)malloc(count * sizeof(double));
+    mixture->v = (double*)malloc(count * sizeof(double));
+    mixture->components = (SHDist*)malloc(count * sizeof(SHDist));
+    mixture->alias = build_alias_table(weights, count);
+    if (!mixture->weight || !mixture->mu || !mixture->lambda || !mixture->v ||
+        !mixture->components || !mixture->alias) {
+        free_mixture(mixture);
+        return NULL;
+    }
+    
+    double total = 0.0;
+    for (int k = 0; k < count; k++) {
+        total += weights[k];
+    }
+    for (int k = 0; k < count; k++) {
+        mixture->weight[k] = weights[k] / total;
+        mixture->mu[k] = mu[k];
+        mixture->lambda[k] = lambda[k];
+        mixture->v[k] = v[k];
+        prepare_sh_dist(&mixture->components[k], mu[k], lambda[k], v[k]);
+    }
+    
+    return mixture;
+}
+
+Mixture* create_mixture_from_params(const MixtureParams *params) {
+    if (params == NULL || params->p < 0 || params->p > 1) {
+        return NULL;
+    }
+    double weights[2] = { params->p, 1.0 - params->p };
+    double mu[2] = { params->mu1, params->mu2 };
+    double lambda[2] = { params->lambda1, params->lambda2 };
+    double v[2] = { params->v1, params->v2 };
+    return create_mixture(2, weights, mu, lambda, v);
+}
+
+void free_mixture(Mixture *mixture) {
+    if (mixture) {
+        free(mixture->weight);
+        free(mixture->mu);
+        free(mixture->lambda);
+        free(mixture->v);
+        free(mixture->components);
+        free_alias_table(mixture->alias);
+        free(mixture);
+    }
+}
+
+double generate_mixture_k(const Mixture *mixture, RngState *rng) {
+    double x = 0.0;
+    generate_mixture_k_n(mixture, &x, 1, rng);
+    return x;
+}
+
+void generate_mixture_k_n(const Mixture *mixture, double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    if (mixture == NULL) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    
+    // Номера компонент выбираются пачкой, затем по каждому генерируется значение
+    int index[UNIFORM_BATCH];
+    UniformBuffer ub;
+    init_uniform_buffer(&ub, rng, attached_stats);
+    for (int start = 0; start < n; start += UNIFORM_BATCH) {
+        int count = (n - start < UNIFORM_BATCH) ? n - start : UNIFORM_BATCH;
+        draw_alias_n(mixture->alias, index, count, rng);
+        if (ub.stats) ub.stats->rng_draws += (uint64_t)count;   // Одно слово на выбор компоненты
+        for (int i = 0; i < count; i++) {
+            const SHDist *component = &mixture->components[index[i]];
+            out[start + i] = component->valid
+                ? draw_main(&component->gig, component->mu, component->lambda, &ub, n - start - i)
+                : 0.0;
+        }
+    }
+}
+
+double pdf_mixture_k(double x, const Mixture *mixture) {
+    if (mixture == NULL) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int k = 0; k < mixture->count; k++) {
+        sum += mixture->weight[k] * pdf_sh_dist(x, &mixture->components[k]);
+    }
+    return sum;
+}
+
+double logpdf_mixture_k(double x, const Mixture *mixture) {
+    if (mixture == NULL) {
+        return -INFINITY;
+    }
+    
+    // log sum w_k f_k(x) = m + log sum exp(log w_k + log f_k(x) - m), m - наибольшее слагаемое
+    double max = -INFINITY;
+    for (int k = 0; k < mixture->count; k++) {
+        if (mixture->weight[k] > 0) {
+            double term = log(mixture->weight[k]) + logpdf_sh_dist(x, &mixture->components[k]);
+            if (term > max) max = term;
+        }
+    }
+    if (max == -INFINITY) {
+        return -INFINITY;
+    }
+    
+    double sum = 0.0;
+    for (int k = 0; k < mixture->count; k++) {
+        if (mixture->weight[k] > 0) {
+            sum += exp(log(mixture->weight[k]) + logpdf_sh_dist(x, &mixture->components[k]) - max);
+        }
+    }
+    return max + log(sum);
+}
+
+void moments_mixture_k(const Mixture *mixture, double *mean, double *variance, double *skewness, double *kurtosis) {
+    if (mixture == NULL) {
+        if (mean) *mean = 0;
+        if (variance) *variance = 0;
+        if (skewness) *skewness = 0;
+        if (kurtosis) *kurtosis = 0;
+        return;
+    }
+    
+    // Начальные моменты смеси - взвешенные суммы начальных моментов компонент
+    double r1 = 0, r2 = 0, r3 = 0, r4 = 0;
+    for (int k = 0; k < mixture->count; k++) {
+        double m, var, s, kurt;
+        moments_sh_dist(&mixture->components[k], &m, &var, &s, &kurt);
+        double sd3 = s * pow(var, 1.5); // Третий центральный момент компоненты
+        double w = mixture->weight[k];
+        r1 += w * m;
+        r2 += w * (var + m * m);
+        r3 += w * (sd3 + 3 * m * var + m * m * m);
+        r4 += w * ((kurt + 3) * var * var + 4 * m * sd3 + 6 * m * m * var + m * m * m * m);
+    }
+    
+    // Переход к центральным моментам
+    double var = r2 - r1 * r1;
+    double mu3 = r3 - 3 * r1 * r2 + 2 * r1 * r1 * r1;
+    double mu4 = r4 - 4 * r1 * r3 + 6 * r1 * r1 * r2 - 3 * r1 * r1 * r1 * r1;
+    
+    if (mean) *mean = r1;
+    if (variance) *variance = var;
+    if (skewness) *skewness = (var > 0) ? mu3 / pow(var, 1.5) : 0.0;
+    if (kurtosis) *kurtosis = (var > 0) ? mu4 / (var * var) - 3 : 0.0;
+}
+
+// --- ФУНКЦИЯ РАСПРЕДЕЛЕНИЯ И КВАНТИЛИ ---
+
+// Квадратура Гаусса-Лежандра на 10 узлах: половина симметричных узлов на [-1, 1] и их веса
+static const double GL_NODES[5] = {
+    0.1488743389816312108848260, 0.4333953941292471907992659, 0.6794095682990244062343274,
+    0.8650633666889845107320967, 0.9739065285171717200779640
+};
+static const double GL_WEIGHTS[5] = {
+    0.2955242247147528701738930, 0.2692667193099963550912269, 0.2190863625159820439955349,
+    0.1494513491505805931457763, 0.0666713443086881375935688
+};
+
+// Отрезки по u для хвоста: exp(-50) ~ 2e-22, дальше интеграл пренебрежимо мал
+static const double TAIL_EDGES[9] = { 0.0, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 50.0 };
+
+// Интеграл exp(v - omega(z)) по [a, b], omega(z) = sqrt(v^2 + v z^2);
+// omega - v = v z^2 / (omega + v) без вычитания близких чисел и без переполнения exp при больших v
+static double integrate_sh_center(double v, double a, double b) {
+    double half = 0.5 * (b - a), center = 0.5 * (a + b);
+    double sum = 0.0;
+    for (int i = 0; i < 5; i++) {
+        double z1 = center - half * GL_NODES[i];
+        double z2 = center + half * GL_NODES[i];
+        double w1 = sqrt(v * v + v * z1 * z1), w2 = sqrt(v * v + v * z2 * z2);
+        sum += GL_WEIGHTS[i] * (exp(-v * z1 * z1 / (w1 + v)) + exp(-v * z2 * z2 / (w2 + v)));
+    }
+    return half * sum;
+}
+
+// Вероятность P(Z > t), t >= 0, для стандартизованной величины Z = (X - mu) / lambda
+static double sh_standard_upper(const SHDist *dist, double t) {
+    double v = dist->v;
+    double log_c = dist->log_norm + log(dist->lambda); // Нормировка стандартизованной плотности
+    
+    // Хвост: z(u) - решение omega(z) = omega(t) + u, dz = omega / (v z) du.
+    // Особая точка подынтегральной функции (z = 0) лежит при u = v - omega(t) <= -2, далеко от отрезков
+    if (v * t * t >= 4.0 * (v + 1.0)) {
+        double w = sqrt(v * v + v * t * t);
+        double sum = 0.0;
+        for (int k = 0; k < 8; k++) {
+            double half = 0.5 * (TAIL_EDGES[k + 1] - TAIL_EDGES[k]);
+            double center = 0.5 * (TAIL_EDGES[k + 1] + TAIL_EDGES[k]);
+            for (int i = 0; i < 5; i++) {
+                for (int side = -1; side <= 1; side += 2) {
+                    double u = center + side * half * GL_NODES[i];
+                    double r = w + u;
+                    double z = sqrt((r - v) * (r + v) / v);
+                    sum += half * GL_WEIGHTS[i] * exp(-u) * r / (v * z);
+                }
+            }
+        }
+        return exp(log_c - w) * sum;
+    }
+    
+    // Центр: отрезки шириной 0.5 * sqrt(z^2 + v), но не больше 1
+    double integral = 0.0;
+    for (double a = 0.0; a < t; ) {
+        double width = 0.5 * sqrt(a * a + v);
+        if (width > 1.0) width = 1.0;
+        double b = (a + width < t) ? a + width : t;
+        integral += integrate_sh_center(v, a, b);
+        a = b;
+    }
+    return 0.5 - exp(log_c - v) * integral;
+}
+
+double cdf_sh_dist(double x, const SHDist *dist) {
+    if (!dist->valid) return 0.0;
+    double z = (x - dist->mu) * dist->inv_lambda;
+    if (isnan(z)) return z;
+    return (z < 0) ? sh_standard_upper(dist, -z) : 1.0 - sh_standard_upper(dist, z);
+}
+
+double quantile_sh_dist(double p, const SHDist *dist) {
+    if (!(p >= 0 && p <= 1)) return NAN;
+    if (!dist->valid) return 0.0;
+    if (p == 0) return -INFINITY;
+    if (p == 1) return INFINITY;
+    
+    // Распределение симметрично: ищем t > 0 с P(Z > t) = s, s = min(p, 1 - p)
+    double s = (p < 0.5) ? p : 1.0 - p;
+    if (s == 0.5) return dist->mu;
+    double log_s = log(s);
+    double log_c = dist->log_norm + log(dist->lambda);
+    double v = dist->v;
+    
+    double lo = 0.0, hi = 1.0;
+    while (sh_standard_upper(dist, hi) > s && hi < 1e300) {
+        lo = hi;
+        hi *= 2.0;
+    }
+    
+    // Ньютон для log P(Z > t) = log s: шаг (log S - log s) * S / f(t), при выходе из [lo, hi] - деление пополам
+    double t = 0.5 * (lo + hi);
+    for (int iter = 0; iter < 200; iter++) {
+        double upper = sh_standard_upper(dist, t);
+        double density = exp(log_c - sqrt(v * v + v * t * t));
+        if (upper > s) lo = t; else hi = t;
+        
+        double next = (upper > 0 && density > 0) ? t + (log(upper) - log_s) * upper / density : NAN;
+        if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+        double step = fabs(next - t);
+        t = next;
+        if (step <= 1e-15 * t || hi - lo <= 1e-15 * hi) break;
+    }
+    
+    double x = dist->lambda * t;
+    return (p < 0.5) ? dist->mu - x : dist->mu + x;
+}
+
+double cdf_main(double x, double mu, double lambda, double v) {
+    SHDist dist;
+    prepare_sh_dist(&dist, mu, lambda, v);
+    return cdf_sh_dist(x, &dist);
+}
+
+double quantile_main(double p, double mu, double lambda, double v) {
+    SHDist dist;
+    prepare_sh_dist(&dist, mu, lambda, v);
+    return quantile_sh_dist(p, &dist);
+}
+
+// Взвешенная сумма подготовленных распределений - общий случай для смесей
+static double cdf_components(double x, const SHDist *components, const double *weights, int count) {
+    double sum = 0.0;
+    for (int k = 0; k < count; k++) {
+        if (weights[k] > 0) sum += weights[k] * cdf_sh_dist(x, &components[k]);
+    }
+    return sum;
+}
+
+static double pdf_components(double x, const SHDist *components, const double *weights, int count) {
+    double sum = 0.0;
+    for (int k = 0; k < count; k++) {
+        if (weights[k] > 0) sum += weights[k] * pdf_sh_dist(x, &components[k]);
+    }
+    return sum;
+}
+
+static double quantile_components(double p, const SHDist *components, const double *weights, int count) {
+    if (!(p >= 0 && p <= 1)) return NAN;
+    if (p == 0) return -INFINITY;
+    if (p == 1) return INFINITY;
+    
+    // F(lo) <= p <= F(hi): F - выпуклая комбинация F_k, а каждая F_k пересекает p между lo и hi
+    double lo = INFINITY, hi = -INFINITY;
+    for (int k = 0; k < count; k++) {
+        if (!(weights[k] > 0)) continue;
+        double q = quantile_sh_dist(p, &components[k]);
+        if (q < lo) lo = q;
+        if (q > hi) hi = q;
+    }
+    if (!(lo <= hi)) return 0.0;
+    
+    double x = 0.5 * (lo + hi);
+    for (int iter = 0; iter < 200 && lo < hi; iter++) {
+        double f = cdf_components(x, components, weights, count) - p;
+        if (f < 0) lo = x; else hi = x;
+        
+        double density = pdf_components(x, components, weights, count);
+        double next = (density > 0) ? x - f / density : NAN;
+        if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+        double step = fabs(next - x);
+        x = next;
+        if (step <= 1e-15 * fabs(x) || hi - lo <= 1e-15 * fabs(hi)) break;
+    }
+    return x;
+}
+
+double cdf_mixture(double x, MixtureParams *params) {
+    if (params == NULL || params->p < 0 || params->p > 1) return 0.0;
+    SHDist components[2];
+    double weights[2] = { params->p, 1.0 - params->p };
+    prepare_sh_dist(&components[0], params->mu1, params->lambda1, params->v1);
+    prepare_sh_dist(&components[1], params->mu2, params->lambda2, params->v2);
+    return cdf_components(x, components, weights, 2);
+}
+
+double quantile_mixture(double p, MixtureParams *params) {
+    if (params == NULL || params->p < 0 || params->p > 1) return 0.0;
+    SHDist components[2];
+    double weights[2] = { params->p, 1.0 - params->p };
+    prepare_sh_dist(&components[0], params->mu1, params->lambda1, params->v1);
+    prepare_sh_dist(&components[1], params->mu2, params->lambda2, params->v2);
+    return quantile_components(p, components, weights, 2);
+}
+
+double cdf_mixture_k(double x, const Mixture *mixture) {
+    return cdf_components(x, mixture->components, mixture->weight, mixture->count);
+}
+
+double quantile_mixture_k(double p, const Mixture *mixture) {
+    return quantile_components(p, mixture->components, mixture->weight, mixture->count);
+}
+
+// --- МОДЕЛИРОВАНИЕ МЕТОДОМ ОБРАТНОЙ ФУНКЦИИ ---
+
+#define INVERSION_INITIAL 32        // Начальных отрезков (равных по z)
+#define INVERSION_MAX_NODES (1 << 22)
+#define INVERSION_STACK (INVERSION_INITIAL + 64) // Начальная емкость стека: отрезки + глубина деления
+
+typedef struct {
+    double z, u, slope;
+} InversionNode;
+
+// Узел в точке z (координаты таблицы, компоненты table->standard)
+static InversionNode inversion_node(const InversionTable *table, double z) {
+    InversionNode node;
+    node.z = z;
+    node.u = cdf_components(z, table->standard, table->weights, table->count);
+    node.slope = 1.0 / pdf_components(z, table->standard, table->weights, table->count);
+    return node;
+}
+
+// Кубический многочлен Эрмита между узлами i и i + 1
+static inline double hermite_inverse(const double *us, const double *xs, const double *slopes, int i, double u) {
+    double h = us[i + 1] - us[i];
+    double t = (u - us[i]) / h;
+    double t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * xs[i] + (t3 - 2 * t2 + t) * h * slopes[i] +
+           (3 * t2 - 2 * t3) * xs[i + 1] + (t3 - t2) * h * slopes[i + 1];
+}
+
+// Кубический многочлен Эрмита для F(x) между узлами i и i + 1 (dF/dx = 1 / slope)
+static inline double hermite_cdf(const double *us, const double *xs, const double *slopes, int i, double x) {
+    double h = xs[i + 1] - xs[i];
+    double t = (x - xs[i]) / h;
+    double t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * us[i] + (t3 - 2 * t2 + t) * h / slopes[i] +
+           (3 * t2 - 2 * t3) * us[i + 1] + (t3 - t2) * h / slopes[i + 1];
+}
+
+// Гарантирует место хотя бы для одного узла после последнего
+static int reserve_inversion_node(InversionTable *table, int *capacity) {
+    if (table->size < *capacity) return 0;
+    if (*capacity >= INVERSION_MAX_NODES) return -1;
+    int new_capacity = 2 * *capacity;
+    double *u = (double*)realloc(table->u, new_capacity * sizeof(double));
+    if (u) table->u = u;
+    double *z = (double*)realloc(table->z, new_capacity * sizeof(double));
+    if (z) table->z = z;
+    double *slope = (double*)realloc(table->slope, new_capacity * sizeof(double));
+    if (slope) table->slope = slope;
+    if (!u || !z || !slope) return -1;
+    *capacity = new_capacity;
+    return 0;
+}
+
+InversionTable* build_inversion_table(const MixtureParams *params, int is_mixture, double tolerance) {
+    if (params == NULL || !(tolerance >= 1e-13 && tolerance <= 1e-3)) {
+        return NULL;
+    }
+    
+    InversionTable *table = (InversionTable*)calloc(1, sizeof(InversionTable));
+    if (!table) return NULL;
+    table->tolerance = tolerance;
+    table->count = is_mixture ? 2 : 1;
+    table->weights[0] = is_mixture ? params->p : 1.0;
+    table->weights[1] = is_mixture ? 1.0 - params->p : 0.0;
+    int valid = prepare_sh_dist(&table->components[0], params->mu1, params->lambda1, params->v1) == 0;
+    if (is_mixture) {
+        valid = valid && params->p >= 0 && params->p <= 1 &&
+                prepare_sh_dist(&table->components[1], params->mu2, params->lambda2, params->v2) == 0;
+    }
+    
+    // Общие сдвиг и масштаб: общий сдвиг или растяжение всех компонент их не меняет
+    table->location = 0.0;
+    table->scale = 0.0;
+    for (int k = 0; k < table->count; k++) {
+        table->location += table->weights[k] * table->components[k].mu;
+        if (table->components[k].lambda > table->scale) table->scale = table->components[k].lambda;
+    }
+    for (int k = 0; k < table->count && valid; k++) {
+        const SHDist *component = &table->components[k];
+        valid = prepare_sh_dist(&table->standard[k], (component->mu - table->location) / table->scale,
+                                component->lambda / table->scale, component->v) == 0;
+    }
+    
+    int capacity = 1024;
+    table->u = (double*)malloc(capacity * sizeof(double));
+    table->z = (double*)malloc(capacity * sizeof(double));
+    table->slope = (double*)malloc(capacity * sizeof(double));
+    // В стеке - начальные отрезки и по одному узлу на уровень деления, обычно меньше 100
+    int stack_capacity = INVERSION_STACK;
+    InversionNode *stack = (InversionNode*)malloc(stack_capacity * sizeof(InversionNode));
+    if (!valid || !table->u || !table->z || !table->slope || !stack) {
+        free(stack);
+        free_inversion_table(table);
+        return NULL;
+    }
+    
+    // Хвосты вероятности tolerance остаются за таблицей
+    double z_min = quantile_components(tolerance, table->standard, table->weights, table->count);
+    double z_max = quantile_components(1.0 - tolerance, table->standard, table->weights, table->count);
+    
+    // Стек правых концов отрезков: вершина - ближайший справа от последнего принятого узла
+    int stack_size = 0;
+    for (int i = INVERSION_INITIAL; i >= 1; i--) {
+        stack[stack_size++] = inversion_node(table, z_min + (z_max - z_min) * i / INVERSION_INITIAL);
+    }
+    InversionNode first = inversion_node(table, z_min);
+    table->u[0] = first.u;
+    table->z[0] = first.z;
+    table->slope[0] = first.slope;
+    table->size = 1;
+    int failed = 0;
+    
+    while (stack_size > 0 && !(failed = reserve_inversion_node(table, &capacity))) {
+        InversionNode right = stack[stack_size - 1];
+        int last = table->size - 1;
+        double u0 = table->u[last], z0 = table->z[last];
+        
+        // F не различает узлы (плоский участок в пределах точности) - узел не нужен
+        if (!(right.u > u0)) {
+            stack_size--;
+            continue;
+        }
+        
+        // Монотонность многочлена Эрмита: alpha^2 + beta^2 <= 9 (Фрич, Карлсон)
+        double secant = (right.z - z0) / (right.u - u0);
+        double alpha = table->slope[last] / secant, beta = right.slope / secant;
+        int accept = (alpha * alpha + beta * beta <= 9.0);
+        double error = 0.0;
+        // Кандидат записывается на место следующего узла, но size растет только при принятии
+        table->u[last + 1] = right.u;
+        table->z[last + 1] = right.z;
+        table->slope[last + 1] = right.slope;
+        if (accept) {
+            double u_mid = 0.5 * (u0 + right.u);
+            double z_mid = hermite_inverse(table->u, table->z, table->slope, last, u_mid);
+            error = fabs(cdf_components(z_mid, table->standard, table->weights, table->count) - u_mid);
+            accept = error <= tolerance;
+        }
+        double z_split = 0.5 * (z0 + right.z);
+        InversionNode middle;
+        int have_middle = 0;
+        double cdf_error = 0.0;
+        if (accept) {
+            // Та же таблица считает и F(x) - проверяем прямой многочлен в середине отрезка по z
+            middle = inversion_node(table, z_split);
+            have_middle = 1;
+            cdf_error = fabs(hermite_cdf(table->u, table->z, table->slope, last, z_split) - middle.u);
+            accept = cdf_error <= tolerance;
+        }
+        // Отрезок уже не делится в пределах точности double
+        if (!accept && (z_split <= z0 || z_split >= right.z)) {
+            accept = 1;
+        }
+        
+        if (accept) {
+            if (error > table->max_u_error) table->max_u_error = error;
+            if (cdf_error > table->max_cdf_error) table->max_cdf_error = cdf_error;
+            stack_size--;
+            table->size++;
+        } else {
+            if (stack_size == stack_capacity) {
+                InversionNode *grown = (InversionNode*)realloc(stack, 2 * stack_capacity * sizeof(InversionNode));
+                if (!grown) {
+                    failed = 1;
+                    break;
+                }
+                stack = grown;
+                stack_capacity *= 2;
+            }
+            stack[stack_size++] = have_middle ? middle : inversion_node(table, z_split);
+        }
+    }
+    free(stack);
+    if (failed || table->size < 2) {
+        free_inversion_table(table);
+        return NULL;
+    }
+    
+    // Направляющая таблица: по номеру ячейки u - узел, с которого начинать поиск
+    table->u_min = table->u[0];
+    table->u_max = table->u[table->size - 1];
+    table->guide_size = table->size;
+    table->guide = (int*)malloc(table->guide_size * sizeof(int));
+    if (!table->guide) {
+        free_inversion_table(table);
+        return NULL;
+    }
+    int i = 0;
+    for (int j = 0; j < table->guide_size; j++) {
+        double u = table->u_min + (table->u_max - table->u_min) * j / table->guide_size;
+        while (i < table->size - 2 && table->u[i + 1] <= u) i++;
+        table->guide[j] = i;
+    }
+    
+    // То же по z - для cdf_inversion_table
+    table->guide_z = (int*)malloc(table->guide_size * sizeof(int));
+    if (!table->guide_z) {
+        free_inversion_table(table);
+        return NULL;
+    }
+    double z_first = table->z[0], z_last = table->z[table->size - 1];
+    i = 0;
+    for (int j = 0; j < table->guide_size; j++) {
+        double z = z_first + (z_last - z_first) * j / table->guide_size;
+        while (i < table->size - 2 && table->z[i + 1] <= z) i++;
+        table->guide_z[j] = i;
+    }
+    return table;
+}
+
+// Узел для z: через направляющую таблицу или, если z не меньше предыдущего, от предыдущего узла
+static inline int find_cdf_node(const InversionTable *table, double z, int hint) {
+    int i = hint;
+    if (i < 0 || z < table->z[i]) {
+        double z_first = table->z[0], z_last = table->z[table->size - 1];
+        int j = (int)((z - z_first) / (z_last - z_first) * table->guide_size);
+        if (j >= table->guide_size) j = table->guide_size - 1;
+        i = table->guide_z[j];
+    }
+    while (i < table->size - 2 && table->z[i + 1] <= z) i++;
+    return i;
+}
+
+double cdf_inversion_table(const InversionTable *table, double x) {
+    double z = (x - table->location) / table->scale;
+    if (!(z > table->z[0] && z < table->z[table->size - 1])) {
+        return cdf_components(x, table->components, table->weights, table->count);
+    }
+    return hermite_cdf(table->u, table->z, table->slope, find_cdf_node(table, z, -1), z);
+}
+
+void cdf_inversion_table_n(const InversionTable *table, const double *xs, double *out, int n) {
+    double z_first = table->z[0], z_last = table->z[table->size - 1];
+    double inv_scale = 1.0 / table->scale;
+    int node = -1;
+    for (int k = 0; k < n; k++) {
+        double z = (xs[k] - table->location) * inv_scale;
+        if (!(z > z_first && z < z_last)) {
+            out[k] = cdf_components(xs[k], table->components, table->weights, table->count);
+            continue;
+        }
+        node = find_cdf_node(table, z, node);
+        out[k] = hermite_cdf(table->u, table->z, table->slope, node, z);
+    }
+}
+
+double inversion_quantile(const InversionTable *table, double u) {
+    if (!(u > table->u_min && u < table->u_max)) {
+        // Хвосты вне таблицы (и u = 0, 1, NAN) - точный квантиль
+        return quantile_components(u, table->components, table->weights, table->count);
+    }
+    int j = (int)((u - table->u_min) / (table->u_max - table->u_min) * table->guide_size);
+    if (j >= table->guide_size) j = table->guide_size - 1;
+    int i = table->guide[j];
+    while (i < table->size - 2 && table->u[i + 1] <= u) i++;
+    return table->location + table->scale * hermite_inverse(table->u, table->z, table->slope, i, u);
+}
+
+void generate_inversion_n(const InversionTable *table, const double *uniforms, double *out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = inversion_quantile(table, uniforms[i]);
+    }
+}
+
+double generate_inversion_r(const InversionTable *table, RngState *rng) {
+    if (rng == NULL) {
+        rng = rng_default();
+    }
+    return inversion_quantile(table, rng_uniform_open(rng));
+}
+
+void free_inversion_table(InversionTable *table) {
+    if (table == NULL) return;
+    free(table->u);
+    free(table->z);
+    free(table->slope);
+    free(table->guide);
+    free(table->guide_z);
+    free(table);
+}
+
+// --- ЭМПИРИЧЕСКОЕ РАСПРЕДЕЛЕНИЕ ---
+
+EmpiricalHistogram* build_empirical_histogram(double *sample, int sample_size) {
+    if (sample == NULL || sample_size <= 0) {
+        return NULL;
+    }
+    
+    EmpiricalHistogram* hist = (EmpiricalHistogram*)malloc(sizeof(EmpiricalHistogram));
+    if (!hist) return NULL;
+    
+    // 1. Находим min и max в выборке для определения диапазона
+    double x_min = sample[0];
+    double x_max = sample[0];
+    for (int i = 1; i < sample_size; i++) {
+        if (sample[i] < x_min) x_min = sample[i];
+        if (sample[i] > x_max) x_max = sample[i];
+    }
+    hist->x_min = x_min;
+    hist->x_max = x_max;
+    
+    // 2. Определяем число интервалов (по правилу Старджеса)
+    int n_bins = (int)(1 + 3.322 * log10(sample_size));
+    if (n_bins < 5) n_bins = 5;
+    if (n_bins > 50) n_bins = 50;
+    hist->n_bins = n_bins;
+    
+    // 3. Ширина интервала
+    double bin_width = (x_max - x_min) / n_bins;
+    if (bin_width < 1e-10) {
+        // Все значения одинаковые - интервалы не нужны
+        hist->bin_width = 0.0;
+        hist->density = NULL;
+        return hist;
+    }
+    hist->bin_width = bin_width;
+    
+    hist->density = (double*)calloc(n_bins, sizeof(double));
+    if (!hist->density) {
+        free(hist);
+        return NULL;
+    }
+    
+    // 4. Раскладываем выборку по интервалам за один проход.
+    // Границы интервалов считаются теми же выражениями, что и при поточечном подсчете,
+    // поэтому из-за округления проверяем и соседние интервалы.
+    for (int i = 0; i < sample_size; i++) {
+        int guess = (int)((sample[i] - x_min) / bin_width);
+        for (int bin_index = guess - 1; bin_index <= guess + 1; bin_index++) {
+            if (bin_index < 0 || bin_index >= n_bins) continue;
+            double bin_start = x_min + bin_index * bin_width;
+            if (sample[i] >= bin_start && sample[i] < bin_start + bin_width) {
+                hist->density[bin_index] += 1.0;
+            }
+        }
+        // Особый случай для последнего интервала (включаем правую границу)
+        if (sample[i] == x_max) {
+            hist->density[n_bins - 1] += 1.0;
+        }
+    }
+    
+    // 5. Плотность = (доля точек) / (ширина интервала)
+    for (int i = 0; i < n_bins; i++) {
+        hist->density[i] /= sample_size * bin_width;
+    }
+    
+    return hist;
+}
+
+double pdf_histogram(double x, const EmpiricalHistogram *hist) {
+    if (hist == NULL) {
+        return 0.0;
+    }
+    
+    if (hist->density == NULL) {
+        // Все значения одинаковые
+        return (x >= hist->x_min && x <= hist->x_max) ? (1.0 / (hist->x_max - hist->x_min + 1e-10)) : 0.0;
+    }
+    
+    int bin_index = (int)((x - hist->x_min) / hist->bin_width);
+    if (bin_index < 0 || bin_index >= hist->n_bins) {
+        return 0.0; // x outside range
+    }
+    return hist->density[bin_index];
+}
+
+void pdf_empirical_many(const EmpiricalHistogram *hist, const double *xs, double *out, int m) {
+    for (int i = 0; i < m; i++) {
+        out[i] = pdf_histogram(xs[i], hist);
+    }
+}
+
+void free_empirical_histogram(EmpiricalHistogram *hist) {
+    if (hist) {
+        free(hist->density);
+        free(hist);
+    }
+}
+
+double pdf_empirical(double x, double *sample, int sample_size) {
+    EmpiricalHistogram* hist = build_empirical_histogram(sample, sample_size);
+    if (!hist) {
+        return 0.0;
     }
     
-    // Математическое ожидание: M = mu
-    if (mean) *mean = mu;
-    
-    // Для симметричного гиперболического распределения:
-    // Асимметрия всегда равна 0 (распределение симметричное)
-    if (skewness) *skewness = 0.0;
-    
-    // Вычисляем дисперсию и эксцесс по формулам из варианта
-    double k1 = bessel_k(1.0, v);
-    double k2 = bessel_k(2.0, v);
-    double k3 = bessel_k(3.0, v);
-    
-    // Дисперсия: D = lambda^2 * (K_2(v) / K_1(v))
-    if (variance) {
-        *variance = lambda * lambda * (k2 / k1);
+    double density = pdf_histogram(x, hist);
+    free_empirical_histogram(hist);
+    return density;
+}
+
+// Итоговые характеристики по центральным моментам mu2, mu3, mu4 (деленным на n):
+// дисперсия с поправкой Бесселя, асимметрия и эксцесс - по смещенным моментам
+static void finish_moments(long long n, double mu2, double mu3, double mu4, double *variance, double *skewness, double *kurtosis) {
+    double var_corrected = (n > 1) ? (mu2 * n / (n - 1)) : 0.0;
+    if (variance) *variance = var_corrected;
+
+    if (skewness) {
+        *skewness = (mu2 > 0) ? (mu3 / pow(mu2, 1.5)) : 0.0;
     }
-    
-    // Эксцесс: γ₂ = 3 * K_3(v) * K_1(v) / (K_2(v))^2 - 3
     if (kurtosis) {
-        if (k2 > 0) {
-            *kurtosis = 3.0 * k3 * k1 / (k2 * k2) - 3.0;
+        *kurtosis = (mu2 > 0) ? (mu4 / (mu2 * mu2) - 3.0) : 0.0;
+    }
+}
+
+void moments_empirical(double *sample, int sample_size, double *mean, double *variance, double *skewness, double *kurtosis) {
+    if (sample == NULL || sample_size <= 0) return;
+
+    // Блочная схема (см. accumulate_moments_blocked): каждый суперблок считается отдельно,
+    // результаты объединяются попарно. moments_empirical_parallel дает тот же результат побитово.
+    int superblocks = (sample_size + MOMENT_SUPERBLOCK - 1) / MOMENT_SUPERBLOCK;
+    MomentAccumulator single;
+    MomentAccumulator *accs = (superblocks == 1) ? &single : (MomentAccumulator*)malloc(superblocks * sizeof(MomentAccumulator));
+    if (!accs) {
+        // Нет памяти под частичные результаты - считаем одним проходом
+        init_moment_accumulator(&single);
+        add_many_to_moment_accumulator(&single, sample, sample_size);
+        moments_from_accumulator(&single, mean, variance, skewness, kurtosis);
+        return;
+    }
+
+    for (int b = 0; b < superblocks; b++) {
+        int offset = b * MOMENT_SUPERBLOCK;
+        int count = (sample_size - offset < MOMENT_SUPERBLOCK) ? sample_size - offset : MOMENT_SUPERBLOCK;
+        accumulate_moments_blocked(sample + offset, count, &accs[b]);
+    }
+
+    MomentAccumulator total;
+    merge_moment_accumulators_tree(accs, superblocks, &total);
+    moments_from_accumulator(&total, mean, variance, skewness, kurtosis);
+
+    if (accs != &single) free(accs);
+}
+
+// k-я порядковая статистика: после вызова a[k] на своем месте, слева не больше, справа не меньше
+static double select_kth(double *a, int n, int k) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        // Опорный элемент - медиана трех
+        int mid = lo + (hi - lo) / 2;
+        double x = a[lo], y = a[mid], z = a[hi];
+        double pivot = (x < y) ? ((y < z) ? y : (x < z ? z : x)) : ((x < z) ? x : (y < z ? z : y));
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) {
+                double t = a[i];
+                a[i] = a[j];
+                a[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
         } else {
-            *kurtosis = 0.0;
+            break;
         }
     }
+    return a[k];
 }
 
-// Вспомогательная функция для генерации равномерного распределения
-double uniform_random() {
-    return (double)rand() / RAND_MAX;
+double quantile_empirical(double *sample, int sample_size, int from, double p) {
+    double position = p * (sample_size - 1);
+    int k = (int)position;
+    double lower = select_kth(sample + from, sample_size - from, k - from);
+    if (k + 1 >= sample_size) return lower;
+    // Следующая порядковая статистика - наименьшее справа от k
+    double upper = sample[k + 1];
+    for (int i = k + 2; i < sample_size; i++) {
+        if (sample[i] < upper) upper = sample[i];
+    }
+    return lower + (position - k) * (upper - lower);
 }
 
-// Вспомогательная функция для генерации стандартной нормальной величины (метод Бокса-Мюллера)
-double normal_random() {
-    double u1 = uniform_random();
-    double u2 = uniform_random();
-    while (u1 <= 1e-10) u1 = uniform_random(); // Избегаем log(0)
-    
-    // Бокс-Мюллер преобразование
-    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
-}
+// Моменты одного блока (до MOMENT_BLOCK значений, блок целиком в кэше): два прохода -
+// среднее, затем степени отклонений. Суммы идут в 8 независимых "дорожек", чтобы компилятор
+// мог векторизовать цикл и не был связан порядком сложения слева направо.
+#define MOMENT_BLOCK 4096
+#define MOMENT_LANES 8
 
-double generate_main(double mu, double lambda, double v) {
-    if (lambda <= 0 || v <= 0) {
-        return 0.0;
+static void block_moments(const double *xs, int count, MomentAccumulator *acc) {
+    double lane[MOMENT_LANES] = {0};
+    int tail = count - count % MOMENT_LANES;
+    for (int i = 0; i < tail; i += MOMENT_LANES) {
+        for (int j = 0; j < MOMENT_LANES; j++) {
+            lane[j] += xs[i + j];
+        }
     }
-    
-    double delta = (2.0 / v) * (sqrt(1.0 + v * v) - 1.0);
-    double t;
-    int attempts = 0;
-    const int max_attempts = 1000;
-    
-    while (attempts < max_attempts) {
-        attempts++;
-        
-        double r1 = uniform_random();
-        double r2 = uniform_random();
-        while (r1 <= 1e-12) r1 = uniform_random();
-        while (r2 <= 1e-12) r2 = uniform_random();
-        
-        t = -2.0 / delta * log(r1);
-        
-        if (t <= 1e-12) continue;
-        
-        double left_side = -log(r2);
-        double term1 = (v - delta) * t / 2.0;
-        double term2 = v / (2.0 * t);
-        double term3 = sqrt(v * (v - delta));
-        double right_side = term1 + term2 - term3;
-        
-        // ИСПРАВЛЕНИЕ: если условие ВЫПОЛНЕНО, то ОТКЛОНЯЕМ и продолжаем цикл
-        if (left_side <= right_side) {
-            continue; // Отклоняем и начинаем заново
+    double sum = 0.0;
+    for (int j = 0; j < MOMENT_LANES; j++) sum += lane[j];
+    for (int i = tail; i < count; i++) sum += xs[i];
+    double m = sum / count;
+
+    double s1[MOMENT_LANES] = {0}, s2[MOMENT_LANES] = {0}, s3[MOMENT_LANES] = {0}, s4[MOMENT_LANES] = {0};
+    for (int i = 0; i < tail; i += MOMENT_LANES) {
+        for (int j = 0; j < MOMENT_LANES; j++) {
+            double d = xs[i + j] - m;
+            double d2 = d * d;
+            s1[j] += d;
+            s2[j] += d2;
+            s3[j] += d2 * d;
+            s4[j] += d2 * d2;
         }
-        
-        break; // Принимаем и выходим из цикла
     }
-    
-    if (attempts >= max_attempts) {
-        return mu + lambda * normal_random();
+    double S1 = 0.0, S2 = 0.0, S3 = 0.0, S4 = 0.0;
+    for (int j = 0; j < MOMENT_LANES; j++) {
+        S1 += s1[j];
+        S2 += s2[j];
+        S3 += s3[j];
+        S4 += s4[j];
     }
-    
-    double z = normal_random();
-    double x_standard = z * sqrt(t);
-    
-    return mu + lambda * x_standard;
+    for (int i = tail; i < count; i++) {
+        double d = xs[i] - m;
+        double d2 = d * d;
+        S1 += d;
+        S2 += d2;
+        S3 += d2 * d;
+        S4 += d2 * d2;
+    }
+
+    // Среднее m округлено, поэтому сумма отклонений не ровно 0 - переносим суммы
+    // на точное среднее m + c
+    double n = (double)count;
+    double c = S1 / n;
+    acc->n = count;
+    acc->mean = m + c;
+    acc->m2 = S2 - n * c * c;
+    acc->m3 = S3 - 3 * c * S2 + 2 * n * c * c * c;
+    acc->m4 = S4 - 4 * c * S3 + 6 * c * c * S2 - 3 * n * c * c * c * c;
 }
 
-// --- СМЕСЬ РАСПРЕДЕЛЕНИЙ ---
+void accumulate_moments_blocked(const double *xs, int count, MomentAccumulator *acc) {
+    init_moment_accumulator(acc);
+    if (xs == NULL || count <= 0) return;
 
-double pdf_mixture(double x, MixtureParams *params) {
-    if (params == NULL || params->p < 0 || params->p > 1) {
-        return 0.0;
+    MomentAccumulator partial[MOMENT_SUPERBLOCK / MOMENT_BLOCK];
+    for (int offset = 0; offset < count; offset += MOMENT_SUPERBLOCK) {
+        int len = (count - offset < MOMENT_SUPERBLOCK) ? count - offset : MOMENT_SUPERBLOCK;
+        int blocks = (len + MOMENT_BLOCK - 1) / MOMENT_BLOCK;
+        for (int b = 0; b < blocks; b++) {
+            int block_len = (len - b * MOMENT_BLOCK < MOMENT_BLOCK) ? len - b * MOMENT_BLOCK : MOMENT_BLOCK;
+            block_moments(xs + offset + b * MOMENT_BLOCK, block_len, &partial[b]);
+        }
+        MomentAccumulator chunk;
+        merge_moment_accumulators_tree(partial, blocks, &chunk);
+        merge_moment_accumulators(acc, &chunk);
     }
+}
+
+// --- ПОТОКОВЫЕ МОМЕНТЫ ---
+// Обновление по одному значению (Welford, Terriberry) и объединение двух накопителей (Pébay, 2008).
+// Накапливаются суммы центральных степеней M2, M3, M4 относительно текущего среднего,
+// поэтому нет катастрофического вычитания, как при суммировании x, x^2, x^3, x^4.
+
+void init_moment_accumulator(MomentAccumulator *acc) {
+    memset(acc, 0, sizeof(MomentAccumulator));
+}
+
+void add_to_moment_accumulator(MomentAccumulator *acc, double x) {
+    double n1 = (double)acc->n;
+    acc->n++;
+    double n = (double)acc->n;
     
-    // Плотность первого распределения
-    double pdf1 = pdf_main(x, params->mu1, params->lambda1, params->v1);
-    
-    // Плотность второго распределения  
-    double pdf2 = pdf_main(x, params->mu2, params->lambda2, params->v2);
+    double delta = x - acc->mean;
+    double delta_n = delta / n;
+    double delta_n2 = delta_n * delta_n;
+    double term1 = delta * delta_n * n1;
     
-    return params->p * pdf1 + (1.0 - params->p) * pdf2;
+    acc->mean += delta_n;
+    acc->m4 += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * acc->m2 - 4 * delta_n * acc->m3;
+    acc->m3 += term1 * delta_n * (n - 2) - 3 * delta_n * acc->m2;
+    acc->m2 += term1;
 }
 
-void moments_mixture(MixtureParams *params, double *mean, double *variance, double *skewness, double *kurtosis) {
-    if (params == NULL || params->p < 0 || params->p > 1) {
-        if (mean) *mean = 0;
-        if (variance) *variance = 0;
-        if (skewness) *skewness = 0;
-        if (kurtosis) *kurtosis = 0;
+void add_many_to_moment_accumulator(MomentAccumulator *acc, const double *xs, int count) {
+    for (int i = 0; i < count; i++) {
+        add_to_moment_accumulator(acc, xs[i]);
+    }
+}
+
+void merge_moment_accumulators(MomentAccumulator *a, const MomentAccumulator *b) {
+    if (b->n == 0) return;
+    if (a->n == 0) {
+        *a = *b;
         return;
     }
     
-    // Моменты первого распределения
-    double m1, v1, s1, k1;
-    moments_main(params->mu1, params->lambda1, params->v1, &m1, &v1, &s1, &k1);
+    double na = (double)a->n;
+    double nb = (double)b->n;
+    double n = na + nb;
+    double delta = b->mean - a->mean;
+    double delta2 = delta * delta;
     
-    // Моменты второго распределения
-    double m2, v2, s2, k2;
-    moments_main(params->mu2, params->lambda2, params->v2, &m2, &v2, &s2, &k2);
+    double m2 = a->m2 + b->m2 + delta2 * na * nb / n;
+    double m3 = a->m3 + b->m3
+              + delta2 * delta * na * nb * (na - nb) / (n * n)
+              + 3 * delta * (na * b->m2 - nb * a->m2) / n;
+    double m4 = a->m4 + b->m4
+              + delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n)
+              + 6 * delta2 * (na * na * b->m2 + nb * nb * a->m2) / (n * n)
+              + 4 * delta * (na * b->m3 - nb * a->m3) / n;
     
-    // Математическое ожидание
-    if (mean) {
-        *mean = params->p * m1 + (1.0 - params->p) * m2;
+    a->mean += delta * nb / n;
+    a->m2 = m2;
+    a->m3 = m3;
+    a->m4 = m4;
+    a->n += b->n;
+}
+
+void merge_moment_accumulators_tree(MomentAccumulator *accs, int count, MomentAccumulator *result) {
+    init_moment_accumulator(result);
+    if (accs == NULL || count <= 0) return;
+
+    // Попарно: (0,1), (2,3), ... затем пары результатов и т.д. - ошибка растет как log(count)
+    for (int step = 1; step < count; step *= 2) {
+        for (int i = 0; i + step < count; i += 2 * step) {
+            merge_moment_accumulators(&accs[i], &accs[i + step]);
+        }
     }
+    *result = accs[0];
+}
+
+void moments_from_accumulator(const MomentAccumulator *acc, double *mean, double *variance, double *skewness, double *kurtosis) {
+    if (acc->n == 0) return;
     
-    // Дисперсия
-    if (variance) {
-        *variance = params->p * (v1 + m1 * m1) + (1.0 - params->p) * (v2 + m2 * m2) - (*mean) * (*mean);
+    if (mean) *mean = acc->mean;
+    double n = (double)acc->n;
+    finish_moments(acc->n, acc->m2 / n, acc->m3 / n, acc->m4 / n, variance, skewness, kurtosis);
+}
+
+double generate_empirical(double *sample, int sample_size) {
+    return generate_empirical_r(sample, sample_size, rng_default());
+}
+
+double generate_empirical_r(double *sample, int sample_size, RngState *rng) {
+    if (sample_size <= 0) return 0.0;
+    uint64_t random_index = rng_bounded(rng, (uint64_t)sample_size);
+    return sample[random_index];
+}
+
+void generate_empirical_n(double *sample, int sample_size, double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    if (sample == NULL || sample_size <= 0) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
     }
     
-    // Асимметрия и эксцесс требуют вычисления центральных моментов
-    if (skewness || kurtosis) {
-        // Центральные моменты третьего и четвертого порядка
-        double mu3_1 = s1 * pow(v1, 1.5) + 3 * m1 * v1 + m1 * m1 * m1;
-        double mu3_2 = s2 * pow(v2, 1.5) + 3 * m2 * v2 + m2 * m2 * m2;
-        
-        double mu4_1 = (k1 + 3) * v1 * v1 + 4 * m1 * s1 * pow(v1, 1.5) + 6 * m1 * m1 * v1 + m1 * m1 * m1 * m1;
-        double mu4_2 = (k2 + 3) * v2 * v2 + 4 * m2 * s2 * pow(v2, 1.5) + 6 * m2 * m2 * v2 + m2 * m2 * m2 * m2;
-        
-        // Моменты смеси
-        double mu3_mix = params->p * mu3_1 + (1.0 - params->p) * mu3_2;
-        double mu4_mix = params->p * mu4_1 + (1.0 - params->p) * mu4_2;
-        
-        if (skewness) {
-            *skewness = (mu3_mix - 3 * (*mean) * (*variance) - (*mean) * (*mean) * (*mean)) / pow(*variance, 1.5);
-        }
-        
-        if (kurtosis) {
-            *kurtosis = (mu4_mix - 4 * (*mean) * mu3_mix + 6 * (*mean) * (*mean) * (*variance) + 3 * (*mean) * (*mean) * (*mean) * (*mean)) / (*variance * *variance) - 3;
-        }
+    for (int i = 0; i < n; i++) {
+        out[i] = sample[rng_bounded(rng, (uint64_t)sample_size)];
     }
 }
 
-double generate_mixture(MixtureParams *params) {
-    if (params == NULL || params->p < 0 || params->p > 1) {
-        return 0.0;
+double generate_weighted_empirical_r(double *sample, const AliasTable *weights, RngState *rng) {
+    if (sample == NULL || weights == NULL) return 0.0;
+    return sample[draw_alias(weights, rng)];
+}
+
+void generate_weighted_empirical_n(double *sample, const AliasTable *weights, double *out, int n, RngState *rng) {
+    if (out == NULL || n <= 0) {
+        return;
+    }
+    if (sample == NULL || weights == NULL) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+    if (rng == NULL) {
+        rng = rng_default();
     }
     
-    // С вероятностью p генерируем из первого распределения,
-    // иначе - из второго
-    if (uniform_random() < params->p) {
-        return generate_main(params->mu1, params->lambda1, params->v1);
-    } else {
-        return generate_main(params->mu2, params->lambda2, params->v2);
+    for (int i = 0; i < n; i++) {
+        out[i] = sample[draw_alias(weights, rng)];
     }
 }
 
-// --- ЭМПИРИЧЕСКОЕ РАСПРЕДЕЛЕНИЕ ---
+// --- ЭКСПОРТ ДАННЫХ ДЛЯ ВИЗУАЛИЗАЦИИ ---
 
-double pdf_empirical(double x, double *sample, int sample_size) {
-    if (sample == NULL || sample_size <= 0) {
-        return 0.0;
+static int plot_messages = 1;
+
+void set_plot_messages(int enabled) {
+    plot_messages = enabled;
+}
+
+int plot_messages_enabled(void) {
+    return plot_messages;
+}
+
+void default_plot_grid_options(PlotGridOptions *options) {
+    options->points_count = 10000; // Фиксированное количество точек для гладкого графика
+    options->adaptive = 0;
+    options->tail_probability = 0.0;
+}
+
+// Теоретическая кривая графика: основное распределение или смесь двух, подготовленные один раз
+typedef struct {
+    int is_mixture;
+    double p;
+    SHDist first, second;
+} PlotCurve;
+
+static int prepare_plot_curve(PlotCurve *curve, const MixtureParams *params, int is_mixture) {
+    curve->is_mixture = is_mixture;
+    curve->p = params->p;
+    prepare_sh_dist(&curve->first, params->mu1, params->lambda1, params->v1);
+    if (is_mixture) {
+        if (params->p < 0 || params->p > 1) return -1;
+        prepare_sh_dist(&curve->second, params->mu2, params->lambda2, params->v2);
     }
-    
-    // 1. Находим min и max в выборке для определения диапазона
-    double x_min = sample[0];
-    double x_max = sample[0];
-    for (int i = 1; i < sample_size; i++) {
-        if (sample[i] < x_min) x_min = sample[i];
-        if (sample[i] > x_max) x_max = sample[i];
+    return 0;
+}
+
+// Плотность в n точках - те же операции, что в pdf_main_batch и pdf_mixture_batch
+static void eval_plot_curve(const PlotCurve *curve, const double *xs, double *ys, int n) {
+    pdf_sh_dist_batch(&curve->first, xs, ys, n);
+    if (curve->is_mixture) {
+        for (int i = 0; i < n; i++) {
+            ys[i] *= curve->p;
+        }
+        pdf_sh_dist_batch_add(&curve->second, 1.0 - curve->p, xs, ys, n);
     }
+}
+
+// Стандартизованная граница t, для которой P(Z > t) <= tail (оценка из описания plot_range_tail)
+static double sh_tail_bound(const SHDist *dist, double tail) {
+    double v = dist->v;
+    double log_c = dist->log_norm + log(dist->lambda); // Нормировка стандартизованной плотности
+    double target = log(tail);
     
-    // 2. Определяем число интервалов (по правилу Старджеса)
-    int n_bins = (int)(1 + 3.322 * log10(sample_size));
-    if (n_bins < 5) n_bins = 5;
-    if (n_bins > 50) n_bins = 50;
+    double lo = 0.0, hi = 1.0;
+    for (;;) {
+        double g = sqrt(v * v + v * hi * hi);
+        if (log_c - g + log(g / (v * hi)) <= target || hi > 1e300) break;
+        lo = hi;
+        hi *= 2.0;
+    }
+    for (int i = 0; i < 100; i++) {
+        double t = 0.5 * (lo + hi);
+        double g = sqrt(v * v + v * t * t);
+        if (log_c - g + log(g / (v * t)) > target) {
+            lo = t;
+        } else {
+            hi = t;
+        }
+    }
+    return hi;
+}
+
+void plot_range_tail(const MixtureParams *params, int is_mixture, double tail_probability,
+                     double *x_min, double *x_max) {
+    PlotCurve curve;
+    if (!(tail_probability > 0 && tail_probability < 1) ||
+        prepare_plot_curve(&curve, params, is_mixture) != 0) {
+        plot_range(params, is_mixture, x_min, x_max);
+        return;
+    }
     
-    // 3. Ширина интервала
-    double bin_width = (x_max - x_min) / n_bins;
-    if (bin_width < 1e-10) {
-        // Все значения одинаковые
-        return (x >= x_min && x <= x_max) ? (1.0 / (x_max - x_min + 1e-10)) : 0.0;
+    // Каждый хвост каждой компоненты - не больше половины допустимой вероятности;
+    // для смеси вероятности хвостов компонент складываются с весами p и 1 - p
+    const SHDist *components[2] = { &curve.first, &curve.second };
+    double weights[2] = { is_mixture ? params->p : 1.0, 1.0 - params->p };
+    int found = 0;
+    for (int k = 0; k < (is_mixture ? 2 : 1); k++) {
+        const SHDist *dist = components[k];
+        if (!dist->valid || !(weights[k] > 0)) continue;
+        double t = sh_tail_bound(dist, 0.5 * tail_probability);
+        double left = dist->mu - dist->lambda * t;
+        double right = dist->mu + dist->lambda * t;
+        if (!found || left < *x_min) *x_min = left;
+        if (!found || right > *x_max) *x_max = right;
+        found = 1;
+    }
+    if (!found) {
+        plot_range(params, is_mixture, x_min, x_max);
+    }
+}
+
+// --- АДАПТИВНАЯ СЕТКА ---
+
+#define GRID_BATCH 64   // Отрезков, делимых за один шаг (их середины считаются одной пачкой)
+
+typedef struct {
+    double a, b;        // Концы отрезка
+    double fa, fb;      // Плотность на концах
+    double fm;          // Плотность в середине
+    double error;       // |fm - (fa + fb) / 2| - отклонение от линейной интерполяции
+} GridInterval;
+
+static void grid_heap_push(GridInterval *heap, int *size, GridInterval item) {
+    int i = (*size)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].error >= item.error) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = item;
+}
+
+static GridInterval grid_heap_pop(GridInterval *heap, int *size) {
+    GridInterval top = heap[0];
+    GridInterval last = heap[--(*size)];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= *size) break;
+        if (child + 1 < *size && heap[child + 1].error > heap[child].error) child++;
+        if (heap[child].error <= last.error) break;
+        heap[i] = heap[child];
+        i = child;
     }
+    if (*size > 0) heap[i] = last;
+    return top;
+}
+
+static int compare_grid_points(const void *a, const void *b) {
+    double x = ((const double*)a)[0];
+    double y = ((const double*)b)[0];
+    return (x > y) - (x < y);
+}
+
+static int adaptive_plot_grid(const PlotCurve *curve, double x_min, double x_max, int budget,
+                              double *xs, double *ys) {
+    int initial = budget / 4;
+    if (initial < 3) initial = 3;
     
-    // 4. Определяем, в какой интервал попадает x
-    int bin_index = (int)((x - x_min) / bin_width);
-    if (bin_index < 0 || bin_index >= n_bins) {
-        return 0.0; // x outside range
+    GridInterval *heap = (GridInterval*)malloc(budget * sizeof(GridInterval));
+    GridInterval *split = (GridInterval*)malloc(GRID_BATCH * sizeof(GridInterval));
+    double *points = (double*)malloc(2 * budget * sizeof(double)); // Пары (x, f(x)) для сортировки
+    double mid_x[2 * GRID_BATCH], mid_f[2 * GRID_BATCH];
+    if (!heap || !split || !points) {
+        free(heap);
+        free(split);
+        free(points);
+        return -1;
     }
     
-    // 5. Подсчитываем количество точек в этом интервале
-    int count = 0;
-    double bin_start = x_min + bin_index * bin_width;
-    double bin_end = bin_start + bin_width;
+    // Равномерная начальная сетка
+    for (int i = 0; i < initial; i++) {
+        xs[i] = x_min + (x_max - x_min) * i / (initial - 1);
+    }
+    eval_plot_curve(curve, xs, ys, initial);
+    int count = initial;
+    int heap_size = 0;
+    for (int start = 0; start < initial - 1; start += 2 * GRID_BATCH) {
+        int n = (initial - 1 - start < 2 * GRID_BATCH) ? initial - 1 - start : 2 * GRID_BATCH;
+        for (int i = 0; i < n; i++) {
+            mid_x[i] = 0.5 * (xs[start + i] + xs[start + i + 1]);
+        }
+        eval_plot_curve(curve, mid_x, mid_f, n);
+        for (int i = 0; i < n; i++) {
+            int j = start + i;
+            GridInterval item = { xs[j], xs[j + 1], ys[j], ys[j + 1], mid_f[i], 0.0 };
+            item.error = fabs(item.fm - 0.5 * (item.fa + item.fb));
+            grid_heap_push(heap, &heap_size, item);
+        }
+    }
     
-    for (int i = 0; i < sample_size; i++) {
-        if (sample[i] >= bin_start && sample[i] < bin_end) {
+    // Делим отрезки с наибольшим отклонением, пока не исчерпан бюджет
+    while (count < budget && heap_size > 0) {
+        int n = budget - count;
+        if (n > GRID_BATCH) n = GRID_BATCH;
+        if (n > heap_size) n = heap_size;
+        for (int i = 0; i < n; i++) {
+            split[i] = grid_heap_pop(heap, &heap_size);
+            double m = 0.5 * (split[i].a + split[i].b);
+            xs[count] = m;
+            ys[count] = split[i].fm;
             count++;
+            mid_x[2 * i] = 0.5 * (split[i].a + m);
+            mid_x[2 * i + 1] = 0.5 * (m + split[i].b);
         }
-    }
-    // Особый случай для последнего интервала (включаем правую границу)
-    if (bin_index == n_bins - 1) {
-        for (int i = 0; i < sample_size; i++) {
-            if (sample[i] == x_max) {
-                count++;
-            }
+        eval_plot_curve(curve, mid_x, mid_f, 2 * n);
+        for (int i = 0; i < n; i++) {
+            double m = 0.5 * (split[i].a + split[i].b);
+            GridInterval left = { split[i].a, m, split[i].fa, split[i].fm, mid_f[2 * i], 0.0 };
+            GridInterval right = { m, split[i].b, split[i].fm, split[i].fb, mid_f[2 * i + 1], 0.0 };
+            left.error = fabs(left.fm - 0.5 * (left.fa + left.fb));
+            right.error = fabs(right.fm - 0.5 * (right.fa + right.fb));
+            grid_heap_push(heap, &heap_size, left);
+            grid_heap_push(heap, &heap_size, right);
         }
     }
     
-    // 6. Плотность = (доля точек) / (ширина интервала)
-    return (double)count / (sample_size * bin_width);
+    // Узлы добавлялись не по порядку - сортируем пары (x, f(x))
+    for (int i = 0; i < count; i++) {
+        points[2 * i] = xs[i];
+        points[2 * i + 1] = ys[i];
+    }
+    qsort(points, count, 2 * sizeof(double), compare_grid_points);
+    for (int i = 0; i < count; i++) {
+        xs[i] = points[2 * i];
+        ys[i] = points[2 * i + 1];
+    }
+    
+    free(heap);
+    free(split);
+    free(points);
+    return count;
 }
 
-void moments_empirical(double *sample, int sample_size, double *mean, double *variance, double *skewness, double *kurtosis) {
-    if (sample_size == 0) return;
-
-    double m = 0.0;
-    for (int i = 0; i < sample_size; i++) {
-        m += sample[i];
+int build_plot_grid(const MixtureParams *params, int is_mixture, const PlotGridOptions *options,
+                    double *xs, double *ys) {
+    PlotGridOptions defaults;
+    if (options == NULL) {
+        default_plot_grid_options(&defaults);
+        options = &defaults;
     }
-    m /= sample_size;
-    if (mean) *mean = m;
-
-    if (!variance && !skewness && !kurtosis) return;
-
-    double mu2 = 0.0, mu3 = 0.0, mu4 = 0.0;
-    for (int i = 0; i < sample_size; i++) {
-        double diff = sample[i] - m;
-        double diff2 = diff * diff;
-        mu2 += diff2;
-        mu3 += diff2 * diff;
-        mu4 += diff2 * diff2;
+    int n = options->points_count;
+    if (params == NULL || xs == NULL || ys == NULL || n < 2) {
+        return -1;
     }
-    mu2 /= sample_size;
-    mu3 /= sample_size;
-    mu4 /= sample_size;
-
-    double var_corrected = (sample_size > 1) ? (mu2 * sample_size / (sample_size - 1)) : 0.0;
-    if (variance) *variance = var_corrected;
-
-    if (skewness) {
-        *skewness = (mu2 > 0) ? (mu3 / pow(mu2, 1.5)) : 0.0;
+    
+    // Определяем диапазон x
+    double x_min, x_max;
+    plot_range_tail(params, is_mixture, options->tail_probability, &x_min, &x_max);
+    
+    PlotCurve curve;
+    if (prepare_plot_curve(&curve, params, is_mixture) != 0) {
+        // Некорректный вес смеси: нулевая кривая, как у pdf_mixture_batch
+        for (int i = 0; i < n; i++) {
+            xs[i] = x_min + (x_max - x_min) * i / (n - 1);
+            ys[i] = 0.0;
+        }
+        return n;
     }
-    if (kurtosis) {
-        *kurtosis = (mu2 > 0) ? (mu4 / (mu2 * mu2) - 3.0) : 0.0;
+    
+    if (options->adaptive && n >= 8) {
+        return adaptive_plot_grid(&curve, x_min, x_max, n, xs, ys);
+    }
+    
+    // Генерируем точки для теоретической кривой
+    for (int i = 0; i < n; i++) {
+        xs[i] = x_min + (x_max - x_min) * i / (n - 1);
     }
+    
+    // Плотность во всех точках сразу: функции Бесселя считаются один раз на кривую,
+    // а сама плотность - векторными ядрами
+    eval_plot_curve(&curve, xs, ys, n);
+    return n;
 }
 
-double generate_empirical(double *sample, int sample_size) {
-    if (sample_size == 0) return 0.0;
-    int random_index = rand() % sample_size;
-    return sample[random_index];
+void plot_range(const MixtureParams *params, int is_mixture, double *x_min, double *x_max) {
+    if (is_mixture) {
+        // Для смеси используем расширенный диапазон
+        *x_min = -15;
+        *x_max = 15;
+        
+        // Корректируем диапазон в зависимости от параметров
+        if (params->mu1 < *x_min) *x_min = params->mu1 - 8;
+        if (params->mu2 < *x_min) *x_min = params->mu2 - 8;
+        if (params->mu1 > *x_max) *x_max = params->mu1 + 8;
+        if (params->mu2 > *x_max) *x_max = params->mu2 + 8;
+    } else {
+        // Для основного распределения
+        *x_min = -10;
+        *x_max = 10;
+        if (params->mu1 < *x_min) *x_min = params->mu1 - 5;
+        if (params->mu1 > *x_max) *x_max = params->mu1 + 5;
+    }
 }
 
-// --- ЭКСПОРТ ДАННЫХ ДЛЯ ВИЗУАЛИЗАЦИИ ---
-
 PlotData* generate_plot_data(const char* test_case, MixtureParams* params, int is_mixture, 
                             double* empirical_sample, int empirical_size) {
+    return generate_plot_data_grid(test_case, params, is_mixture, empirical_sample, empirical_size, NULL);
+}
+
+PlotData* generate_plot_data_grid(const char* test_case, MixtureParams* params, int is_mixture, 
+                                  double* empirical_sample, int empirical_size,
+                                  const PlotGridOptions *options) {
+    PlotGridOptions defaults;
+    if (options == NULL) {
+        default_plot_grid_options(&defaults);
+        options = &defaults;
+    }
+    if (options->points_count < 2) return NULL;
+    
     PlotData* data = (PlotData*)malloc(sizeof(PlotData));
     if (!data) return NULL;
     
     // Инициализация полей
     strcpy(data->title, test_case);
     sprintf(data->filename, "data/plot_data_%s.txt", test_case);
-    data->points_count = 10000; // Фиксированное количество точек для гладкого графика
+    data->points_count = options->points_count;
     data->empirical_size = empirical_size;
     
     // Выделение памяти
@@ -324,36 +2226,9 @@ PlotData* generate_plot_data(const char* test_case, MixtureParams* params, int i
         return NULL;
     }
     
-    // Определяем диапазон x
-    double x_min, x_max;
-    
-    if (is_mixture) {
-        // Для смеси используем расширенный диапазон
-        x_min = -15;
-        x_max = 15;
-        
-        // Корректируем диапазон в зависимости от параметров
-        if (params->mu1 < x_min) x_min = params->mu1 - 8;
-        if (params->mu2 < x_min) x_min = params->mu2 - 8;
-        if (params->mu1 > x_max) x_max = params->mu1 + 8;
-        if (params->mu2 > x_max) x_max = params->mu2 + 8;
-    } else {
-        // Для основного распределения
-        x_min = -10;
-        x_max = 10;
-        if (params->mu1 < x_min) x_min = params->mu1 - 5;
-        if (params->mu1 > x_max) x_max = params->mu1 + 5;
-    }
-    
-    // Генерируем точки для теоретической кривой
-    for (int i = 0; i < data->points_count; i++) {
-        data->x_values[i] = x_min + (x_max - x_min) * i / (data->points_count - 1);
-        
-        if (is_mixture) {
-            data->y_values[i] = pdf_mixture(data->x_values[i], params);
-        } else {
-            data->y_values[i] = pdf_main(data->x_values[i], params->mu1, params->lambda1, params->v1);
-        }
+    if (build_plot_grid(params, is_mixture, options, data->x_values, data->y_values) < 0) {
+        free_plot_data(data);
+        return NULL;
     }
     
     return data;
@@ -385,7 +2260,9 @@ int save_plot_data(PlotData* data) {
     }
     
     fclose(file);
-    printf("Данные сохранены в файл: %s\n", data->filename);
+    if (plot_messages) {
+        fprintf(stderr, "Данные сохранены в файл: %s\n", data->filename);
+    }
     return 0;
 }
 
@@ -7,6 +7,8 @@
 #include <time.h>
 #include <string.h>
 
+#include "rng.h"
+
 // --- ВСПОМОГАТЕЛЬНЫЕ МАТЕМАТИЧЕСКИЕ ФУНКЦИИ ---
 // Эта группа функций реализует сложную математику, необходимую для расчетов.
 // Они являются основой для функций основных распределений.
@@ -20,6 +22,87 @@
  */
 double bessel_k(double nu, double x);
 
+/**
+ * @brief K_nu(x) e^x - не уходит в 0 при больших x, в отличие от K_nu(x) (меньше 2^-1022 при x > ~700).
+ */
+double bessel_k_scaled(double nu, double x);
+
+// --- БЫСТРОЕ ВЫЧИСЛЕНИЕ ФУНКЦИЙ БЕССЕЛЯ ---
+// При переборе параметров и подгонке K_nu(x) вызывается с одними и теми же nu (0..3) и медленно
+// меняющимся x. Два необязательных уровня поверх bessel_k:
+//   1) bessel_k_cached - запоминает последние пары (nu, x) в каждом потоке; значение точно совпадает с bessel_k;
+//   2) BesselTable - кусочные полиномы Чебышева для log K_nu(x), nu = 0..3, на заданном отрезке x
+//      с проверенной относительной погрешностью. Включается явно через use_bessel_table.
+// Функции распределений вызывают bessel_k_fast: таблица (если включена и x в ее отрезке), иначе кэш.
+
+/**
+ * @brief K_nu(x) с запоминанием последних значений.
+ * @note Кэш свой у каждого потока (на 256 пар), поэтому функция потокобезопасна.
+ */
+double bessel_k_cached(double nu, double x);
+
+/**
+ * @brief Число промахов кэша в текущем потоке (вызовов bessel_k и bessel_k_scaled) с начала работы.
+ * @note Кэш общий для bessel_k_cached и K_nu(x) e^x из bessel_k_ratios.
+ */
+uint64_t bessel_cache_misses(void);
+
+/**
+ * @brief Таблица log K_nu(x) для nu = 0, 1, 2, 3 на отрезке [x_min, x_max].
+ * @note Отрезок log x делится на segments равных частей, на каждой log K_nu(x) + x
+ *       приближается полиномом Чебышева степени degree по переменной log x.
+ */
+typedef struct {
+    double x_min, x_max;     // Отрезок, на котором работает таблица
+    int segments;            // Число частей
+    int degree;              // Степень полинома на каждой части
+    double log_min;          // log x_min
+    double inv_width;        // segments / (log x_max - log x_min)
+    double *coef;            // Коэффициенты: [nu][segment][degree + 1]
+    double max_rel_error;    // Наибольшая относительная погрешность K_nu, найденная при проверке
+} BesselTable;
+
+/**
+ * @brief Строит таблицу с относительной погрешностью не больше tolerance.
+ * @param x_min Левая граница отрезка (> 0).
+ * @param x_max Правая граница отрезка (> x_min).
+ * @param tolerance Допустимая относительная погрешность K_nu (например, 1e-12).
+ * @return Указатель на таблицу или NULL (некорректные границы, нет памяти, точность недостижима).
+ * @note Погрешность проверяется сравнением с GSL в точках посередине между узлами и должна быть
+ *       не больше tolerance / 2, иначе число частей удваивается. Точность самой GSL около 1e-14,
+ *       поэтому tolerance меньше ~1e-13 недостижима.
+ */
+BesselTable* build_bessel_table(double x_min, double x_max, double tolerance);
+
+/**
+ * @brief K_nu(x) по таблице.
+ * @note Для nu вне 0..3 или x вне отрезка таблицы возвращает bessel_k_cached(nu, x).
+ */
+double bessel_table_k(const BesselTable *table, double nu, double x);
+
+/**
+ * @brief Освобождает память, занятую таблицей.
+ */
+void free_bessel_table(BesselTable *table);
+
+/**
+ * @brief Включает таблицу для bessel_k_fast (NULL - выключить).
+ * @note Таблица должна жить, пока включена. Переключать, пока другие потоки считают, нельзя.
+ */
+void use_bessel_table(const BesselTable *table);
+
+/**
+ * @brief K_nu(x) через включенную таблицу или кэш.
+ */
+double bessel_k_fast(double nu, double x);
+
+/**
+ * @brief Отношения K_1(v) / K_2(v) и K_3(v) / K_2(v) (NULL - не нужно).
+ * @note Считаются по K_nu(v) e^v (таблица или кэш), поэтому конечны при любом v > 0:
+ *       через сами K_nu(v) формула эксцесса 3 K_3 K_1 / K_2^2 дает NaN уже при v > ~354.
+ */
+void bessel_k_ratios(double v, double *k1_over_k2, double *k3_over_k2);
+
 // --- ОСНОВНОЕ РАСПРЕДЕЛЕНИЕ (СГР) ---
 // Эта группа функций работает с одним симметричным гиперболическим распределением,
 // параметризованным сдвигом (mu), масштабом (lambda) и параметром формы (v).
@@ -31,6 +114,9 @@ double bessel_k(double nu, double x);
  * @param lambda Параметр масштаба.
  * @param v Параметр формы.
  * @return Значение плотности f(x; mu, lambda, v).
+ * @note Для v из distributions_shapes.h (0.5, 1, 2) функции Бесселя не вычисляются:
+ *       работает ядро с константами времени компиляции. То же в moments_main,
+ *       generate_main_n и prepare_sh_dist.
  */
 double pdf_main(double x, double mu, double lambda, double v);
 
@@ -49,19 +135,214 @@ void moments_main(double mu, double lambda, double v, double *mean, double *vari
 // Вспомогательная функция для генерации равномерного распределения
 double uniform_random();
 
-// Вспомогательная функция для генерации стандартной нормальной величины (метод Бокса-Мюллера)
+// Вспомогательная функция для генерации стандартной нормальной величины (метод зиккурата, см. rng_normal)
 double normal_random();
 
+// Варианты с суффиксом _r берут состояние генератора явно (см. rng.h) и потокобезопасны,
+// если у каждого потока свое состояние. Функции без суффикса используют rng_default().
+
+// Равномерная величина на [0, 1) от заданного генератора
+double uniform_random_r(RngState *rng);
+
+// Стандартная нормальная величина от заданного генератора
+double normal_random_r(RngState *rng);
+
+// Заполняет массив n стандартными нормальными величинами (rng == NULL - генератор по умолчанию)
+void normal_random_n(double *out, int n, RngState *rng);
+
+/**
+ * @brief Подготовленный генератор смешивающей величины W ~ GIG(1, omega, omega).
+ * @note Основное распределение - нормальная смесь X = mu + lambda * sqrt(W) * Z,
+ *       поэтому для (lambda, v) достаточно один раз подготовить генератор W с omega = v.
+ *       Метод отношения равномерных (Hörmann, Leydold, 2014): со сдвигом моды при omega > 3,
+ *       без сдвига иначе. Среднее число попыток ограничено при любом omega, запасной ветки нет.
+ */
+typedef struct {
+    double omega;        // Параметр GIG (для СГР равен v)
+    double s;            // omega / 4
+    double nc;           // Логарифм sqrt(g(моды)) - нормировка условия принятия
+    double shift;        // Сдвиг X = U/V + shift (0 или мода = 1)
+    double u_min, u_max; // Границы прямоугольника по U
+} GIGSampler;
+
+/**
+ * @brief Считает константы генератора GIG для заданного omega (> 0).
+ */
+void prepare_gig_sampler(GIGSampler *gig, double omega);
+
+/**
+ * @brief Генерирует одно значение W ~ GIG(1, omega, omega).
+ */
+double generate_gig_r(const GIGSampler *gig, RngState *rng);
+
 /**
  * @brief Генерирует одну случайную величину, распределенную согласно основному распределению.
  * @param mu Параметр сдвига.
  * @param lambda Параметр масштаба.
  * @param v Параметр формы.
  * @return Смоделированное значение.
- * @note Реализует алгоритм из варианта (шаги 1-4).
+ * @note Точный алгоритм: W ~ GIG(1, v, v) (см. GIGSampler), затем mu + lambda * sqrt(W) * Z.
+ *       Заменяет отбор из варианта (шаги 1-4), который при малых v мог исчерпать 1000 попыток
+ *       и вернуть нормальную величину вместо нужной.
  */
 double generate_main(double mu, double lambda, double v);
 
+/**
+ * @brief То же, что generate_main, но с явным состоянием генератора.
+ */
+double generate_main_r(double mu, double lambda, double v, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями основного распределения.
+ * @param mu Параметр сдвига.
+ * @param lambda Параметр масштаба.
+ * @param v Параметр формы.
+ * @param out Массив для результатов (выделяется вызывающим, n элементов).
+ * @param n Количество значений.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ * @note Генератор GIG подготавливается один раз на весь массив, а равномерные величины
+ *       генерируются пачками. Для больших выборок это заметно быстрее цикла по generate_main.
+ */
+void generate_main_n(double mu, double lambda, double v, double *out, int n, RngState *rng);
+
+// --- СТАТИСТИКА ГЕНЕРАТОРА ---
+// Необязательный учет работы отбора GIG: число предложений и принятий, распределение числа
+// попыток на одно значение и расход слов генератора. Статистика подключается к текущему потоку
+// (attach_sampler_stats) и заполняется функциями generate_main_n, generate_sh_dist_n,
+// generate_mixture_k_n и всем, что через них работает. Без подключенной статистики цикл
+// отбора не меняется: счетчик попыток локальный, запись - одна проверка на значение.
+// Для параллельной генерации статистика по потокам пула - attach_pool_sampler_stats.
+
+#define SAMPLER_HISTOGRAM_SIZE 16
+
+/**
+ * @brief Статистика генератора основного распределения.
+ * @note Запасной ветки (нормальная величина после исчерпания попыток) у отбора GIG нет,
+ *       поэтому вместо счетчика отказов - max_attempts и хвост гистограммы.
+ */
+typedef struct {
+    uint64_t values;         // Сгенерировано значений
+    uint64_t proposals;      // Предложений отбора (по две равномерные величины)
+    uint64_t acceptances;    // Принятых предложений (равно values)
+    uint64_t max_attempts;   // Наибольшее число попыток на одно значение
+    uint64_t attempts_histogram[SAMPLER_HISTOGRAM_SIZE]; // [k] - значений с k + 1 попытками,
+                                                          // последний - с SAMPLER_HISTOGRAM_SIZE и более
+    uint64_t rng_draws;      // Слов генератора (64 бит): равномерные, нормальные, выбор компоненты
+} SamplerStats;
+
+/**
+ * @brief Обнуляет статистику.
+ */
+void init_sampler_stats(SamplerStats *stats);
+
+/**
+ * @brief Добавляет статистику source к target (например, итог по потокам).
+ */
+void merge_sampler_stats(SamplerStats *target, const SamplerStats *source);
+
+/**
+ * @brief Подключает статистику к текущему потоку.
+ * @param stats Куда добавлять статистику (NULL - отключить учет).
+ * @return Ранее подключенная статистика (чтобы восстановить ее после замера).
+ * @note Статистика только накапливается: перед замером ее обнуляет init_sampler_stats.
+ */
+SamplerStats* attach_sampler_stats(SamplerStats *stats);
+
+/**
+ * @brief Доля принятых предложений (0, если предложений не было).
+ */
+double sampler_acceptance_rate(const SamplerStats *stats);
+
+/**
+ * @brief Основное распределение, подготовленное для многократного использования.
+ * @note Функции Бесселя и все константы, зависящие только от (mu, lambda, v),
+ *       считаются один раз в prepare_sh_dist. Дальше плотность стоит одного sqrt и одного exp,
+ *       моменты берутся готовыми, генерация не пересчитывает константы GIG.
+ */
+typedef struct {
+    double mu, lambda, v;   // Параметры распределения
+    int valid;              // 0 - некорректные параметры (lambda <= 0 или v <= 0)
+    double inv_lambda;      // 1 / lambda
+    double inv_v;           // 1 / v
+    double norm;            // Нормировка плотности: 1 / (2 * sqrt(v) * K_1(v) * lambda)
+    double log_norm;        // log(norm)
+    double mean, variance, skewness, kurtosis; // Теоретические моменты
+    GIGSampler gig;         // Генератор смешивающей величины
+} SHDist;
+
+/**
+ * @brief Подготавливает основное распределение.
+ * @param dist Указатель на структуру для заполнения.
+ * @param mu Параметр сдвига.
+ * @param lambda Параметр масштаба.
+ * @param v Параметр формы.
+ * @return 0 при успехе, -1 при некорректных параметрах (тогда плотность 0, моменты 0, генерация дает 0.0).
+ */
+int prepare_sh_dist(SHDist *dist, double mu, double lambda, double v);
+
+/**
+ * @brief Плотность подготовленного распределения в точке x (совпадает с pdf_main).
+ */
+double pdf_sh_dist(double x, const SHDist *dist);
+
+/**
+ * @brief Логарифм плотности подготовленного распределения в точке x.
+ * @note Не теряет точность в хвостах, где сама плотность уходит в 0.
+ */
+double logpdf_sh_dist(double x, const SHDist *dist);
+
+/**
+ * @brief Теоретические моменты подготовленного распределения (совпадают с moments_main).
+ */
+void moments_sh_dist(const SHDist *dist, double *mean, double *variance, double *skewness, double *kurtosis);
+
+/**
+ * @brief Генерирует одно значение подготовленного распределения.
+ */
+double generate_sh_dist(const SHDist *dist, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями подготовленного распределения.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ */
+void generate_sh_dist_n(const SHDist *dist, double *out, int n, RngState *rng);
+
+// --- ВЫБОР С ВЕСАМИ (ALIAS-ТАБЛИЦА) ---
+// Метод Уолкера (в варианте Воуза): после подготовки за O(K) каждый выбор
+// одного из K вариантов с заданными весами стоит O(1) - одна случайная величина и одно сравнение.
+
+/**
+ * @brief Alias-таблица для выбора номера 0 .. size - 1 с заданными весами.
+ */
+typedef struct {
+    int size;       // Количество вариантов
+    double *prob;   // Вероятность оставить выпавшую ячейку i
+    int *alias;     // Номер, который выбирается вместо i с вероятностью 1 - prob[i]
+} AliasTable;
+
+/**
+ * @brief Строит alias-таблицу.
+ * @param weights Неотрицательные веса (нормировать не нужно).
+ * @param count Количество весов.
+ * @return Указатель на таблицу или NULL (нет памяти, отрицательный вес, сумма весов не положительна).
+ */
+AliasTable* build_alias_table(const double *weights, int count);
+
+/**
+ * @brief Выбирает один номер по таблице.
+ */
+int draw_alias(const AliasTable *table, RngState *rng);
+
+/**
+ * @brief Заполняет массив n номерами, выбранными по таблице.
+ */
+void draw_alias_n(const AliasTable *table, int *out, int n, RngState *rng);
+
+/**
+ * @brief Освобождает память, занятую таблицей.
+ */
+void free_alias_table(AliasTable *table);
+
 // --- СМЕСЬ РАСПРЕДЕЛЕНИЙ ---
 // Эта группа функций работает со смесью двух основных распределений (СГР).
 // Параметры объединены в структуру MixtureParams для удобства передачи.
@@ -103,6 +384,286 @@ void moments_mixture(MixtureParams *params, double *mean, double *variance, doub
  */
 double generate_mixture(MixtureParams *params);
 
+/**
+ * @brief То же, что generate_mixture, но с явным состоянием генератора.
+ */
+double generate_mixture_r(MixtureParams *params, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями смеси.
+ * @param params Указатель на структуру с параметрами смеси.
+ * @param out Массив для результатов (выделяется вызывающим, n элементов).
+ * @param n Количество значений.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ */
+void generate_mixture_n(MixtureParams *params, double *out, int n, RngState *rng);
+
+/**
+ * @brief Смесь произвольного числа K основных распределений с весами.
+ * @note Параметры компонент хранятся отдельными массивами (по одному на параметр),
+ *       рядом - подготовленные распределения и alias-таблица для выбора компоненты.
+ *       Двухкомпонентная MixtureParams - частный случай (create_mixture_from_params).
+ */
+typedef struct {
+    int count;            // Число компонент K
+    double *weight;       // Веса, нормированные к сумме 1
+    double *mu;           // Сдвиги компонент
+    double *lambda;       // Масштабы компонент
+    double *v;            // Параметры формы компонент
+    SHDist *components;   // Подготовленные компоненты
+    AliasTable *alias;    // Выбор компоненты по весам
+} Mixture;
+
+/**
+ * @brief Создает смесь из K компонент.
+ * @param count Число компонент.
+ * @param weights Веса компонент (неотрицательные, нормируются автоматически).
+ * @param mu Сдвиги компонент.
+ * @param lambda Масштабы компонент.
+ * @param v Параметры формы компонент.
+ * @return Указатель на смесь или NULL при ошибке.
+ */
+Mixture* create_mixture(int count, const double *weights, const double *mu, const double *lambda, const double *v);
+
+/**
+ * @brief Создает двухкомпонентную смесь по MixtureParams.
+ * @return Указатель на смесь или NULL (в том числе при p вне [0, 1]).
+ */
+Mixture* create_mixture_from_params(const MixtureParams *params);
+
+/**
+ * @brief Освобождает память, занятую смесью.
+ */
+void free_mixture(Mixture *mixture);
+
+/**
+ * @brief Генерирует одно значение смеси из K компонент.
+ */
+double generate_mixture_k(const Mixture *mixture, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями смеси из K компонент.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ * @note Номера компонент выбираются пачками по alias-таблице, без перебора накопленных весов.
+ */
+void generate_mixture_k_n(const Mixture *mixture, double *out, int n, RngState *rng);
+
+/**
+ * @brief Плотность смеси из K компонент в точке x.
+ */
+double pdf_mixture_k(double x, const Mixture *mixture);
+
+/**
+ * @brief Логарифм плотности смеси из K компонент в точке x.
+ * @note Считается через log-sum-exp, поэтому не уходит в -inf там, где плотность меньше DBL_MIN.
+ */
+double logpdf_mixture_k(double x, const Mixture *mixture);
+
+/**
+ * @brief Теоретические моменты смеси из K компонент.
+ * @note Сначала складываются с весами начальные моменты компонент E[X^j], j = 1..4,
+ *       затем из них получаются центральные моменты смеси.
+ */
+void moments_mixture_k(const Mixture *mixture, double *mean, double *variance, double *skewness, double *kurtosis);
+
+// --- ФУНКЦИЯ РАСПРЕДЕЛЕНИЯ И КВАНТИЛИ ---
+// Функция распределения считается квадратурой Гаусса-Лежандра (10 узлов на отрезок):
+//   - в центре - интеграл плотности от mu до x на отрезках, растущих с удалением от mu
+//     (плотность аналитична в полосе ширины sqrt(z^2 + v) вокруг точки z);
+//   - в хвосте - интеграл от x до бесконечности после замены u = omega(z) - omega(z_x),
+//     omega(z) = sqrt(v^2 + v z^2), поэтому малые вероятности хвостов считаются с полной
+//     относительной точностью, а не как 1 - F.
+// Квантиль находится методом Ньютона с защитой делением отрезка пополам.
+
+/**
+ * @brief Функция распределения основного распределения F(x) = P(X <= x).
+ * @return Значение F(x); для некорректных параметров 0.
+ */
+double cdf_main(double x, double mu, double lambda, double v);
+
+/**
+ * @brief Квантиль основного распределения: x, для которого F(x) = p.
+ * @param p Уровень (0 - -inf, 1 - +inf).
+ * @return Квантиль; NAN при p вне [0, 1]; 0 для некорректных параметров.
+ */
+double quantile_main(double p, double mu, double lambda, double v);
+
+/**
+ * @brief Функция распределения подготовленного распределения (совпадает с cdf_main).
+ */
+double cdf_sh_dist(double x, const SHDist *dist);
+
+/**
+ * @brief Квантиль подготовленного распределения (совпадает с quantile_main).
+ */
+double quantile_sh_dist(double p, const SHDist *dist);
+
+/**
+ * @brief Функция распределения смеси двух распределений.
+ * @return Значение F(x); 0 при p вне [0, 1].
+ */
+double cdf_mixture(double x, MixtureParams *params);
+
+/**
+ * @brief Квантиль смеси двух распределений.
+ * @note Искомое значение лежит между квантилями компонент того же уровня - это начальный отрезок поиска.
+ */
+double quantile_mixture(double p, MixtureParams *params);
+
+/**
+ * @brief Функция распределения смеси из K компонент.
+ */
+double cdf_mixture_k(double x, const Mixture *mixture);
+
+/**
+ * @brief Квантиль смеси из K компонент.
+ */
+double quantile_mixture_k(double p, const Mixture *mixture);
+
+// --- МОДЕЛИРОВАНИЕ МЕТОДОМ ОБРАТНОЙ ФУНКЦИИ ---
+// Таблица обратной функции распределения строится один раз для набора параметров:
+// узлы (u_i = F(x_i), x_i) и производные dx/du = 1 / f(x_i), между узлами - кубический
+// многочлен Эрмита. Отрезки делятся пополам, пока многочлен не станет монотонным (условие
+// Фрича-Карлсона) и ошибка |F(x(u)) - u| в середине отрезка не станет меньше заданной.
+// Узел для u находится через направляющую таблицу за O(1) в среднем, поэтому одно значение
+// стоит нескольких умножений - и каждое значение - монотонная функция одного u, что позволяет
+// подставлять квазислучайные точки (van_der_corput) вместо псевдослучайных.
+// Те же узлы с производными f(x_i) дают и прямой многочлен Эрмита для F(x): отрезки делятся,
+// пока и он не станет точнее tolerance, поэтому таблица заодно считает F(x) за O(1).
+// Узлы хранятся в стандартных координатах z = (x - location) / scale, а F считается по
+// компонентам с пересчитанными параметрами. Иначе при большом |mu| / lambda округление x
+// дает ошибку F больше tolerance и деление не останавливается; так число узлов не зависит
+// от сдвига и масштаба.
+
+/**
+ * @brief Таблица обратной функции распределения.
+ */
+typedef struct {
+    int size;               // Число узлов
+    double *u;              // u_i = F(x_i), по возрастанию
+    double *z;              // Узлы z_i = (x_i - location) / scale
+    double *slope;          // dz/du = 1 / (scale * f(x_i))
+    double location, scale; // Общие сдвиг и масштаб (для смеси - средний сдвиг и больший масштаб)
+    int guide_size;         // Размер направляющей таблицы
+    int *guide;             // guide[j] - последний узел с u_i <= u_min + j * (u_max - u_min) / guide_size
+    double u_min, u_max;    // Отрезок u, покрытый таблицей; вне его квантиль считается точно
+    double tolerance;       // Заданная ошибка по u
+    int *guide_z;           // То же по z на отрезке [z_0, z_last] - для cdf_inversion_table
+    double max_u_error;     // Наибольшая ошибка квантиля по u, найденная при построении
+    double max_cdf_error;   // Наибольшая ошибка F(x) по прямому многочлену
+    int count;              // Компоненты распределения (1 или 2) - для хвостов вне таблицы
+    double weights[2];
+    SHDist components[2];   // Исходные компоненты
+    SHDist standard[2];     // Компоненты в координатах z
+} InversionTable;
+
+/**
+ * @brief Строит таблицу обратной функции распределения.
+ * @param params Параметры распределения.
+ * @param is_mixture Флаг: 0 - основное распределение (mu1, lambda1, v1), 1 - смесь.
+ * @param tolerance Допустимая ошибка по u (от 1e-13 до 1e-3, например 1e-10).
+ * @return Указатель на таблицу или NULL (некорректные параметры, нет памяти).
+ * @note Хвосты с вероятностью меньше tolerance в таблицу не входят: для таких u
+ *       inversion_quantile вызывает точный квантиль (это случается с вероятностью 2 * tolerance).
+ */
+InversionTable* build_inversion_table(const MixtureParams *params, int is_mixture, double tolerance);
+
+/**
+ * @brief Приближенный квантиль по таблице: x, для которого F(x) = u с ошибкой не больше tolerance.
+ * @note Ошибка считается в координатах z; при переводе в x добавляется только округление x.
+ */
+double inversion_quantile(const InversionTable *table, double u);
+
+/**
+ * @brief Функция распределения по таблице с ошибкой не больше tolerance (вне узлов таблицы - точная).
+ */
+double cdf_inversion_table(const InversionTable *table, double x);
+
+/**
+ * @brief Функция распределения по таблице в n точках.
+ * @note Для упорядоченных xs узел ищется продвижением от предыдущего, без направляющей таблицы.
+ */
+void cdf_inversion_table_n(const InversionTable *table, const double *xs, double *out, int n);
+
+/**
+ * @brief Преобразует n заданных чисел из (0, 1) в значения распределения.
+ * @param uniforms Равномерные величины (псевдо- или квазислучайные).
+ * @note out[i] монотонно зависит от uniforms[i], поэтому стратификация и квазислучайные
+ *       последовательности переносятся на значения распределения без изменений.
+ */
+void generate_inversion_n(const InversionTable *table, const double *uniforms, double *out, int n);
+
+/**
+ * @brief Генерирует одно значение по таблице.
+ */
+double generate_inversion_r(const InversionTable *table, RngState *rng);
+
+/**
+ * @brief Освобождает память, занятую таблицей.
+ */
+void free_inversion_table(InversionTable *table);
+
+// --- ПАКЕТНОЕ ВЫЧИСЛЕНИЕ ПЛОТНОСТЕЙ ---
+// Плотность сразу в n точках с использованием AVX-512 / AVX2 (выбор при выполнении),
+// на других процессорах - скалярный цикл. Реализация в distributions_simd.c.
+// Точность: аргумент экспоненты считается теми же операциями, что и в скалярных функциях,
+// поэтому logpdf совпадает со скалярным результатом побитово, а pdf отличается
+// не более чем на 2 ULP (собственная векторная экспонента). Исключение - точки, где
+// exp(-v * sqrt(1 + z^2 / v)) меньше 2^-1022: там и скалярный результат теряет точность.
+
+/**
+ * @brief Плотность подготовленного распределения в n точках.
+ * @param dist Подготовленное распределение.
+ * @param xs Массив точек.
+ * @param out Массив для результатов (n элементов).
+ * @param n Количество точек.
+ */
+void pdf_sh_dist_batch(const SHDist *dist, const double *xs, double *out, int n);
+
+/**
+ * @brief Логарифм плотности подготовленного распределения в n точках.
+ */
+void logpdf_sh_dist_batch(const SHDist *dist, const double *xs, double *out, int n);
+
+/**
+ * @brief Добавляет к out взвешенную плотность: out[i] += weight * f(xs[i]).
+ * @note Основа для плотностей смесей: компоненты накапливаются в одном массиве.
+ */
+void pdf_sh_dist_batch_add(const SHDist *dist, double weight, const double *xs, double *out, int n);
+
+/**
+ * @brief Пакетный аналог pdf_main: out[i] = f(xs[i]; mu, lambda, v).
+ */
+void pdf_main_batch(const double *xs, double *out, int n, double mu, double lambda, double v);
+
+/**
+ * @brief Пакетный логарифм плотности основного распределения.
+ */
+void logpdf_main_batch(const double *xs, double *out, int n, double mu, double lambda, double v);
+
+/**
+ * @brief Пакетный аналог pdf_mixture.
+ */
+void pdf_mixture_batch(const double *xs, double *out, int n, MixtureParams *params);
+
+/**
+ * @brief Пакетная плотность смеси из K компонент.
+ * @note Компоненты обходятся по очереди, каждая добавляется ко всему массиву векторным ядром.
+ */
+void pdf_mixture_k_batch(const Mixture *mixture, const double *xs, double *out, int n);
+
+/**
+ * @brief Пакетный логарифм плотности смеси из K компонент (log-sum-exp).
+ * @note Точки обрабатываются кусками: для куска хранятся текущий максимум и сумма экспонент,
+ *       поэтому дополнительная память не зависит ни от n, ни от K.
+ */
+void logpdf_mixture_k_batch(const Mixture *mixture, const double *xs, double *out, int n);
+
+/**
+ * @brief Название выбранного набора инструкций: "avx512f", "avx2" или "scalar".
+ */
+const char* simd_kernel_name(void);
+
 // --- ЭМПИРИЧЕСКОЕ РАСПРЕДЕЛЕНИЕ ---
 // Эта группа функций работает не с параметрами, а с готовой выборкой данных (массивом чисел).
 // Сама выборка НЕ хранится внутри этих функций, а передается в качестве аргумента.
@@ -115,9 +676,51 @@ double generate_mixture(MixtureParams *params);
  * @return Оценка плотности f(x) по выборке.
  * @note Реализация может быть разной: построение гистограммы с последующим интерполированием
  *       или использование ядерных оценок плотности (KDE). Методичка предлагает гистограмму (формула 1.4).
+ *       Каждый вызов строит гистограмму заново (O(n)) - для многих точек используйте
+ *       build_empirical_histogram и pdf_empirical_many.
  */
 double pdf_empirical(double x, double *sample, int sample_size);
 
+/**
+ * @brief Предварительно построенная гистограмма выборки (правило Старджеса).
+ * @note Строится один раз за O(n), после чего плотность в любой точке считается за O(1).
+ *       Сама выборка не хранится - только границы и плотности интервалов.
+ */
+typedef struct {
+    double x_min, x_max;   // Границы выборки
+    double bin_width;      // Ширина интервала (0 - все значения одинаковые)
+    int n_bins;            // Число интервалов
+    double *density;       // Плотность в каждом интервале: count / (n * bin_width)
+} EmpiricalHistogram;
+
+/**
+ * @brief Строит гистограмму по выборке.
+ * @param sample Указатель на массив с данными выборки.
+ * @param sample_size Размер выборки.
+ * @return Указатель на гистограмму или NULL при ошибке (пустая выборка, нет памяти).
+ * @note Результат полностью совпадает с тем, что считает pdf_empirical для каждой точки.
+ */
+EmpiricalHistogram* build_empirical_histogram(double *sample, int sample_size);
+
+/**
+ * @brief Оценивает плотность в точке x по готовой гистограмме за O(1).
+ */
+double pdf_histogram(double x, const EmpiricalHistogram *hist);
+
+/**
+ * @brief Оценивает плотность сразу в m точках по готовой гистограмме.
+ * @param hist Гистограмма, построенная build_empirical_histogram.
+ * @param xs Массив точек.
+ * @param out Массив для результатов (m элементов).
+ * @param m Количество точек.
+ */
+void pdf_empirical_many(const EmpiricalHistogram *hist, const double *xs, double *out, int m);
+
+/**
+ * @brief Освобождает память, занятую гистограммой.
+ */
+void free_empirical_histogram(EmpiricalHistogram *hist);
+
 /**
  * @brief Вычисляет выборочные (эмпирические) моменты по предоставленной выборке.
  * @param sample Указатель на массив с данными выборки.
@@ -127,9 +730,86 @@ double pdf_empirical(double x, double *sample, int sample_size);
  * @param skewness Указатель для возврата выборочного коэффициента асимметрии.
  * @param kurtosis Указатель для возврата выборочного коэффициента эксцесса.
  * @note Моменты считаются по стандартным формулам статистики (напр., выборочная дисперсия с поправкой Бесселя).
+ *       Суммирование блочное (см. accumulate_moments_blocked); для больших массивов
+ *       есть многопоточный moments_empirical_parallel (parallel.h) с тем же результатом.
  */
 void moments_empirical(double *sample, int sample_size, double *mean, double *variance, double *skewness, double *kurtosis);
 
+/**
+ * @brief Выборочный квантиль уровня p с линейной интерполяцией (тип 7, как quantile в R и numpy).
+ * @param sample Выборка (частично переупорядочивается на месте).
+ * @param sample_size Размер выборки.
+ * @param from Сколько первых значений уже не больше искомого и не просматривается
+ *             (например, индекс квантиля меньшего уровня, найденного на том же массиве); обычно 0.
+ * @param p Уровень от 0 до 1.
+ * @return Квантиль: для упорядоченного массива x[k] + (p (n - 1) - k) (x[k + 1] - x[k]), k = [p (n - 1)].
+ * @note Порядковая статистика находится выбором за O(n) в среднем, сортировка не нужна.
+ */
+double quantile_empirical(double *sample, int sample_size, int from, double p);
+
+/**
+ * @brief Накопитель выборочных моментов для потоковой обработки данных.
+ * @note Значения добавляются по одному за один проход, выборку не нужно хранить целиком.
+ *       Накопители, собранные по разным частям данных (например, в разных потоках),
+ *       объединяются merge_moment_accumulators без повторного прохода.
+ */
+typedef struct {
+    long long n;   // Количество значений
+    double mean;   // Текущее среднее
+    double m2;     // Сумма (x - mean)^2
+    double m3;     // Сумма (x - mean)^3
+    double m4;     // Сумма (x - mean)^4
+} MomentAccumulator;
+
+/**
+ * @brief Обнуляет накопитель.
+ */
+void init_moment_accumulator(MomentAccumulator *acc);
+
+/**
+ * @brief Добавляет одно значение.
+ */
+void add_to_moment_accumulator(MomentAccumulator *acc, double x);
+
+/**
+ * @brief Добавляет count значений из массива.
+ */
+void add_many_to_moment_accumulator(MomentAccumulator *acc, const double *xs, int count);
+
+/**
+ * @brief Объединяет накопители: a становится накопителем по данным a и b вместе.
+ */
+void merge_moment_accumulators(MomentAccumulator *a, const MomentAccumulator *b);
+
+/**
+ * @brief Размер суперблока блочного подсчета моментов (moments_empirical и его параллельный вариант).
+ */
+#define MOMENT_SUPERBLOCK 262144
+
+/**
+ * @brief Считает накопитель по массиву блочным методом.
+ * @param xs Массив значений.
+ * @param count Количество значений.
+ * @param acc Накопитель для результата (перезаписывается).
+ * @note Массив делится на блоки по 4096 значений; в каждом блоке - два прохода по кэшу
+ *       с независимыми частичными суммами (векторизуются), блоки объединяются попарно.
+ *       Рассчитан на count <= MOMENT_SUPERBLOCK, большие массивы обрабатываются по суперблокам.
+ */
+void accumulate_moments_blocked(const double *xs, int count, MomentAccumulator *acc);
+
+/**
+ * @brief Объединяет count накопителей попарным деревом: ошибка округления растет как log(count).
+ * @note Массив accs используется как рабочий и портится.
+ */
+void merge_moment_accumulators_tree(MomentAccumulator *accs, int count, MomentAccumulator *result);
+
+/**
+ * @brief Вычисляет характеристики по накопителю.
+ * @note Формулы те же, что и в moments_empirical: для тех же данных результаты совпадают
+ *       с точностью до округления. Для пустого накопителя ничего не записывается.
+ */
+void moments_from_accumulator(const MomentAccumulator *acc, double *mean, double *variance, double *skewness, double *kurtosis);
+
 /**
  * @brief Генерирует одну случайную величину, подчиняющуюся эмпирическому распределению.
  * @param sample Указатель на массив с данными выборки.
@@ -139,6 +819,37 @@ void moments_empirical(double *sample, int sample_size, double *mean, double *va
  */
 double generate_empirical(double *sample, int sample_size);
 
+/**
+ * @brief То же, что generate_empirical, но с явным состоянием генератора.
+ * @note Индекс выбирается без смещения (rng_bounded), в отличие от rand() % sample_size.
+ */
+double generate_empirical_r(double *sample, int sample_size, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями эмпирического распределения (бутстрэп-выборка).
+ * @param sample Указатель на массив с данными выборки.
+ * @param sample_size Размер выборки.
+ * @param out Массив для результатов (n элементов).
+ * @param n Количество значений.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ */
+void generate_empirical_n(double *sample, int sample_size, double *out, int n, RngState *rng);
+
+/**
+ * @brief Генерирует значение взвешенного эмпирического распределения.
+ * @param sample Указатель на массив с данными выборки.
+ * @param weights Alias-таблица весов элементов (размер таблицы = размер выборки).
+ * @param rng Состояние генератора.
+ * @note Элемент sample[i] выбирается с вероятностью, пропорциональной своему весу.
+ */
+double generate_weighted_empirical_r(double *sample, const AliasTable *weights, RngState *rng);
+
+/**
+ * @brief Заполняет массив n значениями взвешенного эмпирического распределения.
+ * @param rng Состояние генератора (NULL - генератор по умолчанию).
+ */
+void generate_weighted_empirical_n(double *sample, const AliasTable *weights, double *out, int n, RngState *rng);
+
 // --- ЭКСПОРТ ДАННЫХ ДЛЯ ВИЗУАЛИЗАЦИИ ---
 
 /**
@@ -154,6 +865,61 @@ typedef struct {
     int empirical_size;
 } PlotData;
 
+/**
+ * @brief Настройки сетки теоретической кривой.
+ * @note Значения по умолчанию (default_plot_grid_options) дают прежнюю сетку:
+ *       10000 равноотстоящих точек на отрезке plot_range.
+ */
+typedef struct {
+    int points_count;          // Число точек кривой (бюджет вычислений плотности для равномерной сетки)
+    int adaptive;              // 1 - сгущать точки там, где кривая сильнее изгибается
+    double tail_probability;   // > 0 - отрезок, вне которого лежит не больше этой доли вероятности;
+                               // 0 - прежние фиксированные границы (plot_range)
+} PlotGridOptions;
+
+/**
+ * @brief Заполняет настройки сетки значениями по умолчанию.
+ */
+void default_plot_grid_options(PlotGridOptions *options);
+
+/**
+ * @brief Отрезок x, на котором строится теоретическая кривая графика.
+ * @param params Параметры распределения (для основного используются mu1, lambda1, v1).
+ * @param is_mixture Флаг: 0 - основное распределение, 1 - смесь.
+ * @param x_min Левая граница (выход).
+ * @param x_max Правая граница (выход).
+ */
+void plot_range(const MixtureParams *params, int is_mixture, double *x_min, double *x_max);
+
+/**
+ * @brief Отрезок x, вне которого вероятность не больше tail_probability.
+ * @param tail_probability Допустимая вероятность обоих хвостов вместе (0 < tail_probability < 1,
+ *        иначе используется plot_range).
+ * @note Хвост оценивается сверху: sqrt(v^2 + v z^2) выпукла по z, поэтому касательная в точке t
+ *       дает P(Z > t) <= C exp(-g(t)) g(t) / (v t), g(t) = sqrt(v^2 + v t^2), C - нормировка.
+ *       Оценка асимптотически точна, и отрезок получается лишь немного шире необходимого.
+ *       Для смеси берется объединение отрезков компонент.
+ */
+void plot_range_tail(const MixtureParams *params, int is_mixture, double tail_probability,
+                     double *x_min, double *x_max);
+
+/**
+ * @brief Строит сетку и значения плотности для графика.
+ * @param params Параметры распределения.
+ * @param is_mixture Флаг: 0 - основное распределение, 1 - смесь.
+ * @param options Настройки сетки (NULL - по умолчанию).
+ * @param xs Массив для узлов (options->points_count элементов), по возрастанию.
+ * @param ys Массив для значений плотности.
+ * @return Число точек или -1 при ошибке (points_count < 2, нет памяти).
+ * @note Адаптивная сетка: четверть бюджета - равномерно, остальные точки добавляются по одной
+ *       в середину отрезка с наибольшим отклонением плотности от прямой между его концами
+ *       (отрезки хранятся в куче по этому отклонению, середины считаются пачками).
+ *       Плотность вычисляется примерно в 2 * points_count точках; 1000-2000 адаптивных точек дают
+ *       ошибку линейной интерполяции того же порядка, что и 10000 равномерных.
+ */
+int build_plot_grid(const MixtureParams *params, int is_mixture, const PlotGridOptions *options,
+                    double *xs, double *ys);
+
 /**
  * @brief Генерирует данные для построения графиков распределений
  * @param test_case Номер теста (например, "3.1.1")
@@ -166,6 +932,14 @@ typedef struct {
 PlotData* generate_plot_data(const char* test_case, MixtureParams* params, int is_mixture, 
                             double* empirical_sample, int empirical_size);
 
+/**
+ * @brief То же, что generate_plot_data, но с настраиваемой сеткой кривой.
+ * @param options Настройки сетки (NULL - как в generate_plot_data).
+ */
+PlotData* generate_plot_data_grid(const char* test_case, MixtureParams* params, int is_mixture, 
+                                  double* empirical_sample, int empirical_size,
+                                  const PlotGridOptions *options);
+
 /**
  * @brief Сохраняет данные графика в файл
  * @param data Данные для сохранения
@@ -178,4 +952,15 @@ int save_plot_data(PlotData* data);
  */
 void free_plot_data(PlotData* data);
 
+/**
+ * @brief Включает или выключает сообщения о сохраненных файлах данных графиков.
+ * @note Сообщения пишутся в stderr и по умолчанию включены; относятся и к plot_io.h.
+ */
+void set_plot_messages(int enabled);
+
+/**
+ * @brief Возвращает 1, если сообщения о сохраненных файлах включены.
+ */
+int plot_messages_enabled(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+// Константы основного распределения для фиксированных v
+// (см. "СПЕЦИАЛИЗАЦИИ ДЛЯ ФИКСИРОВАННЫХ v" в distributions.c).
+// Файл создан gen_shapes.c (make shapes), вручную не редактируется.
+// X(имя, v, K_1(v), K_2(v), K_3(v), 1 / (2 sqrt(v) K_1(v)), сдвиг, u_min, u_max)
+
+#ifndef DISTRIBUTIONS_SHAPES_H
+#define DISTRIBUTIONS_SHAPES_H
+
+#define SH_FIXED_SHAPES(X) \
+    X(v0_5, 0x1p-1, 0x1.a80c867629ee1p+0, 0x1.e3363511d81b7p+2, 0x1.f0769945896aep+5, 0x1.b520da5e9cfacp-2, 0x0p+0, 0x0p+0, 0x1.dc42dccd9a655p+1) \
+    X(v1, 0x1p+0, 0x1.342d2f39d89c2p-1, 0x1.9ff5712ae8208p+0, 0x1.c67b171223341p+2, 0x1.a95090efe5be5p-1, 0x0p+0, 0x0p+0, 0x1.2441a83dc4337p+1) \
+    X(v2, 0x1p+1, 0x1.1e7200e1d3482p-3, 0x1.03d998db9bd97p-2, 0x1.4b76191410ab7p-1, 0x1.438f0c2a2c087p+1, 0x0p+0, 0x0p+0, 0x1.986fd998db4a2p+0)
+
+#endif
@@ -0,0 +1,293 @@
+#include "distributions.h"
+
+// --- ПАКЕТНОЕ ВЫЧИСЛЕНИЕ ПЛОТНОСТЕЙ (SIMD) ---
+// Плотность f(x) = norm * exp(-v * sqrt(1 + z^2 / v)), z = (x - mu) / lambda, считается сразу
+// для 8 (AVX-512) или 4 (AVX2) точек. Аргумент exp считается теми же операциями и в том же
+// порядке, что и в pdf_sh_dist, поэтому отличается только сама экспонента (см. vexp ниже).
+// Набор инструкций выбирается при выполнении по возможностям процессора.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SH_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+typedef enum {
+    KERNEL_PDF,      // out[i] = f(x[i])
+    KERNEL_LOGPDF,   // out[i] = log f(x[i])
+    KERNEL_PDF_ADD   // out[i] += weight * f(x[i])
+} KernelOp;
+
+// Скалярный вариант - он же обрабатывает хвост массива, не кратный ширине вектора
+static void sh_kernel_scalar(const SHDist *dist, const double *xs, double *out, int n, KernelOp op, double weight) {
+    for (int i = 0; i < n; i++) {
+        switch (op) {
+            case KERNEL_PDF:
+                out[i] = pdf_sh_dist(xs[i], dist);
+                break;
+            case KERNEL_LOGPDF:
+                out[i] = logpdf_sh_dist(xs[i], dist);
+                break;
+            case KERNEL_PDF_ADD:
+                out[i] += weight * pdf_sh_dist(xs[i], dist);
+                break;
+        }
+    }
+}
+
+#ifdef SH_X86_SIMD
+
+// Константы экспоненты: exp(x) = 2^n * exp(r), n = round(x / ln2), r = x - n * ln2, |r| <= ln2 / 2.
+// ln2 разбит на две части (как в fdlibm), чтобы n * LN2_HI считалось без округления.
+#define EXP_LOG2E  1.44269504088896338700e+00
+#define EXP_LN2_HI 6.93147180369123816490e-01
+#define EXP_LN2_LO 1.90821492927058770002e-10
+#define EXP_MIN   -745.2  // Ниже - ноль
+#define EXP_MAX    709.7  // Выше - переполнение (для плотности не встречается: аргумент <= -v)
+
+// Коэффициенты ряда Тейлора exp(r) = sum r^k / k!, k = 0..13 (остаток < 2^-57 при |r| <= ln2 / 2)
+static const double exp_coef[14] = {
+    1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+    1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800,
+    1.0 / 479001600, 1.0 / 6227020800.0
+};
+
+// 2^n собирается из двух половин n = n1 + n2, чтобы корректно получать и денормализованные числа
+
+__attribute__((target("avx2,fma")))
+static inline __m256d vexp_avx2(__m256d x) {
+    x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(EXP_MAX)), _mm256_set1_pd(EXP_MIN));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(EXP_LN2_HI), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(EXP_LN2_LO), r);
+
+    __m256d p = _mm256_set1_pd(exp_coef[13]);
+    for (int k = 12; k >= 0; k--) {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(exp_coef[k]));
+    }
+
+    __m128i ni = _mm256_cvtpd_epi32(n);
+    __m128i n1 = _mm_srai_epi32(ni, 1);
+    __m128i n2 = _mm_sub_epi32(ni, n1);
+    __m256i bias = _mm256_set1_epi64x(1023);
+    __m256d s1 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(n1), bias), 52));
+    __m256d s2 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(n2), bias), 52));
+    return _mm256_mul_pd(_mm256_mul_pd(p, s1), s2);
+}
+
+__attribute__((target("avx2,fma")))
+static void sh_kernel_avx2(const SHDist *dist, const double *xs, double *out, int n, KernelOp op, double weight) {
+    const __m256d mu = _mm256_set1_pd(dist->mu);
+    const __m256d inv_lambda = _mm256_set1_pd(dist->inv_lambda);
+    const __m256d inv_v = _mm256_set1_pd(dist->inv_v);
+    const __m256d neg_v = _mm256_set1_pd(-dist->v);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d norm = _mm256_set1_pd(dist->norm);
+    const __m256d log_norm = _mm256_set1_pd(dist->log_norm);
+    const __m256d w = _mm256_set1_pd(weight);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d z = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(xs + i), mu), inv_lambda);
+        __m256d q = _mm256_sqrt_pd(_mm256_add_pd(one, _mm256_mul_pd(_mm256_mul_pd(z, z), inv_v)));
+        __m256d e = _mm256_mul_pd(neg_v, q);
+        switch (op) {
+            case KERNEL_PDF:
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(norm, vexp_avx2(e)));
+                break;
+            case KERNEL_LOGPDF:
+                _mm256_storeu_pd(out + i, _mm256_sub_pd(log_norm, _mm256_mul_pd(_mm256_set1_pd(dist->v), q)));
+                break;
+            case KERNEL_PDF_ADD: {
+                __m256d f = _mm256_mul_pd(norm, vexp_avx2(e));
+                _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(out + i), _mm256_mul_pd(w, f)));
+                break;
+            }
+        }
+    }
+    sh_kernel_scalar(dist, xs + i, out + i, n - i, op, weight);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d vexp_avx512(__m512d x) {
+    x = _mm512_max_pd(_mm512_min_pd(x, _mm512_set1_pd(EXP_MAX)), _mm512_set1_pd(EXP_MIN));
+    __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(EXP_LN2_HI), x);
+    r = _mm512_fnmadd_pd(n, _mm512_set1_pd(EXP_LN2_LO), r);
+
+    __m512d p = _mm512_set1_pd(exp_coef[13]);
+    for (int k = 12; k >= 0; k--) {
+        p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(exp_coef[k]));
+    }
+
+    __m256i ni = _mm512_cvtpd_epi32(n);
+    __m256i n1 = _mm256_srai_epi32(ni, 1);
+    __m256i n2 = _mm256_sub_epi32(ni, n1);
+    __m512i bias = _mm512_set1_epi64(1023);
+    __m512d s1 = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(_mm512_cvtepi32_epi64(n1), bias), 52));
+    __m512d s2 = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(_mm512_cvtepi32_epi64(n2), bias), 52));
+    return _mm512_mul_pd(_mm512_mul_pd(p, s1), s2);
+}
+
+__attribute__((target("avx512f")))
+static void sh_kernel_avx512(const SHDist *dist, const double *xs, double *out, int n, KernelOp op, double weight) {
+    const __m512d mu = _mm512_set1_pd(dist->mu);
+    const __m512d inv_lambda = _mm512_set1_pd(dist->inv_lambda);
+    const __m512d inv_v = _mm512_set1_pd(dist->inv_v);
+    const __m512d neg_v = _mm512_set1_pd(-dist->v);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d norm = _mm512_set1_pd(dist->norm);
+    const __m512d log_norm = _mm512_set1_pd(dist->log_norm);
+    const __m512d w = _mm512_set1_pd(weight);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d z = _mm512_mul_pd(_mm512_sub_pd(_mm512_loadu_pd(xs + i), mu), inv_lambda);
+        __m512d q = _mm512_sqrt_pd(_mm512_add_pd(one, _mm512_mul_pd(_mm512_mul_pd(z, z), inv_v)));
+        __m512d e = _mm512_mul_pd(neg_v, q);
+        switch (op) {
+            case KERNEL_PDF:
+                _mm512_storeu_pd(out + i, _mm512_mul_pd(norm, vexp_avx512(e)));
+                break;
+            case KERNEL_LOGPDF:
+                _mm512_storeu_pd(out + i, _mm512_sub_pd(log_norm, _mm512_mul_pd(_mm512_set1_pd(dist->v), q)));
+                break;
+            case KERNEL_PDF_ADD: {
+                __m512d f = _mm512_mul_pd(norm, vexp_avx512(e));
+                _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(out + i), _mm512_mul_pd(w, f)));
+                break;
+            }
+        }
+    }
+    sh_kernel_scalar(dist, xs + i, out + i, n - i, op, weight);
+}
+
+#endif
+
+// Выбор ядра по возможностям процессора
+static void sh_kernel(const SHDist *dist, const double *xs, double *out, int n, KernelOp op, double weight) {
+    if (!dist->valid) {
+        // Некорректные параметры: та же семантика, что у скалярных функций
+        sh_kernel_scalar(dist, xs, out, n, op, weight);
+        return;
+    }
+#ifdef SH_X86_SIMD
+    if (__builtin_cpu_supports("avx512f")) {
+        sh_kernel_avx512(dist, xs, out, n, op, weight);
+        return;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        sh_kernel_avx2(dist, xs, out, n, op, weight);
+        return;
+    }
+#endif
+    sh_kernel_scalar(dist, xs, out, n, op, weight);
+}
+
+const char* simd_kernel_name(void) {
+#ifdef SH_X86_SIMD
+    if (__builtin_cpu_supports("avx512f")) return "avx512f";
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return "avx2";
+#endif
+    return "scalar";
+}
+
+void pdf_sh_dist_batch(const SHDist *dist, const double *xs, double *out, int n) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    sh_kernel(dist, xs, out, n, KERNEL_PDF, 1.0);
+}
+
+void logpdf_sh_dist_batch(const SHDist *dist, const double *xs, double *out, int n) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    sh_kernel(dist, xs, out, n, KERNEL_LOGPDF, 1.0);
+}
+
+void pdf_sh_dist_batch_add(const SHDist *dist, double weight, const double *xs, double *out, int n) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    sh_kernel(dist, xs, out, n, KERNEL_PDF_ADD, weight);
+}
+
+void pdf_main_batch(const double *xs, double *out, int n, double mu, double lambda, double v) {
+    SHDist dist;
+    prepare_sh_dist(&dist, mu, lambda, v);
+    pdf_sh_dist_batch(&dist, xs, out, n);
+}
+
+void logpdf_main_batch(const double *xs, double *out, int n, double mu, double lambda, double v) {
+    SHDist dist;
+    prepare_sh_dist(&dist, mu, lambda, v);
+    logpdf_sh_dist_batch(&dist, xs, out, n);
+}
+
+void pdf_mixture_batch(const double *xs, double *out, int n, MixtureParams *params) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    if (params == NULL || params->p < 0 || params->p > 1) {
+        memset(out, 0, n * sizeof(double));
+        return;
+    }
+
+    SHDist first, second;
+    prepare_sh_dist(&first, params->mu1, params->lambda1, params->v1);
+    prepare_sh_dist(&second, params->mu2, params->lambda2, params->v2);
+
+    // f_mix(x) = p * f1(x) + (1 - p) * f2(x), в том же порядке сложения, что и pdf_mixture
+    sh_kernel(&first, xs, out, n, KERNEL_PDF, 1.0);
+    for (int i = 0; i < n; i++) {
+        out[i] *= params->p;
+    }
+    sh_kernel(&second, xs, out, n, KERNEL_PDF_ADD, 1.0 - params->p);
+}
+
+void pdf_mixture_k_batch(const Mixture *mixture, const double *xs, double *out, int n) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    memset(out, 0, n * sizeof(double));
+    if (mixture == NULL) return;
+
+    for (int k = 0; k < mixture->count; k++) {
+        if (mixture->weight[k] > 0) {
+            sh_kernel(&mixture->components[k], xs, out, n, KERNEL_PDF_ADD, mixture->weight[k]);
+        }
+    }
+}
+
+#define MIXTURE_CHUNK 512
+
+void logpdf_mixture_k_batch(const Mixture *mixture, const double *xs, double *out, int n) {
+    if (xs == NULL || out == NULL || n <= 0) return;
+    if (mixture == NULL) {
+        for (int i = 0; i < n; i++) {
+            out[i] = -INFINITY;
+        }
+        return;
+    }
+
+    double term[MIXTURE_CHUNK];
+    double max[MIXTURE_CHUNK];
+    double sum[MIXTURE_CHUNK];
+    for (int start = 0; start < n; start += MIXTURE_CHUNK) {
+        int count = (n - start < MIXTURE_CHUNK) ? n - start : MIXTURE_CHUNK;
+        for (int i = 0; i < count; i++) {
+            max[i] = -INFINITY;
+            sum[i] = 0.0;
+        }
+
+        // Потоковый log-sum-exp: при новом максимуме накопленная сумма пересчитывается к нему
+        for (int k = 0; k < mixture->count; k++) {
+            if (!(mixture->weight[k] > 0) || !mixture->components[k].valid) continue;
+            double log_weight = log(mixture->weight[k]);
+            sh_kernel(&mixture->components[k], xs + start, term, count, KERNEL_LOGPDF, 1.0);
+            for (int i = 0; i < count; i++) {
+                double t = term[i] + log_weight;
+                if (t > max[i]) {
+                    sum[i] = sum[i] * exp(max[i] - t) + 1.0;
+                    max[i] = t;
+                } else if (t > -INFINITY) {
+                    sum[i] += exp(t - max[i]);
+                }
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            out[start + i] = max[i] + log(sum[i]);
+        }
+    }
+}
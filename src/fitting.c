@@ -0,0 +1,553 @@
+#include "fitting.h"
+
+#include <string.h>
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+#define EM_CHUNK 65536   // Кусок выборки с собственными частичными суммами
+#define EM_BLOCK 256     // Точек за один проход по компонентам
+#define EM_SUMS 5        // Частичных сумм на компоненту (см. EStepJob)
+
+void default_em_options(EMOptions *options) {
+    options->max_iterations = 500;
+    options->tolerance = 1e-9;
+    options->fit_shape = 1;
+    options->v_min = 0.01;
+    options->v_max = 500.0;
+    options->accelerate = 1;
+    options->keep_trace = 0;
+    options->pool = NULL;
+}
+
+void free_em_result(EMResult *result) {
+    if (result) {
+        free(result->trace);
+        result->trace = NULL;
+    }
+}
+
+// Решает f(v) = target делением отрезка [v_min, v_max] пополам по log v (f убывает по v)
+static double solve_decreasing(double (*f)(double), double target, double v_min, double v_max) {
+    if (target >= f(v_min)) return v_min;
+    if (target <= f(v_max)) return v_max;
+    double lo = log(v_min), hi = log(v_max);
+    for (int i = 0; i < 50; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (f(exp(mid)) > target) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return exp(0.5 * (lo + hi));
+}
+
+// Оптимальный масштаб c смешивающей величины при заданной форме omega (см. update_shape)
+static double mixing_scale(double omega, double tau, double tau_u, double tau_e) {
+    double b = tau / (omega * tau_u);
+    return sqrt(b * b + tau_e / tau_u) - b;
+}
+
+// Производная профильной функции Q по omega (убывает по omega)
+static double shape_score(double omega, double tau, double tau_u, double tau_e) {
+    double c = mixing_scale(omega, tau, tau_u, tau_e);
+    return tau * (bessel_k_fast(0.0, omega) / bessel_k_fast(1.0, omega) + 1.0 / omega) - 0.5 * (c * tau_u + tau_e / c);
+}
+
+// M-шаг для формы с расширением параметров: W ~ GIG(1, omega * c, omega / c) вместо GIG(1, v, v).
+// Лишний масштаб c не меняет модель (c переносится в lambda), но убирает медленную сходимость
+// обычного EM вдоль направления "lambda растет - v растет". По c максимум находится явно,
+// по omega - делением отрезка пополам. Возвращает новое v, в *c - поправочный множитель
+// для lambda^2. fit_shape = 0 оставляет v, подбирая только c.
+static double update_shape(double v, int fit_shape, double v_min, double v_max,
+                           double tau, double tau_u, double tau_e, double *c) {
+    double omega = v;
+    if (fit_shape) {
+        double lo = log(v_min), hi = log(v_max);
+        if (shape_score(v_min, tau, tau_u, tau_e) <= 0) {
+            omega = v_min;
+        } else if (shape_score(v_max, tau, tau_u, tau_e) >= 0) {
+            omega = v_max;
+        } else {
+            for (int i = 0; i < 50; i++) {
+                double mid = 0.5 * (lo + hi);
+                if (shape_score(exp(mid), tau, tau_u, tau_e) > 0) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            omega = exp(0.5 * (lo + hi));
+        }
+    }
+    *c = mixing_scale(omega, tau, tau_u, tau_e);
+    return omega;
+}
+
+// Эксцесс основного распределения (убывает от 3 до 0)
+static double shape_kurtosis(double v) {
+    double k1_over_k2, k3_over_k2;
+    bessel_k_ratios(v, &k1_over_k2, &k3_over_k2);
+    return 3.0 * k3_over_k2 * k1_over_k2 - 3.0;
+}
+
+// Записывает новые параметры в смесь и заново готовит компоненты и alias-таблицу
+static int set_mixture_parameters(Mixture *mixture, const double *weight, const double *mu,
+                                  const double *lambda, const double *v) {
+    AliasTable *alias = build_alias_table(weight, mixture->count);
+    if (!alias) return -1;
+    free_alias_table(mixture->alias);
+    mixture->alias = alias;
+
+    double total = 0.0;
+    for (int k = 0; k < mixture->count; k++) {
+        total += weight[k];
+    }
+    for (int k = 0; k < mixture->count; k++) {
+        mixture->weight[k] = weight[k] / total;
+        mixture->mu[k] = mu[k];
+        mixture->lambda[k] = lambda[k];
+        mixture->v[k] = v[k];
+        prepare_sh_dist(&mixture->components[k], mu[k], lambda[k], v[k]);
+    }
+    return 0;
+}
+
+// --- E-ШАГ ---
+
+// Для каждого куска и каждой компоненты k хранятся суммы по точкам куска:
+//   [0] tau, [1] tau * u, [2] tau * u * d, [3] tau * u * d^2, [4] tau * e,
+// где tau - апостериорная вероятность компоненты, u = E[1/W|x], e = E[W|x], d = x - mu.
+// Последний элемент строки куска - логарифм правдоподобия куска.
+typedef struct {
+    const double *sample;
+    int sample_size;
+    const Mixture *mixture;
+    int chunks;
+    int stride;          // EM_SUMS * count + 1
+    double *partial;     // chunks * stride
+    int failed;
+} EStepJob;
+
+static void e_step_chunk(const EStepJob *job, int chunk, double *scratch) {
+    const Mixture *mixture = job->mixture;
+    int count = mixture->count;
+    double *sums = job->partial + (long long)chunk * job->stride;
+    memset(sums, 0, job->stride * sizeof(double));
+
+    double *omega = scratch;                     // count * EM_BLOCK
+    double *term = scratch + count * EM_BLOCK;   // count * EM_BLOCK
+    double max[EM_BLOCK];
+    double total[EM_BLOCK];
+
+    long long chunk_begin = (long long)chunk * EM_CHUNK;
+    long long chunk_end = chunk_begin + EM_CHUNK;
+    if (chunk_end > job->sample_size) chunk_end = job->sample_size;
+
+    for (long long start = chunk_begin; start < chunk_end; start += EM_BLOCK) {
+        const double *x = job->sample + start;
+        int n = (chunk_end - start < EM_BLOCK) ? (int)(chunk_end - start) : EM_BLOCK;
+
+        // log(w_k * f_k(x)) = log w_k + log_norm_k - omega_k(x)
+        for (int i = 0; i < n; i++) {
+            max[i] = -INFINITY;
+        }
+        for (int k = 0; k < count; k++) {
+            const SHDist *dist = &mixture->components[k];
+            double *om = omega + k * EM_BLOCK;
+            double *t = term + k * EM_BLOCK;
+            if (!(mixture->weight[k] > 0) || !dist->valid) {
+                for (int i = 0; i < n; i++) {
+                    om[i] = 1.0;
+                    t[i] = -INFINITY;
+                }
+                continue;
+            }
+            double shift = log(mixture->weight[k]) + dist->log_norm;
+            double v = dist->v;
+            for (int i = 0; i < n; i++) {
+                double z = (x[i] - dist->mu) * dist->inv_lambda;
+                om[i] = sqrt(v * (v + z * z));
+                t[i] = shift - om[i];
+                if (t[i] > max[i]) max[i] = t[i];
+            }
+        }
+
+        // Апостериорные вероятности через log-sum-exp
+        for (int i = 0; i < n; i++) {
+            total[i] = 0.0;
+        }
+        for (int k = 0; k < count; k++) {
+            double *t = term + k * EM_BLOCK;
+            for (int i = 0; i < n; i++) {
+                t[i] = exp(t[i] - max[i]);
+                total[i] += t[i];
+            }
+        }
+        double loglik = 0.0;
+        for (int i = 0; i < n; i++) {
+            loglik += max[i] + log(total[i]);
+            total[i] = 1.0 / total[i];
+        }
+        sums[job->stride - 1] += loglik;
+
+        for (int k = 0; k < count; k++) {
+            const SHDist *dist = &mixture->components[k];
+            if (!(mixture->weight[k] > 0) || !dist->valid) continue;
+            const double *om = omega + k * EM_BLOCK;
+            const double *t = term + k * EM_BLOCK;
+            double v = dist->v;
+            double inv_v = dist->inv_v;
+            double s_tau = 0, s_u = 0, s_ud = 0, s_ud2 = 0, s_e = 0;
+            for (int i = 0; i < n; i++) {
+                double tau = t[i] * total[i];
+                double u = v / om[i];
+                double e = (om[i] + 1.0) * inv_v;
+                double d = x[i] - dist->mu;
+                double tu = tau * u;
+                s_tau += tau;
+                s_u += tu;
+                s_ud += tu * d;
+                s_ud2 += tu * d * d;
+                s_e += tau * e;
+            }
+            double *s = sums + EM_SUMS * k;
+            s[0] += s_tau;
+            s[1] += s_u;
+            s[2] += s_ud;
+            s[3] += s_ud2;
+            s[4] += s_e;
+        }
+    }
+}
+
+static void e_step_task(void *ctx, int worker, int workers) {
+    EStepJob *job = (EStepJob*)ctx;
+
+    // Куски этого потока; суммы куска c пишутся в свою строку partial
+    int begin = (int)((long long)job->chunks * worker / workers);
+    int end = (int)((long long)job->chunks * (worker + 1) / workers);
+    if (end <= begin) return;
+
+    double *scratch = (double*)malloc(2 * job->mixture->count * EM_BLOCK * sizeof(double));
+    if (!scratch) {
+        job->failed = 1;
+        return;
+    }
+    for (int c = begin; c < end; c++) {
+        e_step_chunk(job, c, scratch);
+    }
+    free(scratch);
+}
+
+// Выполняет E-шаг; totals (EM_SUMS * count + 1 элементов) - суммы по всей выборке
+static int run_e_step(const Mixture *mixture, const double *sample, int sample_size,
+                      ThreadPool *pool, double *totals) {
+    EStepJob job;
+    job.sample = sample;
+    job.sample_size = sample_size;
+    job.mixture = mixture;
+    job.chunks = (sample_size + EM_CHUNK - 1) / EM_CHUNK;
+    job.stride = EM_SUMS * mixture->count + 1;
+    job.failed = 0;
+    job.partial = (double*)malloc((long long)job.chunks * job.stride * sizeof(double));
+    if (!job.partial) return -1;
+
+    thread_pool_run(pool, e_step_task, &job);
+
+    // Строки partial складываются по номерам кусков, а не по потокам
+    memset(totals, 0, job.stride * sizeof(double));
+    for (int c = 0; c < job.chunks; c++) {
+        const double *sums = job.partial + (long long)c * job.stride;
+        for (int j = 0; j < job.stride; j++) {
+            totals[j] += sums[j];
+        }
+    }
+    free(job.partial);
+    return job.failed ? -1 : 0;
+}
+
+double mixture_loglik(const Mixture *mixture, const double *sample, int sample_size, ThreadPool *pool) {
+    if (mixture == NULL || sample == NULL || sample_size <= 0) {
+        return 0.0;
+    }
+    double *totals = (double*)malloc((EM_SUMS * mixture->count + 1) * sizeof(double));
+    if (!totals) return 0.0;
+    double loglik = 0.0;
+    if (run_e_step(mixture, sample, sample_size, pool, totals) == 0) {
+        loglik = totals[EM_SUMS * mixture->count];
+    }
+    free(totals);
+    return loglik;
+}
+
+// --- НАЧАЛЬНОЕ ПРИБЛИЖЕНИЕ ---
+
+#define GUESS_SUBSAMPLE 100000
+
+Mixture* initial_mixture_guess(const double *sample, int sample_size, int count) {
+    if (sample == NULL || sample_size < 2 || count <= 0) {
+        return NULL;
+    }
+
+    double *weight = (double*)malloc(count * sizeof(double));
+    double *mu = (double*)malloc(count * sizeof(double));
+    double *lambda = (double*)malloc(count * sizeof(double));
+    double *v = (double*)malloc(count * sizeof(double));
+    int sub_size = (sample_size < GUESS_SUBSAMPLE) ? sample_size : GUESS_SUBSAMPLE;
+    double *sub = (double*)malloc(sub_size * sizeof(double));
+    Mixture *mixture = NULL;
+    if (!weight || !mu || !lambda || !v || !sub) goto cleanup;
+
+    // Равномерная по индексу подвыборка (детерминированная)
+    for (int i = 0; i < sub_size; i++) {
+        sub[i] = sample[(long long)i * sample_size / sub_size];
+    }
+
+    double mean, variance, skewness, kurtosis;
+    moments_empirical(sub, sub_size, &mean, &variance, &skewness, &kurtosis);
+    if (!(variance > 0)) goto cleanup;
+
+    if (count == 1) {
+        // Форма по эксцессу, масштаб по дисперсии: Var = lambda^2 * K_2(v) / K_1(v)
+        v[0] = solve_decreasing(shape_kurtosis, kurtosis, 0.01, 500.0);
+        weight[0] = 1.0;
+        mu[0] = mean;
+        double k1_over_k2;
+        bessel_k_ratios(v[0], &k1_over_k2, NULL);
+        lambda[0] = sqrt(variance * k1_over_k2);
+    } else {
+        // Равные по числу точек части упорядоченной подвыборки, форма v = 1
+        qsort(sub, sub_size, sizeof(double), compare_doubles);
+        double k1_over_k2;
+        bessel_k_ratios(1.0, &k1_over_k2, NULL);
+        double scale = sqrt(k1_over_k2);
+        double min_sd = sqrt(variance) / count;
+        for (int k = 0; k < count; k++) {
+            int begin = (int)((long long)sub_size * k / count);
+            int end = (int)((long long)sub_size * (k + 1) / count);
+            double part_mean = 0.0, part_var = 0.0, unused_s, unused_k;
+            if (end - begin >= 2) {
+                moments_empirical(sub + begin, end - begin, &part_mean, &part_var, &unused_s, &unused_k);
+            } else {
+                part_mean = sub[begin < sub_size ? begin : sub_size - 1];
+            }
+            double sd = sqrt(part_var);
+            weight[k] = 1.0;
+            mu[k] = part_mean;
+            lambda[k] = ((sd > min_sd) ? sd : min_sd) * scale;
+            v[k] = 1.0;
+        }
+    }
+
+    mixture = create_mixture(count, weight, mu, lambda, v);
+
+cleanup:
+    free(weight);
+    free(mu);
+    free(lambda);
+    free(v);
+    free(sub);
+    return mixture;
+}
+
+// --- EM-АЛГОРИТМ ---
+
+// Параметры смеси в виде вектора без ограничений: для компоненты k
+//   theta[4k] = log w, theta[4k + 1] = mu, theta[4k + 2] = log lambda, theta[4k + 3] = log v.
+// В этих координатах работает ускорение SQUAREM (экстраполяция не выводит за допустимую область).
+#define EM_PARAMS 4
+#define EM_MIN_WEIGHT 1e-300
+
+static void get_theta(const Mixture *mixture, double *theta) {
+    for (int k = 0; k < mixture->count; k++) {
+        double w = mixture->weight[k];
+        theta[EM_PARAMS * k] = log(w > EM_MIN_WEIGHT ? w : EM_MIN_WEIGHT);
+        theta[EM_PARAMS * k + 1] = mixture->mu[k];
+        theta[EM_PARAMS * k + 2] = log(mixture->lambda[k]);
+        theta[EM_PARAMS * k + 3] = log(mixture->v[k]);
+    }
+}
+
+static int set_theta(Mixture *mixture, const double *theta, const EMOptions *options, double *scratch) {
+    int count = mixture->count;
+    double *weight = scratch;
+    double *mu = scratch + count;
+    double *lambda = scratch + 2 * count;
+    double *v = scratch + 3 * count;
+
+    // Веса нормируются относительно наибольшего, чтобы exp не переполнился после экстраполяции
+    double max = -INFINITY;
+    for (int k = 0; k < count; k++) {
+        if (theta[EM_PARAMS * k] > max) max = theta[EM_PARAMS * k];
+    }
+    for (int k = 0; k < count; k++) {
+        weight[k] = exp(theta[EM_PARAMS * k] - max);
+        mu[k] = theta[EM_PARAMS * k + 1];
+        lambda[k] = exp(theta[EM_PARAMS * k + 2]);
+        v[k] = exp(theta[EM_PARAMS * k + 3]);
+        if (v[k] < options->v_min) v[k] = options->v_min;
+        if (v[k] > options->v_max) v[k] = options->v_max;
+        if (!isfinite(mu[k]) || !(lambda[k] > 0) || !isfinite(lambda[k])) return -1;
+    }
+    return set_mixture_parameters(mixture, weight, mu, lambda, v);
+}
+
+// Один E-шаг при текущих параметрах смеси: правдоподобие и параметры после M-шага (в next)
+static int em_evaluate(const Mixture *mixture, const double *sample, int sample_size,
+                       const EMOptions *options, double *totals, double *next, double *loglik) {
+    if (run_e_step(mixture, sample, sample_size, options->pool, totals) != 0) {
+        return -1;
+    }
+    *loglik = totals[EM_SUMS * mixture->count];
+
+    for (int k = 0; k < mixture->count; k++) {
+        const double *s = totals + EM_SUMS * k;
+        double w = s[0] / sample_size;
+        double mu = mixture->mu[k];
+        double lambda = mixture->lambda[k];
+        double v = mixture->v[k];
+
+        // Компонента без точек сохраняет параметры и остается с нулевым весом
+        if (s[0] > 0 && s[1] > 0) {
+            double shift = s[2] / s[1];
+            double lambda2 = (s[3] - s[2] * shift) / s[0];
+            double c;
+            mu += shift;
+            v = update_shape(v, options->fit_shape, options->v_min, options->v_max, s[0], s[1], s[4], &c);
+            if (lambda2 > 0) lambda = sqrt(lambda2 * c);
+        }
+
+        next[EM_PARAMS * k] = log(w > EM_MIN_WEIGHT ? w : EM_MIN_WEIGHT);
+        next[EM_PARAMS * k + 1] = mu;
+        next[EM_PARAMS * k + 2] = log(lambda);
+        next[EM_PARAMS * k + 3] = log(v);
+    }
+    return 0;
+}
+
+int refine_mixture_em(Mixture *mixture, const double *sample, int sample_size,
+                      const EMOptions *options, EMResult *result) {
+    EMOptions defaults;
+    if (options == NULL) {
+        default_em_options(&defaults);
+        options = &defaults;
+    }
+    if (result) {
+        memset(result, 0, sizeof(EMResult));
+    }
+    if (mixture == NULL || sample == NULL || sample_size <= 0 || options->max_iterations < 0) {
+        return -1;
+    }
+
+    int count = mixture->count;
+    int size = EM_PARAMS * count;
+    double *totals = (double*)malloc((EM_SUMS * count + 1) * sizeof(double));
+    // theta0, theta1 = F(theta0), theta2 = F(theta1), экстраполяция, F(экстраполяции), рабочий массив
+    double *work = (double*)malloc(6 * size * sizeof(double));
+    double *trace = NULL;
+    if (options->keep_trace && result) {
+        trace = (double*)malloc((options->max_iterations + 1) * sizeof(double));
+    }
+    if (!totals || !work || (options->keep_trace && result && !trace)) {
+        free(totals);
+        free(work);
+        free(trace);
+        return -1;
+    }
+    double *theta0 = work;
+    double *theta1 = work + size;
+    double *theta2 = work + 2 * size;
+    double *jump = work + 3 * size;
+    double *jump_next = work + 4 * size;
+    double *scratch = work + 5 * size;
+
+    int e_steps = 1;
+    int iteration = 0;
+    int converged = 0;
+    double loglik = -INFINITY;
+    // Инвариант цикла: смесь содержит текущие параметры, loglik - их правдоподобие, theta1 - шаг EM от них
+    int status = em_evaluate(mixture, sample, sample_size, options, totals, theta1, &loglik);
+    if (trace && status == 0) trace[0] = loglik;
+
+    while (status == 0 && iteration < options->max_iterations) {
+        double previous = loglik;
+        get_theta(mixture, theta0);
+
+        // Обычный шаг EM
+        if (set_theta(mixture, theta1, options, scratch) != 0 ||
+            em_evaluate(mixture, sample, sample_size, options, totals, theta2, &loglik) != 0) {
+            status = -1;
+            break;
+        }
+        e_steps++;
+
+        if (options->accelerate) {
+            // SQUAREM: r = theta1 - theta0, q = theta2 - 2 theta1 + theta0,
+            // jump = theta0 - 2 alpha r + alpha^2 q, alpha = -|r| / |q| (не больше -1)
+            double r2 = 0.0, q2 = 0.0;
+            for (int j = 0; j < size; j++) {
+                double r = theta1[j] - theta0[j];
+                double q = theta2[j] - 2 * theta1[j] + theta0[j];
+                r2 += r * r;
+                q2 += q * q;
+            }
+            double alpha = (q2 > 0) ? -sqrt(r2 / q2) : -1.0;
+            if (alpha < -1.0) {
+                for (int j = 0; j < size; j++) {
+                    double r = theta1[j] - theta0[j];
+                    double q = theta2[j] - 2 * theta1[j] + theta0[j];
+                    jump[j] = theta0[j] - 2 * alpha * r + alpha * alpha * q;
+                }
+                double jump_loglik;
+                int ok = set_theta(mixture, jump, options, scratch) == 0 &&
+                         em_evaluate(mixture, sample, sample_size, options, totals, jump_next, &jump_loglik) == 0;
+                e_steps++;
+                if (ok && jump_loglik >= loglik) {
+                    // Экстраполяция не хуже обычного шага - принимаем ее
+                    loglik = jump_loglik;
+                    memcpy(theta2, jump_next, size * sizeof(double));
+                } else if (set_theta(mixture, theta1, options, scratch) != 0) {
+                    status = -1;
+                    break;
+                }
+            }
+        }
+        memcpy(theta1, theta2, size * sizeof(double));
+
+        iteration++;
+        if (trace) trace[iteration] = loglik;
+        if ((loglik - previous) / sample_size < options->tolerance) {
+            converged = 1;
+            break;
+        }
+    }
+
+    if (result) {
+        result->iterations = iteration;
+        result->e_steps = e_steps;
+        result->converged = converged;
+        result->loglik = loglik;
+        result->trace = trace;
+    } else {
+        free(trace);
+    }
+    free(totals);
+    free(work);
+    return status;
+}
+
+Mixture* fit_mixture_em(const double *sample, int sample_size, int count,
+                        const EMOptions *options, EMResult *result) {
+    Mixture *mixture = initial_mixture_guess(sample, sample_size, count);
+    if (!mixture) {
+        if (result) memset(result, 0, sizeof(EMResult));
+        return NULL;
+    }
+    if (refine_mixture_em(mixture, sample, sample_size, options, result) != 0) {
+        free_em_result(result);
+        free_mixture(mixture);
+        return NULL;
+    }
+    return mixture;
+}
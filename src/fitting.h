@@ -0,0 +1,92 @@
+#ifndef FITTING_H
+#define FITTING_H
+
+#include "distributions.h"
+#include "parallel.h"
+
+// --- ПОДГОНКА СМЕСИ ПО ВЫБОРКЕ (EM-АЛГОРИТМ) ---
+// Каждая компонента - нормальная смесь X = mu + lambda * sqrt(W) * Z, W ~ GIG(1, v, v).
+// При известном x смешивающая величина W имеет распределение GIG(1/2, v + z^2, v), z = (x - mu) / lambda,
+// поэтому на E-шаге нужные условные средние выражаются без функций Бесселя:
+//   E[1/W | x] = v / omega,  E[W | x] = (omega + 1) / v,  omega = sqrt(v * (v + z^2)).
+// M-шаг для mu, lambda и весов - явные формулы, для v - одномерное уравнение с K_0(v) / K_1(v),
+// которое решается делением отрезка пополам по log v. Масштаб W подбирается вместе с v
+// (расширение параметров, PX-EM) и переносится в lambda; шаги EM ускоряются экстраполяцией SQUAREM.
+// E-шаг выполняется параллельно по кускам выборки фиксированного размера (см. parallel.h):
+// взвешенные суммы для M-шага накапливаются отдельно по каждому куску.
+
+/**
+ * @brief Настройки EM-алгоритма.
+ */
+typedef struct {
+    int max_iterations;   // Наибольшее число итераций
+    double tolerance;     // Остановка, когда прирост логарифма правдоподобия на точку меньше tolerance
+    int fit_shape;        // 1 - подбирать параметры формы v, 0 - оставить начальные
+    double v_min, v_max;  // Допустимый диапазон параметров формы
+    int accelerate;       // 1 - ускорение SQUAREM (экстраполяция по двум шагам EM с проверкой правдоподобия)
+    int keep_trace;       // 1 - сохранять логарифм правдоподобия на каждой итерации
+    ThreadPool *pool;     // Пул потоков для E-шага (NULL - один поток)
+} EMOptions;
+
+/**
+ * @brief Результат и диагностика EM-алгоритма.
+ */
+typedef struct {
+    int iterations;       // Выполнено итераций (обновлений параметров)
+    int e_steps;          // Выполнено E-шагов - проходов по выборке (с ускорением до двух на итерацию)
+    int converged;        // 1 - достигнута точность tolerance
+    double loglik;        // Логарифм правдоподобия при итоговых параметрах
+    double *trace;        // Логарифм правдоподобия начального приближения и после каждой итерации
+                          // (iterations + 1 элементов) или NULL
+} EMResult;
+
+/**
+ * @brief Заполняет настройки значениями по умолчанию.
+ * @note 500 итераций, tolerance = 1e-9, подбор формы в диапазоне [0.01, 500], с ускорением,
+ *       без журнала, один поток.
+ */
+void default_em_options(EMOptions *options);
+
+/**
+ * @brief Строит начальное приближение для смеси из count компонент.
+ * @param sample Выборка.
+ * @param sample_size Размер выборки.
+ * @param count Число компонент.
+ * @return Указатель на смесь или NULL при ошибке.
+ * @note Одна компонента подбирается по моментам (дисперсия и эксцесс).
+ *       Для нескольких компонент упорядоченная подвыборка делится на count равных частей,
+ *       каждая часть дает сдвиг и масштаб своей компоненты.
+ */
+Mixture* initial_mixture_guess(const double *sample, int sample_size, int count);
+
+/**
+ * @brief Уточняет параметры смеси EM-алгоритмом (теплый старт с текущих параметров).
+ * @param mixture Смесь - начальное приближение, на выходе - результат подгонки.
+ * @param sample Выборка.
+ * @param sample_size Размер выборки.
+ * @param options Настройки (NULL - по умолчанию).
+ * @param result Диагностика (может быть NULL). Журнал освобождается через free_em_result.
+ * @return 0 при успехе, -1 при ошибке (нет памяти, пустая выборка, некорректная смесь).
+ */
+int refine_mixture_em(Mixture *mixture, const double *sample, int sample_size,
+                      const EMOptions *options, EMResult *result);
+
+/**
+ * @brief Подгоняет смесь из count компонент: начальное приближение и EM-алгоритм.
+ * @return Указатель на смесь или NULL при ошибке. Освобождается через free_mixture.
+ */
+Mixture* fit_mixture_em(const double *sample, int sample_size, int count,
+                        const EMOptions *options, EMResult *result);
+
+/**
+ * @brief Логарифм правдоподобия смеси на выборке.
+ * @param pool Пул потоков (NULL - один поток).
+ */
+double mixture_loglik(const Mixture *mixture, const double *sample, int sample_size, ThreadPool *pool);
+
+/**
+ * @brief Освобождает журнал итераций.
+ */
+void free_em_result(EMResult *result);
+
+#endif
@@ -0,0 +1,67 @@
+// Генератор distributions_shapes.h (make shapes).
+//
+// Для каждого v из списка SHAPES считает функции Бесселя K_1, K_2, K_3, нормировку
+// плотности 1 / (2 sqrt(v) K_1(v)) и границы отбора GIG (prepare_gig_sampler) и пишет их
+// в stdout как шестнадцатеричные константы (без потерь при округлении в десятичную запись).
+// Функции Бесселя считаются здесь же в long double, а не через GSL, чтобы константы были
+// округлены правильно и не зависели от версии библиотеки. Границы отбора совпадают
+// с вычисленными во время выполнения до последнего бита.
+// После изменения списка или формул заголовок нужно пересоздать:
+//
+//   make shapes
+
+#include "distributions.h"
+
+// Значения v, для которых собираются специализированные ядра
+static const double SHAPES[] = {0.5, 1.0, 2.0};
+
+// K_nu(x) = int_0^inf exp(-x cosh t) cosh(nu t) dt, формула трапеций.
+// Подынтегральная функция четная и аналитическая в полосе |Im t| < pi / 2, поэтому ошибка
+// убывает как exp(-pi^2 / h): при h = 1/64 она ниже точности long double
+static long double bessel_k_precise(double nu, double x) {
+    const long double h = 1.0L / 64;
+    long double sum = 0.5L * expl(-(long double)x);
+    for (int i = 1; ; i++) {
+        long double t = i * h;
+        long double term = expl(-x * coshl(t)) * coshl(nu * t);
+        sum += term;
+        if (term < sum * 1e-22L) break;
+    }
+    return sum * h;
+}
+
+// Имя ядра по значению v: 0.5 -> v0_5
+static void shape_name(double v, char *name, size_t size) {
+    snprintf(name, size, "v%g", v);
+    for (char *c = name; *c; c++) {
+        if (*c == '.' || *c == '-' || *c == '+') *c = '_';
+    }
+}
+
+int main(void) {
+    int count = sizeof(SHAPES) / sizeof(SHAPES[0]);
+
+    printf("// Константы основного распределения для фиксированных v\n");
+    printf("// (см. \"СПЕЦИАЛИЗАЦИИ ДЛЯ ФИКСИРОВАННЫХ v\" в distributions.c).\n");
+    printf("// Файл создан gen_shapes.c (make shapes), вручную не редактируется.\n");
+    printf("// X(имя, v, K_1(v), K_2(v), K_3(v), 1 / (2 sqrt(v) K_1(v)), сдвиг, u_min, u_max)\n\n");
+    printf("#ifndef DISTRIBUTIONS_SHAPES_H\n");
+    printf("#define DISTRIBUTIONS_SHAPES_H\n\n");
+    printf("#define SH_FIXED_SHAPES(X) \\\n");
+    for (int i = 0; i < count; i++) {
+        double v = SHAPES[i];
+        long double k1 = bessel_k_precise(1.0, v);
+        long double k2 = bessel_k_precise(2.0, v);
+        long double k3 = bessel_k_precise(3.0, v);
+        long double norm = 1 / (2 * sqrtl(v) * k1);
+        GIGSampler gig;
+        prepare_gig_sampler(&gig, v);
+
+        char name[32];
+        shape_name(v, name, sizeof(name));
+        printf("    X(%s, %a, %a, %a, %a, %a, %a, %a, %a)%s\n", name, v,
+               (double)k1, (double)k2, (double)k3, (double)norm, gig.shift, gig.u_min, gig.u_max, (i + 1 < count) ? " \\" : "");
+    }
+    printf("\n#endif\n");
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "gof.h"
+
+#include <float.h>
+#include <gsl/gsl_sf_gamma.h>
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+#define GOF_CHUNK 65536          // Кусок выборки с собственными частичными суммами
+#define GOF_TABLE_TOLERANCE 1e-12
+
+typedef struct {
+    const double *sorted;
+    int n;
+    const InversionTable *table;
+    int bins;
+    int chunks;
+    double *u;                   // Буфер F(x) на кусок: GOF_CHUNK значений на поток
+    double *d_plus;              // По кускам: max(i/n - u_i)
+    double *d_minus;             //            max(u_i - (i-1)/n)
+    double *ad_sums;             //            сумма слагаемых A^2, деленных на n
+    long long *counts;           // По потокам: bins счетчиков интервалов
+} GofJob;
+
+static void gof_task(void *ctx, int worker, int workers) {
+    GofJob *job = (GofJob*)ctx;
+    double *u = job->u + (size_t)worker * GOF_CHUNK;
+    long long *counts = job->counts + (size_t)worker * job->bins;
+    double n = job->n;
+
+    // Куски этого потока: D и сумма A^2 куска c - в ячейках c, u и counts - свои у потока
+    int begin = (int)((long long)job->chunks * worker / workers);
+    int end = (int)((long long)job->chunks * (worker + 1) / workers);
+    for (int c = begin; c < end; c++) {
+        int offset = c * GOF_CHUNK;
+        int count = (job->n - offset < GOF_CHUNK) ? job->n - offset : GOF_CHUNK;
+        cdf_inversion_table_n(job->table, job->sorted + offset, u, count);
+
+        double d_plus = 0.0, d_minus = 0.0, ad = 0.0;
+        for (int k = 0; k < count; k++) {
+            double i = offset + k + 1.0;     // Номер порядковой статистики, с 1
+            // log(0) в дальних хвостах, где F округляется до 0 или 1
+            double ui = u[k];
+            if (ui < DBL_MIN) ui = DBL_MIN;
+            if (ui > 1.0 - DBL_EPSILON / 2) ui = 1.0 - DBL_EPSILON / 2;
+
+            if (i / n - ui > d_plus) d_plus = i / n - ui;
+            if (ui - (i - 1) / n > d_minus) d_minus = ui - (i - 1) / n;
+            ad += ((2 * i - 1) * log(ui) + (2 * (n - i) + 1) * log1p(-ui)) / n;
+
+            int bin = (int)(ui * job->bins);
+            counts[(bin < job->bins) ? bin : job->bins - 1]++;
+        }
+        job->d_plus[c] = d_plus;
+        job->d_minus[c] = d_minus;
+        job->ad_sums[c] = ad;
+    }
+}
+
+// --- P-ЗНАЧЕНИЯ ---
+
+double ks_p_value(double statistic, int n) {
+    if (n <= 0 || !(statistic > 0)) return 1.0;
+    double root = sqrt((double)n);
+    double lambda = (root + 0.12 + 0.11 / root) * statistic;
+    if (lambda < 0.2) return 1.0;   // Ряд сходится медленно, а значение уже неотличимо от 1
+
+    // Q(lambda) = 2 * sum (-1)^(k-1) exp(-2 k^2 lambda^2)
+    double sum = 0.0, sign = 1.0;
+    for (int k = 1; k <= 100; k++) {
+        double term = exp(-2.0 * k * k * lambda * lambda);
+        sum += sign * term;
+        if (term < 1e-16 * sum) break;
+        sign = -sign;
+    }
+    double p = 2.0 * sum;
+    return (p < 0) ? 0.0 : (p > 1) ? 1.0 : p;
+}
+
+double ad_p_value(double statistic) {
+    double z = statistic;
+    if (!(z > 0)) return 1.0;
+    double cdf;
+    if (z < 2) {
+        cdf = exp(-1.2337141 / z) / sqrt(z) *
+              (2.00012 + (0.247105 - (0.0649821 - (0.0347962 - (0.011672 - 0.00168691 * z) * z) * z) * z) * z);
+    } else {
+        cdf = exp(-exp(1.0776 - (2.30695 - (0.43424 - (0.082433 - (0.008056 - 0.0003146 * z) * z) * z) * z) * z));
+    }
+    double p = 1.0 - cdf;
+    return (p < 0) ? 0.0 : (p > 1) ? 1.0 : p;
+}
+
+double chi2_p_value(double statistic, int df) {
+    if (df <= 0 || !(statistic >= 0)) return 1.0;
+    return gsl_sf_gamma_inc_Q(0.5 * df, 0.5 * statistic);
+}
+
+// --- КРИТЕРИИ СОГЛАСИЯ ---
+
+int goodness_of_fit_sorted(const double *sorted, int sample_size, const InversionTable *table,
+                           int bins, ThreadPool *pool, GofReport *report) {
+    if (sorted == NULL || sample_size <= 0 || table == NULL || report == NULL) {
+        return -1;
+    }
+    if (bins <= 0) {
+        bins = (int)ceil(2.0 * pow(sample_size, 0.4));
+        if (bins < 5) bins = 5;
+        if (bins > 10000) bins = 10000;
+    }
+
+    int workers = thread_pool_size(pool);
+    GofJob job;
+    job.sorted = sorted;
+    job.n = sample_size;
+    job.table = table;
+    job.bins = bins;
+    job.chunks = (sample_size + GOF_CHUNK - 1) / GOF_CHUNK;
+    job.u = (double*)malloc((size_t)workers * GOF_CHUNK * sizeof(double));
+    job.d_plus = (double*)malloc(job.chunks * sizeof(double));
+    job.d_minus = (double*)malloc(job.chunks * sizeof(double));
+    job.ad_sums = (double*)malloc(job.chunks * sizeof(double));
+    job.counts = (long long*)calloc((size_t)workers * bins, sizeof(long long));
+    if (!job.u || !job.d_plus || !job.d_minus || !job.ad_sums || !job.counts) {
+        free(job.u);
+        free(job.d_plus);
+        free(job.d_minus);
+        free(job.ad_sums);
+        free(job.counts);
+        return -1;
+    }
+
+    thread_pool_run(pool, gof_task, &job);
+
+    // Частичные результаты кусков - в фиксированном порядке
+    double d = 0.0, ad = 0.0;
+    for (int c = 0; c < job.chunks; c++) {
+        if (job.d_plus[c] > d) d = job.d_plus[c];
+        if (job.d_minus[c] > d) d = job.d_minus[c];
+        ad += job.ad_sums[c];
+    }
+    double expected = (double)sample_size / bins;
+    double chi2 = 0.0;
+    for (int b = 0; b < bins; b++) {
+        long long count = 0;
+        for (int w = 0; w < workers; w++) {
+            count += job.counts[(size_t)w * bins + b];
+        }
+        chi2 += (count - expected) * (count - expected) / expected;
+    }
+
+    report->n = sample_size;
+    report->ks_statistic = d;
+    report->ks_p_value = ks_p_value(d, sample_size);
+    report->ad_statistic = -sample_size - ad;
+    report->ad_p_value = ad_p_value(report->ad_statistic);
+    report->chi2_statistic = chi2;
+    report->chi2_bins = bins;
+    report->chi2_p_value = chi2_p_value(chi2, bins - 1);
+
+    free(job.u);
+    free(job.d_plus);
+    free(job.d_minus);
+    free(job.ad_sums);
+    free(job.counts);
+    return 0;
+}
+
+int goodness_of_fit(double *sample, int sample_size, const MixtureParams *params, int is_mixture,
+                    int bins, ThreadPool *pool, GofReport *report) {
+    if (sample == NULL || sample_size <= 0 || params == NULL) {
+        return -1;
+    }
+    InversionTable *table = build_inversion_table(params, is_mixture, GOF_TABLE_TOLERANCE);
+    if (table == NULL || sort_parallel(sample, sample_size, pool) != 0) {
+        free_inversion_table(table);
+        return -1;
+    }
+    int result = goodness_of_fit_sorted(sample, sample_size, table, bins, pool, report);
+    free_inversion_table(table);
+    return result;
+}
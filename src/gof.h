@@ -0,0 +1,71 @@
+#ifndef GOF_H
+#define GOF_H
+
+#include "distributions.h"
+#include "parallel.h"
+
+// --- ПРОВЕРКА СОГЛАСИЯ ВЫБОРКИ С РАСПРЕДЕЛЕНИЕМ ---
+// Три критерия по одной упорядоченной выборке x_(1) <= ... <= x_(n) и значениям u_i = F(x_(i)):
+//   - Колмогорова-Смирнова: D = max(i/n - u_i, u_i - (i-1)/n);
+//   - Андерсона-Дарлинга: A^2 = -n - 1/n * sum((2i - 1) ln u_i + (2(n - i) + 1) ln(1 - u_i)),
+//     чувствителен к хвостам;
+//   - хи-квадрат Пирсона по k интервалам равной вероятности (интервал - floor(u_i * k)).
+// Выборка сортируется один раз (sort_parallel), F считается по таблице InversionTable
+// (прямой многочлен Эрмита, O(1) на значение, узел ищется продвижением по упорядоченной выборке).
+// Куски выборки обрабатываются параллельно (см. parallel.h): D и суммы A^2 хранятся по кускам,
+// целые счетчики интервалов - по потокам. Параметры распределения считаются известными.
+
+/**
+ * @brief Результаты проверки согласия.
+ */
+typedef struct {
+    int n;                    // Размер выборки
+    double ks_statistic;      // D Колмогорова-Смирнова
+    double ks_p_value;
+    double ad_statistic;      // A^2 Андерсона-Дарлинга
+    double ad_p_value;
+    double chi2_statistic;    // Хи-квадрат
+    int chi2_bins;            // Число интервалов (степеней свободы на одну меньше)
+    double chi2_p_value;
+} GofReport;
+
+/**
+ * @brief Проверяет согласие выборки с основным распределением или смесью.
+ * @param sample Выборка (сортируется на месте).
+ * @param sample_size Размер выборки.
+ * @param params Параметры распределения.
+ * @param is_mixture Флаг: 0 - основное распределение (mu1, lambda1, v1), 1 - смесь.
+ * @param bins Число интервалов хи-квадрат (0 - 2 n^(2/5), от 5 до 10000).
+ * @param pool Пул потоков (NULL - один поток).
+ * @param report Результаты.
+ * @return 0 при успехе, -1 при ошибке (пустая выборка, некорректные параметры, нет памяти).
+ */
+int goodness_of_fit(double *sample, int sample_size, const MixtureParams *params, int is_mixture,
+                    int bins, ThreadPool *pool, GofReport *report);
+
+/**
+ * @brief То же для уже упорядоченной выборки и готовой таблицы функции распределения.
+ * @param table Таблица (погрешности tolerance около 1e-12 хватает и для хвостов в A^2 при n = 10^8).
+ */
+int goodness_of_fit_sorted(const double *sorted, int sample_size, const InversionTable *table,
+                           int bins, ThreadPool *pool, GofReport *report);
+
+/**
+ * @brief Асимптотическое p-значение критерия Колмогорова-Смирнова.
+ * @note Ряд Колмогорова от (sqrt(n) + 0.12 + 0.11 / sqrt(n)) * D (поправка Стивенса для конечных n).
+ */
+double ks_p_value(double statistic, int n);
+
+/**
+ * @brief Асимптотическое p-значение критерия Андерсона-Дарлинга (Marsaglia, Marsaglia, 2004).
+ * @note Погрешность приближения предельного распределения меньше 2e-6; при n > 100
+ *       отличие от распределения для конечного n пренебрежимо мало.
+ */
+double ad_p_value(double statistic);
+
+/**
+ * @brief p-значение хи-квадрат с df степенями свободы: Q(df / 2, statistic / 2) из GSL.
+ */
+double chi2_p_value(double statistic, int df);
+
+#endif
@@ -0,0 +1,204 @@
+#include "kde.h"
+
+#include <gsl/gsl_fft_complex.h>
+
+#define M_PI 3.14159265358979323846
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+#define KDE_GAUSSIAN_CUTOFF 6.0      // Нормальное ядро обрезается на 6 h (теряется ~2e-9 массы)
+
+static double kernel_value(KdeKernel kernel, double u) {
+    if (kernel == KDE_EPANECHNIKOV) {
+        return (fabs(u) < 1.0) ? 0.75 * (1.0 - u * u) : 0.0;
+    }
+    return exp(-0.5 * u * u) / sqrt(2 * M_PI);
+}
+
+// Полуширина носителя ядра в единицах h
+static double kernel_support(KdeKernel kernel) {
+    return (kernel == KDE_EPANECHNIKOV) ? 1.0 : KDE_GAUSSIAN_CUTOFF;
+}
+
+// --- ШИРИНА ОКНА ---
+
+void default_kde_options(KdeOptions *options) {
+    options->kernel = KDE_GAUSSIAN;
+    options->rule = KDE_SILVERMAN;
+    options->bandwidth = 0.0;
+    options->grid_size = 4096;
+    options->x_min = 0.0;
+    options->x_max = 0.0;
+}
+
+double kde_bandwidth(const double *sample, int sample_size, KdeKernel kernel, KdeBandwidthRule rule) {
+    if (sample == NULL || sample_size < 2) {
+        return 0.0;
+    }
+
+    // moments_empirical не меняет выборку
+    double variance;
+    moments_empirical((double*)sample, sample_size, NULL, &variance, NULL, NULL);
+    double scale = sqrt(variance);
+    double factor = 1.059;
+
+    if (rule == KDE_SILVERMAN) {
+        factor = 0.9;
+        double *copy = (double*)malloc(sample_size * sizeof(double));
+        if (copy) {
+            memcpy(copy, sample, sample_size * sizeof(double));
+            double q1 = quantile_empirical(copy, sample_size, 0, 0.25);
+            double q3 = quantile_empirical(copy, sample_size, (int)(0.25 * (sample_size - 1)), 0.75);
+            double iqr_scale = (q3 - q1) / 1.349;
+            if (iqr_scale > 0 && iqr_scale < scale) scale = iqr_scale;
+            free(copy);
+        }
+    }
+
+    double h = factor * scale * pow(sample_size, -0.2);
+    if (kernel == KDE_EPANECHNIKOV) {
+        // Отношение канонических ширин (R(K) / mu_2(K)^2)^(1/5): 15^(1/5) / (1 / (2 sqrt(pi)))^(1/5)
+        h *= pow(30.0 * sqrt(M_PI), 0.2);
+    }
+    return h;
+}
+
+// --- ПОСТРОЕНИЕ ОЦЕНКИ ---
+
+KernelDensity* build_kernel_density(const double *sample, int sample_size, const KdeOptions *options) {
+    KdeOptions defaults;
+    if (options == NULL) {
+        default_kde_options(&defaults);
+        options = &defaults;
+    }
+    if (sample == NULL || sample_size <= 0 || options->grid_size < 16) {
+        return NULL;
+    }
+
+    double h = (options->bandwidth > 0) ? options->bandwidth
+                                        : kde_bandwidth(sample, sample_size, options->kernel, options->rule);
+    if (!(h > 0)) {
+        return NULL;
+    }
+
+    KernelDensity *kde = (KernelDensity*)malloc(sizeof(KernelDensity));
+    if (!kde) return NULL;
+    int m = options->grid_size;
+    kde->kernel = options->kernel;
+    kde->bandwidth = h;
+    kde->grid_size = m;
+    kde->density = (double*)calloc(m, sizeof(double));
+
+    // Отрезок сетки: заданный или размах выборки плюс носитель ядра
+    if (options->x_min < options->x_max) {
+        kde->x_min = options->x_min;
+        kde->x_max = options->x_max;
+    } else {
+        double lo = sample[0], hi = sample[0];
+        for (int i = 1; i < sample_size; i++) {
+            if (sample[i] < lo) lo = sample[i];
+            if (sample[i] > hi) hi = sample[i];
+        }
+        double margin = (options->kernel == KDE_EPANECHNIKOV) ? h : 4.0 * h;
+        kde->x_min = lo - margin;
+        kde->x_max = hi + margin;
+    }
+    kde->step = (kde->x_max - kde->x_min) / (m - 1);
+
+    // Ядро на сетке: смещения 0..reach, reach < m (дальше узлов все равно нет)
+    double reach_steps = kernel_support(options->kernel) * h / kde->step;
+    int reach = (reach_steps < m - 1) ? (int)ceil(reach_steps) : m - 1;
+
+    // Длина БПФ - степень двойки не меньше m + reach, чтобы циклическая свертка не заворачивалась
+    size_t fft_size = 1;
+    while (fft_size < (size_t)m + reach) fft_size <<= 1;
+    double *data = (double*)calloc(2 * fft_size, sizeof(double));     // Комплексные числа (re, im) подряд
+    double *kernel = (double*)calloc(2 * fft_size, sizeof(double));
+    if (!kde->density || !data || !kernel) {
+        free(data);
+        free(kernel);
+        free_kernel_density(kde);
+        return NULL;
+    }
+
+    // 1) Линейное разбиение выборки по узлам
+    double inv_step = 1.0 / kde->step;
+    for (int i = 0; i < sample_size; i++) {
+        double position = (sample[i] - kde->x_min) * inv_step;
+        if (!(position >= 0 && position <= m - 1)) continue;
+        int j = (int)position;
+        if (j >= m - 1) {
+            data[2 * (m - 1)] += 1.0;
+            continue;
+        }
+        double fraction = position - j;
+        data[2 * j] += 1.0 - fraction;
+        data[2 * (j + 1)] += fraction;
+    }
+
+    // 2) Веса ядра K_h(d * step) / n для смещений -reach..reach (отрицательные - с конца массива)
+    double norm = 1.0 / (sample_size * h);
+    for (int d = 0; d <= reach; d++) {
+        double value = norm * kernel_value(options->kernel, d * kde->step / h);
+        kernel[2 * d] = value;
+        if (d > 0) kernel[2 * (fft_size - d)] = value;
+    }
+
+    // 3) Свертка: произведение преобразований Фурье
+    gsl_fft_complex_radix2_forward(data, 1, fft_size);
+    gsl_fft_complex_radix2_forward(kernel, 1, fft_size);
+    for (size_t k = 0; k < fft_size; k++) {
+        double re = data[2 * k] * kernel[2 * k] - data[2 * k + 1] * kernel[2 * k + 1];
+        double im = data[2 * k] * kernel[2 * k + 1] + data[2 * k + 1] * kernel[2 * k];
+        data[2 * k] = re;
+        data[2 * k + 1] = im;
+    }
+    gsl_fft_complex_radix2_inverse(data, 1, fft_size);
+
+    // Ошибки округления БПФ дают крошечные отрицательные значения там, где плотность 0
+    for (int i = 0; i < m; i++) {
+        kde->density[i] = (data[2 * i] > 0) ? data[2 * i] : 0.0;
+    }
+
+    free(data);
+    free(kernel);
+    return kde;
+}
+
+// --- ВЫЧИСЛЕНИЕ ОЦЕНКИ ---
+
+double pdf_kernel_density(double x, const KernelDensity *kde) {
+    double position = (x - kde->x_min) / kde->step;
+    if (!(position >= 0 && position <= kde->grid_size - 1)) {
+        return 0.0;
+    }
+    int j = (int)position;
+    if (j >= kde->grid_size - 1) {
+        return kde->density[kde->grid_size - 1];
+    }
+    double fraction = position - j;
+    return (1.0 - fraction) * kde->density[j] + fraction * kde->density[j + 1];
+}
+
+void pdf_kernel_density_many(const KernelDensity *kde, const double *xs, double *out, int m) {
+    for (int i = 0; i < m; i++) {
+        out[i] = pdf_kernel_density(xs[i], kde);
+    }
+}
+
+void free_kernel_density(KernelDensity *kde) {
+    if (kde == NULL) return;
+    free(kde->density);
+    free(kde);
+}
+
+double pdf_kde_direct(double x, const double *sample, int sample_size, KdeKernel kernel, double bandwidth) {
+    if (sample == NULL || sample_size <= 0 || !(bandwidth > 0)) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < sample_size; i++) {
+        sum += kernel_value(kernel, (x - sample[i]) / bandwidth);
+    }
+    return sum / (sample_size * bandwidth);
+}
@@ -1,9 +1,17 @@
 #include "distributions.h"
+#include "parallel.h"
+#include "fitting.h"
+#include "plot_io.h"
+#include "kde.h"
+#include "gof.h"
+#include "bootstrap.h"
+#include "cli.h"
 
 // Прототипы функций
 void print_array(double *arr, int size);
 void test_value(const char *name, double actual, double expected, double tolerance);
 void test_generation(double mu, double lambda, double v, int sample_size);
+void test_sampler_stats();
 void test_mixture(MixtureParams *params, const char *test_name, 
                   double expected_mean, double expected_var, 
                   double expected_skew, double expected_kurt);
@@ -12,13 +20,21 @@ void test_bessel();
 void test_basic_distribution();
 void test_mixture_distributions();
 void run_all_tests();
+void test_parallel_scaling();
+void test_em_fitting();
+void test_inversion();
+void test_goodness_of_fit(double *sample, int sample_size, MixtureParams *params, int is_mixture);
 void show_menu();
 
 // Глобальные переменные для настроек
 int sample_size = 10000;
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char **argv) {
+    // С флагами - неинтерактивный режим (cli.h), без флагов - меню
+    if (argc > 1) {
+        return run_cli(argc, argv);
+    }
+    seed_random((uint64_t)time(NULL));
     show_menu();
     return 0;
 }
@@ -39,6 +55,9 @@ void show_menu() {
         printf("6. Тест генерации случайных величин\n");
         printf("7. Настройки (размер выборки)\n");
         printf("8. Генерация данных для графиков\n");
+        printf("9. Масштабирование параллельной генерации\n");
+        printf("10. Подгонка смеси EM-алгоритмом\n");
+        printf("11. Функция распределения и моделирование обращением\n");
         printf("0. Выход\n");
         printf("==============================================\n");
         printf("Выберите опцию: ");
@@ -66,6 +85,7 @@ void show_menu() {
                 test_generation(0.0, 1.0, 1.0, sample_size);
                 test_generation(5.0, 2.0, 1.0, sample_size);
                 test_generation(0.0, 1.0, 0.5, sample_size);
+                test_sampler_stats();
                 break;
             case 7:
                 printf("\nТекущий размер выборки: %d\n", sample_size);
@@ -79,151 +99,96 @@ void show_menu() {
                 // Тест 3.1.1: Стандартное распределение
                 MixtureParams params_311 = {0, 1, 1.0, 0, 0, 0, 0};
                 double* sample_311 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_311[i] = generate_main(0, 1, 1.0);
-                }
-                PlotData* plot_311 = generate_plot_data("3.1.1", &params_311, 0, sample_311, 10000);
-                save_plot_data(plot_311);
-                free_plot_data(plot_311);
+                generate_main_n(0, 1, 1.0, sample_311, 10000, rng_default());
+                stream_plot_case("3.1.1", &params_311, 0, sample_311, 10000);
                 free(sample_311);
 
                 // Тест 3.1.2: Масштабирование
                 MixtureParams params_312 = {0, 2, 1.0, 0, 0, 0, 0};
                 double* sample_312 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_312[i] = generate_main(0, 2, 1.0);
-                }
-                PlotData* plot_312 = generate_plot_data("3.1.2", &params_312, 0, sample_312, 10000);
-                save_plot_data(plot_312);
-                free_plot_data(plot_312);
+                generate_main_n(0, 2, 1.0, sample_312, 10000, rng_default());
+                stream_plot_case("3.1.2", &params_312, 0, sample_312, 10000);
                 free(sample_312);
 
                 // Тест 3.1.3: Сдвиг-масштаб
                 MixtureParams params_313 = {5, 2, 1.0, 0, 0, 0, 0};
                 double* sample_313 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_313[i] = generate_main(5, 2, 1.0);
-                }
-                PlotData* plot_313 = generate_plot_data("3.1.3", &params_313, 0, sample_313, 10000);
-                save_plot_data(plot_313);
-                free_plot_data(plot_313);
+                generate_main_n(5, 2, 1.0, sample_313, 10000, rng_default());
+                stream_plot_case("3.1.3", &params_313, 0, sample_313, 10000);
                 free(sample_313);
                 // Тест 3.2.1: Тривиальный случай смеси
                 MixtureParams params_321 = {0, 2, 1.0, 0, 2, 1.0, 0.5};
                 double* sample_321 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_321[i] = generate_mixture(&params_321);
-                }
-                PlotData* plot_321 = generate_plot_data("3.2.1", &params_321, 1, sample_321, 10000);
-                save_plot_data(plot_321);
-                free_plot_data(plot_321);
+                generate_mixture_n(&params_321, sample_321, 10000, rng_default());
+                stream_plot_case("3.2.1", &params_321, 1, sample_321, 10000);
                 free(sample_321);
                 // Тест 3.2.2: Сдвиговые преобразования
                 MixtureParams params_322 = {0, 1, 1.0, 2, 1, 1.0, 0.75};
                 double* sample_322 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_322[i] = generate_mixture(&params_322);
-                }
-                PlotData* plot_322 = generate_plot_data("3.2.2", &params_322, 1, sample_322, 10000);
-                save_plot_data(plot_322);
-                free_plot_data(plot_322);
+                generate_mixture_n(&params_322, sample_322, 10000, rng_default());
+                stream_plot_case("3.2.2", &params_322, 1, sample_322, 10000);
                 free(sample_322);
                 
                 // Тест 3.2.3: Масштабные преобразования
                 MixtureParams params_323 = {0, 1, 1.0, 0, 3, 1.0, 0.5};
                 double* sample_323 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_323[i] = generate_mixture(&params_323);
-                }
-                PlotData* plot_323 = generate_plot_data("3.2.3", &params_323, 1, sample_323, 10000);
-                save_plot_data(plot_323);
-                free_plot_data(plot_323);
+                generate_mixture_n(&params_323, sample_323, 10000, rng_default());
+                stream_plot_case("3.2.3", &params_323, 1, sample_323, 10000);
                 free(sample_323);
                 
                 // Тест 3.2.4: Разные параметры формы
                 MixtureParams params_324 = {0, 1, 0.5, 0, 1, 2.0, 0.5};
                 double* sample_324 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_324[i] = generate_mixture(&params_324);
-                }
-                PlotData* plot_324 = generate_plot_data("3.2.4", &params_324, 1, sample_324, 10000);
-                save_plot_data(plot_324);
-                free_plot_data(plot_324);
+                generate_mixture_n(&params_324, sample_324, 10000, rng_default());
+                stream_plot_case("3.2.4", &params_324, 1, sample_324, 10000);
                 free(sample_324);
                 // ------------------- Тест 3.3.1.1: Основное распределение с большим параметром формы -------------------
                 MixtureParams params_3311 = {0, 1, 5.0, 0, 0, 0, 0};  // ν=5.0
                 double* sample_3311 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_3311[i] = generate_main(0, 1, 5.0);
-                }
-                PlotData* plot_3311 = generate_plot_data("3.3.1.1", &params_3311, 0, sample_3311, 10000);
-                save_plot_data(plot_3311);
-                free_plot_data(plot_3311);
+                generate_main_n(0, 1, 5.0, sample_3311, 10000, rng_default());
+                stream_plot_case("3.3.1.1", &params_3311, 0, sample_3311, 10000);
                 free(sample_3311);
             
                 // ------------------- Тест 3.3.1.2: Смесь с ярко выраженными модами -------------------
                 MixtureParams params_3312 = {-3, 1, 1.0, 3, 1, 1.0, 0.3};  // две моды: -3 и 3, p=0.3
                 double* sample_3312 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_3312[i] = generate_mixture(&params_3312);
-                }
-                PlotData* plot_3312 = generate_plot_data("3.3.1.2", &params_3312, 1, sample_3312, 10000);
-                save_plot_data(plot_3312);
-                free_plot_data(plot_3312);
+                generate_mixture_n(&params_3312, sample_3312, 10000, rng_default());
+                stream_plot_case("3.3.1.2", &params_3312, 1, sample_3312, 10000);
                 free(sample_3312);
             
                 // ------------------- Тест 3.3.1.3: Основное распределение с маленьким параметром формы -------------------
                 MixtureParams params_3313 = {0, 1, 0.2, 0, 0, 0, 0};  // ν=0.2
                 double* sample_3313 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_3313[i] = generate_main(0, 1, 0.2);
-                }
-                PlotData* plot_3313 = generate_plot_data("3.3.1.3", &params_3313, 0, sample_3313, 10000);
-                save_plot_data(plot_3313);
-                free_plot_data(plot_3313);
+                generate_main_n(0, 1, 0.2, sample_3313, 10000, rng_default());
+                stream_plot_case("3.3.1.3", &params_3313, 0, sample_3313, 10000);
                 free(sample_3313);
             
                 // ------------------- Тест 3.3.1.4: Смесь с разными масштабами -------------------
                 MixtureParams params_3314 = {0, 0.5, 1.0, 0, 2, 1.0, 0.7};  // λ₁=0.5, λ₂=2, p=0.7
                 double* sample_3314 = (double*)malloc(10000 * sizeof(double));
-                for (int i = 0; i < 10000; i++) {
-                    sample_3314[i] = generate_mixture(&params_3314);
-                }
-                PlotData* plot_3314 = generate_plot_data("3.3.1.4", &params_3314, 1, sample_3314, 10000);
-                save_plot_data(plot_3314);
-                free_plot_data(plot_3314);
+                generate_mixture_n(&params_3314, sample_3314, 10000, rng_default());
+                stream_plot_case("3.3.1.4", &params_3314, 1, sample_3314, 10000);
                 free(sample_3314);
             
                 // ------------------- Тест 3.3.2: Мега сложный график - три распределения -------------------
                 
                 // Шаг 1: Основное распределение (теоретическое)
                 MixtureParams main_dist = {0, 1, 1.0, 0, 0, 0, 0};  // μ=0, λ=1, ν=1
-                PlotData* plot_main = generate_plot_data("3.3.2_main", &main_dist, 0, NULL, 0);
-                save_plot_data(plot_main);
-                free_plot_data(plot_main);
+                stream_plot_case("3.3.2_main", &main_dist, 0, NULL, 0);
                 
                 // Шаг 2: Генерируем выборку из основного распределения
                 double* sample_from_main = (double*)malloc(5000 * sizeof(double));
-                for (int i = 0; i < 5000; i++) {
-                    sample_from_main[i] = generate_main(0, 1, 1.0);
-                }
+                generate_main_n(0, 1, 1.0, sample_from_main, 5000, rng_default());
                 
                 // Шаг 3: Эмпирическое распределение из выборки основного
-                PlotData* plot_empirical_from_main = generate_plot_data("3.3.2_empirical_main", &main_dist, 0, sample_from_main, 5000);
-                save_plot_data(plot_empirical_from_main);
-                free_plot_data(plot_empirical_from_main);
+                stream_plot_case("3.3.2_empirical_main", &main_dist, 0, sample_from_main, 5000);
                 
                 // Шаг 4: Генерируем выборку из эмпирического распределения (бутстрэп)
                 double* sample_from_empirical = (double*)malloc(5000 * sizeof(double));
-                for (int i = 0; i < 5000; i++) {
-                    int random_index = rand() % 5000;
-                    sample_from_empirical[i] = sample_from_main[random_index];
-                }
+                generate_empirical_n(sample_from_main, 5000, sample_from_empirical, 5000, rng_default());
                 
                 // Шаг 5: Эмпирическое распределение из бутстрэп-выборки
-                PlotData* plot_empirical_bootstrap = generate_plot_data("3.3.2_empirical_bootstrap", &main_dist, 0, sample_from_empirical, 5000);
-                save_plot_data(plot_empirical_bootstrap);
-                free_plot_data(plot_empirical_bootstrap);
+                stream_plot_case("3.3.2_empirical_bootstrap", &main_dist, 0, sample_from_empirical, 5000);
                 
                 free(sample_from_main);
                 free(sample_from_empirical);
@@ -231,6 +196,15 @@ void show_menu() {
                 printf("Все файлы данных сгенерированы!\n");
                 break;
                 }
+            case 9:
+                test_parallel_scaling();
+                break;
+            case 10:
+                test_em_fitting();
+                break;
+            case 11:
+                test_inversion();
+                break;
             case 0:
                 printf("Выход...\n");
                 break;
@@ -288,6 +262,11 @@ void test_basic_distribution() {
     printf("\n=== Тест со сдвигом (mu=5, lambda=1, v=1.0) ===\n");
     moments_main(5.0, 1.0, 1.0, &mean, &variance, &skewness, &kurtosis);
     test_value("Среднее при mu=5", mean, 5.0, 0.001);
+    
+    printf("\n=== Функция распределения (mu=5, lambda=1, v=1.0) ===\n");
+    test_value("F(mu)", cdf_main(5.0, 5.0, 1.0, 1.0), 0.5, 1e-12);
+    test_value("F(mu - 2) + F(mu + 2)", cdf_main(3.0, 5.0, 1.0, 1.0) + cdf_main(7.0, 5.0, 1.0, 1.0), 1.0, 1e-12);
+    test_value("F(q(0.975))", cdf_main(quantile_main(0.975, 5.0, 1.0, 1.0), 5.0, 1.0, 1.0), 0.975, 1e-12);
 }
 
 void test_mixture_distributions() {
@@ -325,6 +304,282 @@ void test_bessel() {
         
         printf("%.1f\t%.6f\t%.6f\t%.6f\t%.3f\n", v, k1, k2, k3, variance);
     }
+    
+    // Кэш: после первого вызова moments_main для того же v функции Бесселя не пересчитываются
+    // (v из distributions_shapes.h кэш не используют, поэтому взяты другие значения)
+    double cached_v[] = {0.05, 0.3, 0.7, 5.0, 50.0};
+    for (int i = 0; i < 5; i++) {
+        moments_main(0.0, 1.0, cached_v[i], NULL, NULL, NULL, NULL);
+    }
+    uint64_t misses = bessel_cache_misses();
+    for (int repeat = 0; repeat < 100; repeat++) {
+        for (int i = 0; i < 5; i++) {
+            moments_main(0.0, 1.0, cached_v[i], NULL, NULL, NULL, NULL);
+        }
+    }
+    printf("\n");
+    test_value("Промахи кэша K_nu при повторных moments_main", (double)(bessel_cache_misses() - misses), 0.0, 0.0);
+
+    // При больших v сами K_nu(v) уходят в 0, а эксцесс приближается к 3 / v
+    double large_v[] = {400.0, 1000.0};
+    for (int i = 0; i < 2; i++) {
+        double kurtosis;
+        moments_main(0.0, 1.0, large_v[i], NULL, NULL, NULL, &kurtosis);
+        SHDist dist;
+        prepare_sh_dist(&dist, 0.0, 1.0, large_v[i]);
+        char label[64];
+        snprintf(label, sizeof(label), "Эксцесс * v / 3 при v = %g", large_v[i]);
+        test_value(label, kurtosis * large_v[i] / 3.0, 1.0, 0.02);
+        snprintf(label, sizeof(label), "Эксцесс SHDist при v = %g", large_v[i]);
+        test_value(label, dist.kurtosis, kurtosis, 0.0);
+    }
+
+    // Таблица Чебышева: погрешность на сетке, не совпадающей с узлами
+    BesselTable *table = build_bessel_table(0.01, 500.0, 1e-12);
+    if (!table) {
+        printf("\nНе удалось построить таблицу K_nu\n");
+        return;
+    }
+    double max_error = 0.0;
+    for (int nu = 0; nu <= 3; nu++) {
+        for (int i = 0; i < 1000; i++) {
+            double v = 0.0137 * pow(1.1, i * 0.1);
+            if (v > 500.0) break;
+            double error = fabs(bessel_table_k(table, nu, v) / bessel_k(nu, v) - 1.0);
+            if (error > max_error) max_error = error;
+        }
+    }
+    printf("\nТаблица K_nu на [0.01, 500]: частей %d, погрешность при построении %.2e\n",
+           table->segments, table->max_rel_error);
+    test_value("Наибольшая относительная погрешность (x1e12)", max_error * 1e12, 0.0, 1.0);
+    free_bessel_table(table);
+}
+
+void test_parallel_scaling() {
+    printf("\n=== МАСШТАБИРОВАНИЕ ПАРАЛЛЕЛЬНОЙ ГЕНЕРАЦИИ ===\n");
+    
+    const int n = 10000000;
+    const uint64_t seed = 12345;
+    double *sample = malloc(n * sizeof(double));
+    double *check = malloc(n * sizeof(double));
+    if (!sample || !check) {
+        printf("Ошибка выделения памяти!\n");
+        free(sample);
+        free(check);
+        return;
+    }
+    
+    MixtureParams mixture = {0.0, 1.0, 0.5, 0.0, 1.0, 2.0, 0.5};
+    int cores = available_cores();
+    printf("Доступно ядер: %d, n=%d\n", cores, n);
+    printf("Потоки\tСГР, млн/с\tСмесь, млн/с\tБутстрэп, млн/с\tУскорение (СГР)\n");
+    printf("----------------------------------------------------------------------\n");
+    
+    double base_rate = 0.0;
+    for (int threads = 1; threads <= cores; threads++) {
+        ThreadPool *pool = create_thread_pool(threads);
+        if (!pool) {
+            printf("Не удалось создать пул из %d потоков\n", threads);
+            break;
+        }
+        
+        double start = wall_time();
+        generate_main_parallel(0.0, 1.0, 1.0, sample, n, seed, pool);
+        double main_rate = n / (wall_time() - start) / 1e6;
+        
+        start = wall_time();
+        generate_mixture_parallel(&mixture, check, n, seed, pool);
+        double mixture_rate = n / (wall_time() - start) / 1e6;
+        
+        start = wall_time();
+        generate_empirical_parallel(sample, n, check, n, seed, pool);
+        double empirical_rate = n / (wall_time() - start) / 1e6;
+        
+        if (threads == 1) base_rate = main_rate;
+        printf("%d\t%.2f\t\t%.2f\t\t%.2f\t\t%.2fx\n",
+               threads, main_rate, mixture_rate, empirical_rate, main_rate / base_rate);
+        
+        // Повторный запуск с тем же seed и числом потоков должен дать ту же выборку
+        if (threads == cores) {
+            generate_main_parallel(0.0, 1.0, 1.0, check, n, seed, pool);
+            int same = memcmp(sample, check, n * sizeof(double)) == 0;
+            printf("\nВоспроизводимость при %d потоках: %s\n", threads, same ? "OK" : "FAIL");
+        }
+        
+        free_thread_pool(pool);
+    }
+    
+    free(sample);
+    free(check);
+}
+
+void test_em_fitting() {
+    printf("\n=== ПОДГОНКА СМЕСИ EM-АЛГОРИТМОМ ===\n");
+    
+    const int n = 1000000;
+    double *sample = malloc(n * sizeof(double));
+    ThreadPool *pool = create_thread_pool(0);
+    if (!sample) {
+        printf("Ошибка выделения памяти!\n");
+        free_thread_pool(pool);
+        return;
+    }
+    
+    MixtureParams truth = {-2.0, 1.0, 0.7, 3.0, 1.5, 3.0, 0.4};
+    generate_mixture_parallel(&truth, sample, n, 2024, pool);
+    printf("Выборка: n=%d, потоков: %d\n", n, thread_pool_size(pool));
+    
+    EMOptions options;
+    default_em_options(&options);
+    options.pool = pool;
+    
+    // Подбор формы много раз вычисляет K_0 и K_1 - берем их из таблицы
+    BesselTable *table = build_bessel_table(0.01, options.v_max, 1e-12);
+    use_bessel_table(table);
+    
+    double start = wall_time();
+    EMResult result;
+    Mixture *fit = fit_mixture_em(sample, n, 2, &options, &result);
+    double elapsed = wall_time() - start;
+    use_bessel_table(NULL);
+    free_bessel_table(table);
+    if (!fit) {
+        printf("Ошибка подгонки!\n");
+        free(sample);
+        free_thread_pool(pool);
+        return;
+    }
+    
+    printf("Итераций: %d (проходов по выборке: %d), сходимость: %s, время: %.2f с\n",
+           result.iterations, result.e_steps, result.converged ? "да" : "нет", elapsed);
+    printf("Логарифм правдоподобия на точку: %.6f\n", result.loglik / n);
+    
+    // Компоненты упорядочиваем по сдвигу, чтобы сравнить с истинными
+    int first = (fit->mu[0] <= fit->mu[1]) ? 0 : 1;
+    int second = 1 - first;
+    test_value("p", fit->weight[first], truth.p, 0.01);
+    test_value("mu1", fit->mu[first], truth.mu1, 0.02);
+    test_value("lambda1", fit->lambda[first], truth.lambda1, 0.05);
+    test_value("v1", fit->v[first], truth.v1, 0.1);
+    test_value("mu2", fit->mu[second], truth.mu2, 0.02);
+    test_value("lambda2", fit->lambda[second], truth.lambda2, 0.05);
+    test_value("v2", fit->v[second], truth.v2, 0.3);
+
+    // Почти нормальная выборка: форма подбирается по эксцессу при v до 500, где сами K_nu(v) уходят в 0.
+    // Эксцесс модели при найденном v равен выборочному, а при эксцессе ниже достижимого v = 500
+    const int guess_size = 100000;
+    RngState rng;
+    rng_seed(&rng, 5);
+    generate_main_n(0.0, 1.0, 450.0, sample, guess_size, &rng);
+    double sample_mean, sample_variance, sample_skewness, sample_kurtosis;
+    moments_empirical(sample, guess_size, &sample_mean, &sample_variance, &sample_skewness, &sample_kurtosis);
+    Mixture *guess = initial_mixture_guess(sample, guess_size, 1);
+    if (guess) {
+        double model_kurtosis, limit_kurtosis;
+        moments_main(0.0, 1.0, guess->v[0], NULL, NULL, NULL, &model_kurtosis);
+        moments_main(0.0, 1.0, 500.0, NULL, NULL, NULL, &limit_kurtosis);
+        printf("Начальное приближение: v = %.2f при выборочном эксцессе %.5f\n", guess->v[0], sample_kurtosis);
+        if (sample_kurtosis <= limit_kurtosis) {
+            test_value("v начального приближения", guess->v[0], 500.0, 1e-9);
+        } else {
+            test_value("Эксцесс начального приближения", model_kurtosis, sample_kurtosis, 1e-6);
+        }
+        free_mixture(guess);
+    }
+
+    free_mixture(fit);
+    free(sample);
+    free_thread_pool(pool);
+}
+
+void test_inversion() {
+    printf("\n=== ФУНКЦИЯ РАСПРЕДЕЛЕНИЯ И МОДЕЛИРОВАНИЕ ОБРАЩЕНИЕМ ===\n");
+    
+    MixtureParams params = {-1.0, 0.5, 0.3, 2.0, 2.0, 3.0, 0.3};
+    double q = quantile_mixture(0.37, &params);
+    printf("Квантиль смеси уровня 0.37: %.10f\n", q);
+    test_value("F(q(0.37))", cdf_mixture(q, &params), 0.37, 1e-12);
+    double tail = cdf_main(quantile_main(1e-12, 0.0, 1.0, 0.5), 0.0, 1.0, 0.5);
+    test_value("F(q(1e-12)) / 1e-12", tail / 1e-12, 1.0, 1e-9);
+    
+    double start = wall_time();
+    InversionTable *table = build_inversion_table(&params, 1, 1e-10);
+    double build_time = wall_time() - start;
+    if (!table) {
+        printf("Ошибка построения таблицы!\n");
+        return;
+    }
+    printf("Таблица: %d узлов, ошибка по u: %.2e, построена за %.1f мс\n",
+           table->size, table->max_u_error, build_time * 1000);
+    
+    // Среднее по псевдослучайным и квазислучайным точкам при одинаковом числе значений
+    const int n = 4096, series = 50;
+    double mean, variance;
+    moments_mixture(&params, &mean, &variance, NULL, NULL);
+    RngState rng;
+    rng_seed(&rng, 2024);
+    double mc_error = 0.0, qmc_error = 0.0;
+    start = wall_time();
+    for (int s = 0; s < series; s++) {
+        double shift = rng_uniform(&rng);
+        double mc = 0.0, qmc = 0.0;
+        for (int i = 0; i < n; i++) {
+            mc += generate_inversion_r(table, &rng);
+            qmc += inversion_quantile(table, van_der_corput(i, shift));
+        }
+        mc_error += (mc / n - mean) * (mc / n - mean);
+        qmc_error += (qmc / n - mean) * (qmc / n - mean);
+    }
+    double elapsed = wall_time() - start;
+    printf("Время на значение: %.1f нс\n", elapsed / (2.0 * n * series) * 1e9);
+    printf("Средний квадрат ошибки среднего: псевдослучайные %.3e, квазислучайные %.3e\n",
+           mc_error / series, qmc_error / series);
+    test_value("Выигрыш квазислучайных точек > 10", (mc_error > 10 * qmc_error) ? 1.0 : 0.0, 1.0, 0.0);
+    double edge = van_der_corput(0, 1.0 - 0x1.0p-53);
+    test_value("van_der_corput(0, 1 - 2^-53) в (0, 1)", (edge > 0.0 && edge < 1.0) ? 1.0 : 0.0, 1.0, 0.0);
+    free_inversion_table(table);
+
+    // Таблица строится в координатах (x - mu) / lambda: число узлов не зависит от mu и lambda
+    MixtureParams standard = {0.0, 1.0, 0.5, 0.0, 1.0, 0.5, 1.0};
+    MixtureParams shifted[] = {{1e6, 1.0, 0.5, 0.0, 1.0, 0.5, 1.0}, {1e3, 1e-3, 0.5, 0.0, 1.0, 0.5, 1.0}};
+    InversionTable *reference = build_inversion_table(&standard, 0, 1e-12);
+    if (!reference) {
+        printf("Ошибка построения таблицы!\n");
+        return;
+    }
+    for (int k = 0; k < 2; k++) {
+        InversionTable *moved = build_inversion_table(&shifted[k], 0, 1e-12);
+        char label[96];
+        snprintf(label, sizeof(label), "Узлов при mu = %g, lambda = %g", shifted[k].mu1, shifted[k].lambda1);
+        test_value(label, moved ? moved->size : 0, reference->size, 0.0);
+        if (!moved) continue;
+        double z = (inversion_quantile(moved, 0.37) - shifted[k].mu1) / shifted[k].lambda1;
+        snprintf(label, sizeof(label), "(q(0.37) - mu) / lambda при mu = %g", shifted[k].mu1);
+        test_value(label, z, inversion_quantile(reference, 0.37), 1e-9);
+        free_inversion_table(moved);
+    }
+    free_inversion_table(reference);
+
+    // Проверка согласия строит ту же таблицу с ошибкой 1e-12 - при большом |mu| / lambda она не должна отказывать
+    const int gof_size = 10000;
+    double *sample = malloc(gof_size * sizeof(double));
+    if (!sample) return;
+    for (int k = 0; k < 2; k++) {
+        rng_seed(&rng, 2025 + k);
+        generate_main_n(shifted[k].mu1, shifted[k].lambda1, shifted[k].v1, sample, gof_size, &rng);
+        GofReport report;
+        int status = goodness_of_fit(sample, gof_size, &shifted[k], 0, 0, NULL, &report);
+        char label[96];
+        snprintf(label, sizeof(label), "Согласие при mu = %g, lambda = %g: p(KS) >= 0.001",
+                 shifted[k].mu1, shifted[k].lambda1);
+        test_value(label, (status == 0 && report.ks_p_value >= 0.001) ? 1.0 : 0.0, 1.0, 0.0);
+    }
+    free(sample);
+
+    // Режим командной строки берет таблицу оттуда же (CLI_TABLE_TOLERANCE)
+    char *cli_args[] = {"spreadings", "--mu", "1e6", "--n", "1000", "--seed", "7", "--gof", "--format", "csv"};
+    int cli_status = run_cli(sizeof(cli_args) / sizeof(cli_args[0]), cli_args);
+    test_value("Код завершения --mu 1e6 --n 1000 --gof", cli_status, 0.0, 0.0);
 }
 
 // Реализации вспомогательных функций (остаются без изменений)
@@ -352,9 +607,7 @@ void test_generation(double mu, double lambda, double v, int sample_size) {
         return;
     }
     
-    for (int i = 0; i < sample_size; i++) {
-        sample[i] = generate_main(mu, lambda, v);
-    }
+    generate_main_n(mu, lambda, v, sample, sample_size, rng_default());
     
     double mean, variance, skewness, kurtosis;
     moments_empirical(sample, sample_size, &mean, &variance, &skewness, &kurtosis);
@@ -380,6 +633,82 @@ void test_generation(double mu, double lambda, double v, int sample_size) {
     test_value("Асимметрия", skewness, theory_skewness, 0.2);
     test_value("Эксцесс", kurtosis, theory_kurtosis, 0.3);
     
+    MixtureParams params = {mu, lambda, v, 0.0, 1.0, 1.0, 1.0};
+    test_goodness_of_fit(sample, sample_size, &params, 0);
+    
+    free(sample);
+}
+
+void test_sampler_stats() {
+    printf("\n=== СТАТИСТИКА ОТБОРА GIG ПО ПАРАМЕТРУ ФОРМЫ ===\n");
+    
+    const int n = 1000000;
+    const double shapes[] = {0.05, 0.2, 0.5, 1.0, 3.0, 5.0, 50.0, 500.0};
+    const int shape_count = sizeof(shapes) / sizeof(shapes[0]);
+    double *sample = malloc(n * sizeof(double));
+    ThreadPool *pool = create_thread_pool(0);
+    int workers = thread_pool_size(pool);
+    SamplerStats *per_worker = malloc(workers * sizeof(SamplerStats));
+    if (!sample || !per_worker) {
+        printf("Ошибка выделения памяти!\n");
+        free(sample);
+        free(per_worker);
+        free_thread_pool(pool);
+        return;
+    }
+    attach_pool_sampler_stats(pool, per_worker);
+    
+    printf("n=%d на каждое v, потоков: %d\n", n, workers);
+    printf("v\tПринятие\tПопыток/знач\tСлов/знач\tМакс. попыток\t>=%d попыток\n",
+           SAMPLER_HISTOGRAM_SIZE);
+    printf("----------------------------------------------------------------------------\n");
+    
+    int all_counted = 1;
+    for (int s = 0; s < shape_count; s++) {
+        for (int w = 0; w < workers; w++) {
+            init_sampler_stats(&per_worker[w]);
+        }
+        generate_main_parallel(0.0, 1.0, shapes[s], sample, n, 777 + s, pool);
+        
+        SamplerStats total;
+        init_sampler_stats(&total);
+        for (int w = 0; w < workers; w++) {
+            merge_sampler_stats(&total, &per_worker[w]);
+        }
+        all_counted &= (total.values == (uint64_t)n && total.acceptances == total.values);
+        
+        printf("%g\t%.4f\t\t%.3f\t\t%.3f\t\t%llu\t\t%llu\n", shapes[s],
+               sampler_acceptance_rate(&total), (double)total.proposals / total.values,
+               (double)total.rng_draws / total.values, (unsigned long long)total.max_attempts,
+               (unsigned long long)total.attempts_histogram[SAMPLER_HISTOGRAM_SIZE - 1]);
+        
+        // Разброс по потокам: при одинаковой нагрузке доли принятия должны совпадать
+        if (workers > 1) {
+            printf("\tпо потокам:");
+            for (int w = 0; w < workers; w++) {
+                printf(" %.4f", sampler_acceptance_rate(&per_worker[w]));
+            }
+            printf("\n");
+        }
+    }
+    printf("\nВсе значения учтены: %s\n", all_counted ? "OK" : "FAIL");
+    attach_pool_sampler_stats(pool, NULL);
+    
+    // Гистограмма числа попыток для наименьшего v в одном потоке
+    SamplerStats single;
+    init_sampler_stats(&single);
+    SamplerStats *previous = attach_sampler_stats(&single);
+    generate_main_n(0.0, 1.0, shapes[0], sample, n, rng_default());
+    attach_sampler_stats(previous);
+    printf("\nЧисло попыток на значение при v=%g (один поток):\n", shapes[0]);
+    for (int k = 0; k < SAMPLER_HISTOGRAM_SIZE; k++) {
+        if (single.attempts_histogram[k] == 0) continue;
+        printf("%s%d\t%.6f\n", (k == SAMPLER_HISTOGRAM_SIZE - 1) ? ">=" : "", k + 1,
+               (double)single.attempts_histogram[k] / single.values);
+    }
+    
+    free_thread_pool(pool);
+    free(per_worker);
     free(sample);
 }
 
@@ -399,9 +728,7 @@ void test_mixture(MixtureParams *params, const char *test_name,
     
     const int s_size = 50000;
     double *sample = malloc(s_size * sizeof(double));
-    for (int i = 0; i < s_size; i++) {
-        sample[i] = generate_mixture(params);
-    }
+    generate_mixture_n(params, sample, s_size, rng_default());
     
     double emp_mean, emp_var, emp_skew, emp_kurt;
     moments_empirical(sample, s_size, &emp_mean, &emp_var, &emp_skew, &emp_kurt);
@@ -412,9 +739,29 @@ void test_mixture(MixtureParams *params, const char *test_name,
     printf("Асимметрия: %.3f\n", emp_skew);
     printf("Эксцесс: %.3f\n", emp_kurt);
     
+    test_goodness_of_fit(sample, s_size, params, 1);
+    
     free(sample);
 }
 
+void test_goodness_of_fit(double *sample, int sample_size, MixtureParams *params, int is_mixture) {
+    // Моменты совпадают и у неверно смоделированной выборки - критерии проверяют распределение целиком.
+    // Выборка при этом сортируется
+    GofReport report;
+    if (goodness_of_fit(sample, sample_size, params, is_mixture, 0, NULL, &report) != 0) {
+        printf("Ошибка проверки согласия!\n");
+        return;
+    }
+    
+    printf("\nПроверка согласия (n=%d, отвергаем при p < 0.001):\n", sample_size);
+    printf("Колмогоров-Смирнов: D=%.5f, p=%.4f - %s\n", report.ks_statistic, report.ks_p_value,
+           (report.ks_p_value >= 0.001) ? "OK" : "FAIL");
+    printf("Андерсон-Дарлинг: A2=%.4f, p=%.4f - %s\n", report.ad_statistic, report.ad_p_value,
+           (report.ad_p_value >= 0.001) ? "OK" : "FAIL");
+    printf("Хи-квадрат: %.2f (%d интервалов), p=%.4f - %s\n", report.chi2_statistic, report.chi2_bins,
+           report.chi2_p_value, (report.chi2_p_value >= 0.001) ? "OK" : "FAIL");
+}
+
 void test_empirical() {
     printf("\n=== ТЕСТ ЭМПИРИЧЕСКОГО РАСПРЕДЕЛЕНИЯ ===\n");
     
@@ -453,40 +800,59 @@ void test_empirical() {
         return;
     }
     
-    for (int i = 0; i < sample_size; i++) {
-        sample[i] = generate_main(0.0, 1.0, 1.0);
-    }
+    generate_main_n(0.0, 1.0, 1.0, sample, sample_size, rng_default());
     
     // Вычисляем теоретическую и эмпирическую плотность в ключевых точках
     double test_points[] = {-2.0, -1.5, -1.0, -0.5, 0.0, 0.5, 1.0, 1.5, 2.0};
     int n_points = sizeof(test_points) / sizeof(test_points[0]);
     
-    printf("Сравнение плотностей в точках (n=%d):\n", sample_size);
-    printf(" x\tТеор. f(x)\tЭмп. f(x)\tОтн. ошибка\n");
-    printf("------------------------------------------------\n");
+    // Гистограмма и ядерная оценка строятся один раз и переиспользуются для всех точек
+    EmpiricalHistogram *hist = build_empirical_histogram(sample, sample_size);
+    KernelDensity *kde = build_kernel_density(sample, sample_size, NULL);
+    if (!kde) {
+        printf("Не удалось построить ядерную оценку плотности!\n");
+        free_empirical_histogram(hist);
+        free(sample);
+        return;
+    }
+    
+    printf("Сравнение плотностей в точках (n=%d, ширина окна KDE h=%.4f):\n", sample_size, kde->bandwidth);
+    printf(" x\tТеор. f(x)\tЭмп. f(x)\tОтн. ошибка\tKDE f(x)\tОтн. ошибка\n");
+    printf("------------------------------------------------------------------------\n");
     
     for (int i = 0; i < n_points; i++) {
         double x = test_points[i];
         double theory_pdf = pdf_main(x, 0.0, 1.0, 1.0);
-        double empirical_pdf = pdf_empirical(x, sample, sample_size);
+        double empirical_pdf = pdf_histogram(x, hist);
         double error = fabs(theory_pdf - empirical_pdf) / theory_pdf * 100;
+        double kde_pdf = pdf_kernel_density(x, kde);
+        double kde_error = fabs(theory_pdf - kde_pdf) / theory_pdf * 100;
         
-        printf("%.1f\t%.6f\t%.6f\t%.1f%%\n", x, theory_pdf, empirical_pdf, error);
+        printf("%.1f\t%.6f\t%.6f\t%.1f%%\t\t%.6f\t%.1f%%\n", x, theory_pdf, empirical_pdf, error, kde_pdf, kde_error);
     }
     
+    // Сеточная оценка (разбиение + БПФ) против прямого суммирования по выборке
+    double kde_max_diff = 0.0;
+    for (int i = 0; i < n_points; i++) {
+        double diff = fabs(pdf_kernel_density(test_points[i], kde) -
+                           pdf_kde_direct(test_points[i], sample, sample_size, kde->kernel, kde->bandwidth));
+        if (diff > kde_max_diff) kde_max_diff = diff;
+    }
+    test_value("KDE: сетка против прямого суммирования", kde_max_diff, 0.0, 1e-4);
+    free_kernel_density(kde);
+    
     // Часть 3: Тест 3.3.2 - Генерация из эмпирического распределения
     printf("\n--- Часть 3: Тест 3.3.2 - Генерация из эмпирического распределения ---\n");
     
     double *new_sample = malloc(sample_size * sizeof(double));
     if (!new_sample) {
         printf("Ошибка выделения памяти!\n");
+        free_empirical_histogram(hist);
         free(sample);
         return;
     }
     
-    for (int i = 0; i < sample_size; i++) {
-        new_sample[i] = generate_empirical(sample, sample_size);
-    }
+    generate_empirical_n(sample, sample_size, new_sample, sample_size, rng_default());
     
     // Сравниваем моменты исходной и новой выборки
     double orig_mean, orig_var, orig_skew, orig_kurt;
@@ -507,17 +873,47 @@ void test_empirical() {
     test_value("Асимметрия", new_skew, orig_skew, 0.2);
     test_value("Эксцесс", new_kurt, orig_kurt, 0.3);
     
+    // Бутстрэп: доверительные интервалы моментов по B повторным выборкам (векторы кратностей)
+    printf("\nБутстрэп моментов исходной выборки:\n");
+    BootstrapOptions boot_options;
+    default_bootstrap_options(&boot_options);
+    boot_options.replicates = 2000;
+    boot_options.seed = (uint64_t)time(NULL);
+    BootstrapResult boot;
+    ThreadPool *pool = create_thread_pool(0);
+    double boot_start = wall_time();
+    if (bootstrap_moments(sample, sample_size, &boot_options, pool, &boot, NULL) == 0) {
+        double boot_time = wall_time() - boot_start;
+        const char *names[BOOT_STATISTICS] = {"Среднее", "Дисперсия", "Асимметрия", "Эксцесс"};
+        double theory[BOOT_STATISTICS];
+        moments_main(0.0, 1.0, 1.0, &theory[BOOT_MEAN], &theory[BOOT_VARIANCE],
+                     &theory[BOOT_SKEWNESS], &theory[BOOT_KURTOSIS]);
+        printf("B = %d, %.0f%%-интервалы, %.3f с\n", boot.replicates, 100 * boot.confidence, boot_time);
+        for (int s = 0; s < BOOT_STATISTICS; s++) {
+            printf("%s: %.4f, смещение %.4f, ст. ошибка %.4f, интервал [%.4f, %.4f], теория %.4f%s\n", names[s],
+                   boot.estimate[s], boot.bias[s], boot.std_error[s], boot.lower[s], boot.upper[s], theory[s],
+                   (theory[s] >= boot.lower[s] && theory[s] <= boot.upper[s]) ? "" : " (вне интервала)");
+        }
+        // Стандартная ошибка среднего известна и без бутстрэпа: s / sqrt(n)
+        double se_mean = sqrt(orig_var / sample_size);
+        test_value("Бутстрэп: ст. ошибка среднего", boot.std_error[BOOT_MEAN], se_mean, 0.1 * se_mean);
+    } else {
+        printf("Ошибка бутстрэпа!\n");
+    }
+    free_thread_pool(pool);
+    
     // Часть 4: Визуальная проверка распределения
     printf("\n--- Часть 4: Визуальная проверка распределения ---\n");
     printf("Для построения графиков используй данные:\n");
     printf("x,Теоретическая,Эмпирическая\n");
     for (double x = -3.0; x <= 3.0; x += 0.5) {
         double theory = pdf_main(x, 0.0, 1.0, 1.0);
-        double empirical = pdf_empirical(x, sample, sample_size);
+        double empirical = pdf_histogram(x, hist);
         printf("%.1f,%.6f,%.6f\n", x, theory, empirical);
     }
     
     // Освобождаем память
+    free_empirical_histogram(hist);
     free(sample);
     free(new_sample);
     
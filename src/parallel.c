@@ -0,0 +1,509 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// --- ПУЛ ПОТОКОВ ---
+
+struct ThreadPool {
+    int size;                  // Число потоков вместе с вызывающим
+    pthread_t *threads;        // Рабочие потоки 1 .. size - 1
+    pthread_mutex_t lock;
+    pthread_cond_t start;      // Сигнал рабочим: появилась новая задача
+    pthread_cond_t done;       // Сигнал вызывающему: все рабочие закончили
+    unsigned long generation;  // Номер текущей задачи (рабочие ждут его изменения)
+    int pending;               // Сколько рабочих еще не закончили текущую задачу
+    int stopping;              // Флаг остановки пула
+    ParallelTask task;
+    void *ctx;
+    SamplerStats *sampler_stats; // Статистика генератора по потокам или NULL
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int worker;
+} WorkerArgs;
+
+static void* worker_main(void *arg) {
+    WorkerArgs args = *(WorkerArgs*)arg;
+    free(arg);
+    ThreadPool *pool = args.pool;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->stopping) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        ParallelTask task = pool->task;
+        void *ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(ctx, args.worker, pool->size);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+int available_cores(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+double wall_time(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+ThreadPool* create_thread_pool(int threads) {
+    if (threads <= 0) {
+        threads = available_cores();
+    }
+
+    ThreadPool *pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->size = threads;
+    pool->threads = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 1; i < threads; i++) {
+        WorkerArgs *args = (WorkerArgs*)malloc(sizeof(WorkerArgs));
+        if (args) {
+            args->pool = pool;
+            args->worker = i;
+        }
+        if (!args || pthread_create(&pool->threads[i], NULL, worker_main, args) != 0) {
+            free(args);
+            // Останавливаем уже запущенные потоки
+            pool->size = i;
+            free_thread_pool(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->size : 1;
+}
+
+void thread_pool_run(ThreadPool *pool, ParallelTask task, void *ctx) {
+    if (pool == NULL || pool->size == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->pending = pool->size - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Вызывающий поток сам выполняет часть с номером 0
+    task(ctx, 0, pool->size);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void free_thread_pool(ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->size; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
+
+// --- ПАРАЛЛЕЛЬНАЯ ГЕНЕРАЦИЯ ---
+
+typedef enum {
+    GEN_MAIN,
+    GEN_MIXTURE,
+    GEN_EMPIRICAL,
+    GEN_SH_DIST,
+    GEN_MIXTURE_K
+} GenerationKind;
+
+typedef struct {
+    GenerationKind kind;
+    double mu, lambda, v;     // GEN_MAIN
+    MixtureParams *params;    // GEN_MIXTURE
+    double *sample;           // GEN_EMPIRICAL
+    int sample_size;
+    const SHDist *dist;       // GEN_SH_DIST
+    const Mixture *mixture;   // GEN_MIXTURE_K
+    double *out;
+    int n;
+    uint64_t seed;
+    SamplerStats *stats;      // По потокам или NULL
+} GenerationJob;
+
+static void generation_task(void *ctx, int worker, int workers) {
+    GenerationJob *job = (GenerationJob*)ctx;
+
+    // Границы куска: равные части, остаток распределяется по первым потокам
+    long long begin = (long long)job->n * worker / workers;
+    long long end = (long long)job->n * (worker + 1) / workers;
+    if (end <= begin) return;
+
+    // Свой независимый поток генератора: worker прыжков от общего seed
+    RngState rng;
+    rng_seed(&rng, job->seed);
+    for (int i = 0; i < worker; i++) {
+        rng_jump(&rng);
+    }
+
+    SamplerStats *previous = NULL;
+    if (job->stats) {
+        previous = attach_sampler_stats(&job->stats[worker]);
+    }
+
+    double *out = job->out + begin;
+    int count = (int)(end - begin);
+    switch (job->kind) {
+        case GEN_MAIN:
+            generate_main_n(job->mu, job->lambda, job->v, out, count, &rng);
+            break;
+        case GEN_MIXTURE:
+            generate_mixture_n(job->params, out, count, &rng);
+            break;
+        case GEN_EMPIRICAL:
+            generate_empirical_n(job->sample, job->sample_size, out, count, &rng);
+            break;
+        case GEN_SH_DIST:
+            generate_sh_dist_n(job->dist, out, count, &rng);
+            break;
+        case GEN_MIXTURE_K:
+            generate_mixture_k_n(job->mixture, out, count, &rng);
+            break;
+    }
+
+    if (job->stats) {
+        attach_sampler_stats(previous);
+    }
+}
+
+int attach_pool_sampler_stats(ThreadPool *pool, SamplerStats *per_worker) {
+    if (pool == NULL) return -1;
+    pool->sampler_stats = per_worker;
+    return 0;
+}
+
+static void run_generation(GenerationJob *job, ThreadPool *pool) {
+    if (job->out == NULL || job->n <= 0) return;
+    job->stats = pool ? pool->sampler_stats : NULL;
+    thread_pool_run(pool, generation_task, job);
+}
+
+void generate_main_parallel(double mu, double lambda, double v, double *out, int n, uint64_t seed, ThreadPool *pool) {
+    GenerationJob job = { GEN_MAIN, mu, lambda, v, NULL, NULL, 0, NULL, NULL, out, n, seed, NULL };
+    run_generation(&job, pool);
+}
+
+void generate_mixture_parallel(MixtureParams *params, double *out, int n, uint64_t seed, ThreadPool *pool) {
+    GenerationJob job = { GEN_MIXTURE, 0, 0, 0, params, NULL, 0, NULL, NULL, out, n, seed, NULL };
+    run_generation(&job, pool);
+}
+
+void generate_empirical_parallel(double *sample, int sample_size, double *out, int n, uint64_t seed, ThreadPool *pool) {
+    GenerationJob job = { GEN_EMPIRICAL, 0, 0, 0, NULL, sample, sample_size, NULL, NULL, out, n, seed, NULL };
+    run_generation(&job, pool);
+}
+
+void generate_sh_dist_parallel(const SHDist *dist, double *out, int n, uint64_t seed, ThreadPool *pool) {
+    GenerationJob job = { GEN_SH_DIST, 0, 0, 0, NULL, NULL, 0, dist, NULL, out, n, seed, NULL };
+    run_generation(&job, pool);
+}
+
+void generate_mixture_k_parallel(const Mixture *mixture, double *out, int n, uint64_t seed, ThreadPool *pool) {
+    GenerationJob job = { GEN_MIXTURE_K, 0, 0, 0, NULL, NULL, 0, NULL, mixture, out, n, seed, NULL };
+    run_generation(&job, pool);
+}
+
+// --- ПАРАЛЛЕЛЬНЫЕ МОМЕНТЫ ---
+
+typedef struct {
+    const double *sample;
+    int sample_size;
+    int superblocks;
+    MomentAccumulator *accs;
+} MomentsJob;
+
+static void moments_task(void *ctx, int worker, int workers) {
+    MomentsJob *job = (MomentsJob*)ctx;
+
+    // Суперблоки этого потока, у каждого свой накопитель accs[b]
+    int begin = (int)((long long)job->superblocks * worker / workers);
+    int end = (int)((long long)job->superblocks * (worker + 1) / workers);
+    for (int b = begin; b < end; b++) {
+        long long offset = (long long)b * MOMENT_SUPERBLOCK;
+        int count = (job->sample_size - offset < MOMENT_SUPERBLOCK) ? (int)(job->sample_size - offset) : MOMENT_SUPERBLOCK;
+        accumulate_moments_blocked(job->sample + offset, count, &job->accs[b]);
+    }
+}
+
+void moments_empirical_parallel(double *sample, int sample_size, ThreadPool *pool,
+                                double *mean, double *variance, double *skewness, double *kurtosis) {
+    int superblocks = (sample_size + MOMENT_SUPERBLOCK - 1) / MOMENT_SUPERBLOCK;
+    if (sample == NULL || sample_size <= 0 || superblocks == 1 || thread_pool_size(pool) == 1) {
+        moments_empirical(sample, sample_size, mean, variance, skewness, kurtosis);
+        return;
+    }
+
+    MomentAccumulator *accs = (MomentAccumulator*)malloc(superblocks * sizeof(MomentAccumulator));
+    if (!accs) {
+        moments_empirical(sample, sample_size, mean, variance, skewness, kurtosis);
+        return;
+    }
+
+    MomentsJob job = { sample, sample_size, superblocks, accs };
+    thread_pool_run(pool, moments_task, &job);
+
+    MomentAccumulator total;
+    merge_moment_accumulators_tree(accs, superblocks, &total);
+    moments_from_accumulator(&total, mean, variance, skewness, kurtosis);
+    free(accs);
+}
+
+// --- ПАРАЛЛЕЛЬНАЯ СОРТИРОВКА ---
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES 6   // 6 * 11 = 66 >= 64 бит
+
+// Беззнаковый ключ с тем же порядком, что у чисел double: у отрицательных инвертируются все биты,
+// у неотрицательных - только знаковый
+static inline uint64_t sort_key(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+}
+
+// Поразрядная сортировка src[0..n); scratch - рабочий массив той же длины,
+// counts - обнуленные RADIX_PASSES * RADIX_BUCKETS счетчиков.
+// Возвращает указатель на тот из двух массивов, где оказался результат
+static double* radix_sort(double *src, double *scratch, int n, int *counts) {
+    static const int shift[RADIX_PASSES] = { 0, 11, 22, 33, 44, 55 };
+
+    // Все гистограммы - за один проход
+    for (int i = 0; i < n; i++) {
+        uint64_t key = sort_key(src[i]);
+        for (int p = 0; p < RADIX_PASSES; p++) {
+            counts[p * RADIX_BUCKETS + ((key >> shift[p]) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+
+    for (int p = 0; p < RADIX_PASSES; p++) {
+        int *count = counts + p * RADIX_BUCKETS;
+        // Разряд, одинаковый у всех значений (частый случай для старших бит), не меняет порядок
+        int trivial = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            if (count[b] == n) trivial = 1;
+            if (count[b] != 0) break;
+        }
+        if (trivial) continue;
+
+        int offset = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            int c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) {
+            scratch[count[(sort_key(src[i]) >> shift[p]) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        double *t = src;
+        src = scratch;
+        scratch = t;
+    }
+    return src;
+}
+
+// Сколько элементов a (из k первых элементов слияния a и b) попадает в результат;
+// при равенстве первыми идут элементы a
+static long long merge_split(const double *a, long long na, const double *b, long long nb, long long k) {
+    long long lo = (k > nb) ? k - nb : 0;
+    long long hi = (k < na) ? k : na;
+    while (lo < hi) {
+        long long i = lo + (hi - lo) / 2;   // Берем i из a и k - i из b
+        if (a[i] <= b[k - i - 1]) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+typedef struct {
+    double *data;        // Исходный массив
+    double *scratch;     // Временный массив
+    int n;
+    int runs;            // Число упорядоченных кусков
+    long long *bounds;   // Границы кусков: bounds[r] .. bounds[r + 1]
+    int *in_scratch;     // Кусок после сортировки лежит во временном массиве
+    int *counts;         // Счетчики поразрядной сортировки, свои у каждого куска
+    const double *src;   // Текущий раунд слияния: откуда
+    double *dst;         // и куда
+} SortJob;
+
+static void sort_runs_task(void *ctx, int worker, int workers) {
+    SortJob *job = (SortJob*)ctx;
+    (void)workers;
+    long long begin = job->bounds[worker], end = job->bounds[worker + 1];
+    double *result = radix_sort(job->data + begin, job->scratch + begin, (int)(end - begin),
+                                job->counts + (size_t)worker * RADIX_PASSES * RADIX_BUCKETS);
+    job->in_scratch[worker] = (result != job->data + begin);
+}
+
+// Все куски - в исходный массив (после сортировки часть из них осталась во временном)
+static void gather_runs_task(void *ctx, int worker, int workers) {
+    SortJob *job = (SortJob*)ctx;
+    (void)workers;
+    if (job->in_scratch[worker]) {
+        long long begin = job->bounds[worker], end = job->bounds[worker + 1];
+        memcpy(job->data + begin, job->scratch + begin, (end - begin) * sizeof(double));
+    }
+}
+
+// Один раунд: куски 2j и 2j + 1 сливаются в один; поток w пишет w-ю часть результата
+static void merge_round_task(void *ctx, int worker, int workers) {
+    SortJob *job = (SortJob*)ctx;
+    long long out_begin = (long long)job->n * worker / workers;
+    long long out_end = (long long)job->n * (worker + 1) / workers;
+
+    for (int r = 0; r < job->runs; r += 2) {
+        long long a_begin = job->bounds[r];
+        long long a_end = job->bounds[r + 1];
+        long long b_end = (r + 1 < job->runs) ? job->bounds[r + 2] : a_end;
+        long long from = (out_begin > a_begin) ? out_begin : a_begin;
+        long long to = (out_end < b_end) ? out_end : b_end;
+        if (from >= to) continue;
+
+        const double *a = job->src + a_begin;
+        const double *b = job->src + a_end;
+        long long na = a_end - a_begin, nb = b_end - a_end;
+        long long i = merge_split(a, na, b, nb, from - a_begin);
+        long long j = (from - a_begin) - i;
+        double *out = job->dst + from;
+        for (long long k = from; k < to; k++) {
+            if (j >= nb || (i < na && a[i] <= b[j])) {
+                *out++ = a[i++];
+            } else {
+                *out++ = b[j++];
+            }
+        }
+    }
+}
+
+static void copy_back_task(void *ctx, int worker, int workers) {
+    SortJob *job = (SortJob*)ctx;
+    long long begin = (long long)job->n * worker / workers;
+    long long end = (long long)job->n * (worker + 1) / workers;
+    memcpy(job->data + begin, job->scratch + begin, (end - begin) * sizeof(double));
+}
+
+int sort_parallel(double *xs, int n, ThreadPool *pool) {
+    if (xs == NULL || n <= 1) {
+        return 0;
+    }
+    int workers = thread_pool_size(pool);
+    if (workers > n) workers = 1;
+
+    SortJob job;
+    memset(&job, 0, sizeof(job));
+    job.data = xs;
+    job.n = n;
+    job.runs = workers;
+    job.scratch = (double*)malloc((size_t)n * sizeof(double));
+    job.bounds = (long long*)malloc((workers + 1) * sizeof(long long));
+    job.in_scratch = (int*)calloc(workers, sizeof(int));
+    job.counts = (int*)calloc((size_t)workers * RADIX_PASSES * RADIX_BUCKETS, sizeof(int));
+    if (!job.scratch || !job.bounds || !job.in_scratch || !job.counts) {
+        free(job.scratch);
+        free(job.bounds);
+        free(job.in_scratch);
+        free(job.counts);
+        return -1;
+    }
+    for (int w = 0; w <= workers; w++) {
+        job.bounds[w] = (long long)n * w / workers;
+    }
+
+    // Куски сортируются каждый своим потоком; при workers == 1 пул не нужен
+    if (workers == 1) {
+        sort_runs_task(&job, 0, 1);
+        gather_runs_task(&job, 0, 1);
+    } else {
+        thread_pool_run(pool, sort_runs_task, &job);
+        thread_pool_run(pool, gather_runs_task, &job);
+    }
+
+    // Попарные слияния, пока не останется один кусок
+    job.src = xs;
+    job.dst = job.scratch;
+    while (job.runs > 1) {
+        thread_pool_run(pool, merge_round_task, &job);
+        int merged = 0;
+        for (int r = 0; r < job.runs; r += 2) {
+            job.bounds[merged++] = job.bounds[r];
+        }
+        job.bounds[merged] = n;
+        job.runs = merged;
+        double *t = (double*)job.src;
+        job.src = job.dst;
+        job.dst = t;
+    }
+    if (job.src != xs) {
+        thread_pool_run(pool, copy_back_task, &job);
+    }
+
+    free(job.scratch);
+    free(job.bounds);
+    free(job.in_scratch);
+    free(job.counts);
+    return 0;
+}
+
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
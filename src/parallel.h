@@ -0,0 +1,151 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "distributions.h"
+
+// --- ПУЛ ПОТОКОВ ---
+// Простой пул на pthreads: задача запускается сразу на всех потоках пула,
+// каждый поток получает свой номер и сам выбирает свою часть работы.
+// Пул создается один раз и переиспользуется между вызовами.
+//
+// Часть работы - непрерывный диапазон единиц (кусков, суперблоков, повторных выборок):
+// поток w из W берет единицы [N w / W, N (w + 1) / W). Каждая единица считается одинаково,
+// каким бы потоком она ни досталась, а частичные результаты объединяются в порядке номеров единиц,
+// поэтому результат не зависит от числа потоков - так устроены моменты и сортировка ниже,
+// E-шаг подгонки (fitting.h), критерии согласия (gof.h) и бутстрэп (bootstrap.h).
+// Исключение - параллельная генерация: там выборка зависит и от числа потоков.
+
+/**
+ * @brief Пул потоков (внутреннее устройство скрыто в parallel.c).
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Задача для пула.
+ * @param ctx Общие данные задачи.
+ * @param worker Номер потока (0 .. workers - 1).
+ * @param workers Общее число потоков.
+ */
+typedef void (*ParallelTask)(void *ctx, int worker, int workers);
+
+/**
+ * @brief Возвращает число доступных процессорных ядер (не меньше 1).
+ */
+int available_cores(void);
+
+/**
+ * @brief Текущее время в секундах (timespec_get) - для замеров производительности.
+ */
+double wall_time(void);
+
+/**
+ * @brief Создает пул потоков.
+ * @param threads Число потоков (<= 0 - по числу ядер). Вызывающий поток считается одним из них.
+ * @return Указатель на пул или NULL при ошибке.
+ */
+ThreadPool* create_thread_pool(int threads);
+
+/**
+ * @brief Возвращает число потоков в пуле (1, если pool == NULL).
+ */
+int thread_pool_size(const ThreadPool *pool);
+
+/**
+ * @brief Выполняет задачу на всех потоках пула и ждет завершения.
+ * @param pool Пул потоков (NULL - задача выполняется в текущем потоке как единственный поток).
+ * @note Вызывающий поток работает как поток с номером 0.
+ *       Один пул нельзя запускать из нескольких потоков одновременно.
+ */
+void thread_pool_run(ThreadPool *pool, ParallelTask task, void *ctx);
+
+/**
+ * @brief Останавливает потоки и освобождает пул.
+ */
+void free_thread_pool(ThreadPool *pool);
+
+// --- ПАРАЛЛЕЛЬНАЯ ГЕНЕРАЦИЯ ---
+// Выходной массив делится на равные непрерывные куски по числу потоков пула.
+// Поток с номером w использует генератор rng_seed(seed), сдвинутый w прыжками rng_jump,
+// поэтому результат однозначно определяется seed и числом потоков.
+
+/**
+ * @brief Подключает статистику генератора по потокам пула к параллельной генерации.
+ * @param pool Пул потоков.
+ * @param per_worker Массив из thread_pool_size(pool) статистик: поток w добавляет свою часть
+ *                   в per_worker[w] (NULL - отключить).
+ * @return 0 при успехе, -1 если pool == NULL (без пула достаточно attach_sampler_stats).
+ * @note Учитываются функции *_parallel этого раздела. Итог по потокам - merge_sampler_stats.
+ */
+int attach_pool_sampler_stats(ThreadPool *pool, SamplerStats *per_worker);
+
+/**
+ * @brief Параллельно заполняет массив значениями основного распределения.
+ * @param mu Параметр сдвига.
+ * @param lambda Параметр масштаба.
+ * @param v Параметр формы.
+ * @param out Массив для результатов (n элементов).
+ * @param n Количество значений.
+ * @param seed Начальное значение генератора.
+ * @param pool Пул потоков (NULL - один поток).
+ */
+void generate_main_parallel(double mu, double lambda, double v, double *out, int n, uint64_t seed, ThreadPool *pool);
+
+/**
+ * @brief Параллельно заполняет массив значениями смеси.
+ */
+void generate_mixture_parallel(MixtureParams *params, double *out, int n, uint64_t seed, ThreadPool *pool);
+
+/**
+ * @brief Параллельно заполняет массив значениями эмпирического распределения (бутстрэп-выборка).
+ * @param sample Исходная выборка.
+ * @param sample_size Размер исходной выборки.
+ */
+void generate_empirical_parallel(double *sample, int sample_size, double *out, int n, uint64_t seed, ThreadPool *pool);
+
+/**
+ * @brief Параллельно заполняет массив значениями подготовленного основного распределения.
+ * @note В отличие от generate_main_parallel, константы распределения не пересчитываются
+ *       при каждом вызове - удобно, когда одно распределение моделируется многократно.
+ */
+void generate_sh_dist_parallel(const SHDist *dist, double *out, int n, uint64_t seed, ThreadPool *pool);
+
+/**
+ * @brief Параллельно заполняет массив значениями смеси из K компонент.
+ */
+void generate_mixture_k_parallel(const Mixture *mixture, double *out, int n, uint64_t seed, ThreadPool *pool);
+
+// --- ПАРАЛЛЕЛЬНЫЕ МОМЕНТЫ ---
+
+/**
+ * @brief Многопоточный аналог moments_empirical.
+ * @param pool Пул потоков (NULL - один поток).
+ * @note Суперблоки (MOMENT_SUPERBLOCK значений) распределяются по потокам, частичные
+ *       результаты объединяются попарно в фиксированном порядке, поэтому результат
+ *       побитово совпадает с moments_empirical при любом числе потоков.
+ */
+void moments_empirical_parallel(double *sample, int sample_size, ThreadPool *pool,
+                                double *mean, double *variance, double *skewness, double *kurtosis);
+
+// --- ПАРАЛЛЕЛЬНАЯ СОРТИРОВКА ---
+
+/**
+ * @brief Сортирует массив по возрастанию несколькими потоками.
+ * @param xs Массив (сортируется на месте).
+ * @param n Количество значений.
+ * @param pool Пул потоков (NULL - один поток).
+ * @return 0 при успехе, -1 при нехватке памяти (массив не меняется).
+ * @note Массив делится на куски по числу потоков; каждый кусок сортируется поразрядно
+ *       (6 проходов по 11 бит, биты double переводятся в беззнаковые ключи того же порядка),
+ *       затем куски сливаются попарно. Каждое слияние делится между всеми потоками
+ *       по равным частям результата (поиск точек разреза бинарным поиском), поэтому
+ *       и последнее слияние идет параллельно. Нужен временный массив из n значений.
+ *       -0.0 ставится перед 0.0, NaN - по краям.
+ */
+int sort_parallel(double *xs, int n, ThreadPool *pool);
+
+/**
+ * @brief Сравнение двух double по возрастанию для qsort (для коротких массивов, где пул не нужен).
+ */
+int compare_doubles(const void *a, const void *b);
+
+#endif
@@ -0,0 +1,395 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "plot_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(PlotFileHeader) == 128, "PlotFileHeader должен занимать 128 байт");
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + PLOT_FILE_ALIGN - 1) / PLOT_FILE_ALIGN * PLOT_FILE_ALIGN;
+}
+
+static char native_byte_order(void) {
+    const uint16_t probe = 1;
+    return (*(const unsigned char*)&probe == 1) ? '<' : '>';
+}
+
+// Дописывает нули до смещения offset
+static int pad_to(FILE *file, uint64_t position, uint64_t offset) {
+    static const char zeros[PLOT_FILE_ALIGN] = {0};
+    return (offset > position && fwrite(zeros, 1, offset - position, file) != offset - position) ? -1 : 0;
+}
+
+static int write_column(FILE *file, const double *values, int64_t count) {
+    return (count > 0 && fwrite(values, sizeof(double), (size_t)count, file) != (size_t)count) ? -1 : 0;
+}
+
+// --- ЗАПИСЬ ---
+
+int save_plot_data_binary(const PlotData *data, const char *filename) {
+    if (data == NULL) return -1;
+
+    char default_name[160];
+    if (filename == NULL) {
+        snprintf(default_name, sizeof(default_name), "data/plot_data_%s.bin", data->title);
+        filename = default_name;
+    }
+
+    int64_t empirical_size = (data->empirical_data && data->empirical_size > 0) ? data->empirical_size : 0;
+
+    PlotFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PLOT_FILE_MAGIC, sizeof(header.magic));
+    header.version = PLOT_FILE_VERSION;
+    header.dtype[0] = native_byte_order();
+    header.dtype[1] = 'f';
+    header.dtype[2] = '8';
+    header.points_count = data->points_count;
+    header.empirical_size = empirical_size;
+    header.x_offset = align_offset(sizeof(PlotFileHeader));
+    header.y_offset = align_offset(header.x_offset + header.points_count * sizeof(double));
+    header.empirical_offset = align_offset(header.y_offset + header.points_count * sizeof(double));
+    // Длинное название обрезается (последний байт остается нулем)
+    size_t title_length = strnlen(data->title, sizeof(data->title));
+    if (title_length > sizeof(header.title) - 1) title_length = sizeof(header.title) - 1;
+    memcpy(header.title, data->title, title_length);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) return -1;
+
+    uint64_t column_bytes = header.points_count * sizeof(double);
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        pad_to(file, sizeof(header), header.x_offset) != 0 ||
+        write_column(file, data->x_values, header.points_count) != 0 ||
+        pad_to(file, header.x_offset + column_bytes, header.y_offset) != 0 ||
+        write_column(file, data->y_values, header.points_count) != 0 ||
+        pad_to(file, header.y_offset + column_bytes, header.empirical_offset) != 0 ||
+        write_column(file, data->empirical_data, empirical_size) != 0) {
+        status = -1;
+    }
+    if (fclose(file) != 0) status = -1;
+
+    if (status == 0 && plot_messages_enabled()) {
+        fprintf(stderr, "Данные сохранены в файл: %s\n", filename);
+    }
+    return status;
+}
+
+// --- ПОТОКОВАЯ ЗАПИСЬ ---
+
+#define WRITER_QUEUE 8
+#define WRITER_MAX_CALL (1 << 30)   // Наибольший размер одного вызова pwrite
+
+typedef struct {
+    const void *data;
+    size_t size;
+    uint64_t offset;
+} WriteJob;
+
+// Фоновая запись: задания pwrite выполняются по порядку отдельным потоком.
+// Вызывающий может переиспользовать буфер, когда выполнено задание с его номером (writer_wait).
+typedef struct {
+    int fd;
+    int threaded;              // 0 - поток не создан, задания выполняются сразу при постановке
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    WriteJob queue[WRITER_QUEUE];
+    long long submitted;       // Поставлено заданий
+    long long completed;       // Выполнено заданий
+    int stopping;
+    int failed;
+} AsyncWriter;
+
+static int write_fully(int fd, const WriteJob *job) {
+    const char *data = (const char*)job->data;
+    size_t left = job->size;
+    uint64_t offset = job->offset;
+    while (left > 0) {
+        size_t portion = (left < WRITER_MAX_CALL) ? left : WRITER_MAX_CALL;
+        ssize_t written = pwrite(fd, data, portion, (off_t)offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return -1;
+        data += written;
+        offset += (uint64_t)written;
+        left -= (size_t)written;
+    }
+    return 0;
+}
+
+static void* writer_main(void *arg) {
+    AsyncWriter *writer = (AsyncWriter*)arg;
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (writer->completed == writer->submitted && !writer->stopping) {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+        if (writer->completed == writer->submitted) break;
+        WriteJob job = writer->queue[writer->completed % WRITER_QUEUE];
+        pthread_mutex_unlock(&writer->lock);
+
+        int status = write_fully(writer->fd, &job);
+
+        pthread_mutex_lock(&writer->lock);
+        if (status != 0) writer->failed = 1;
+        writer->completed++;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+static void writer_start(AsyncWriter *writer, int fd) {
+    memset(writer, 0, sizeof(AsyncWriter));
+    writer->fd = fd;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    writer->threaded = pthread_create(&writer->thread, NULL, writer_main, writer) == 0;
+}
+
+// Ставит задание в очередь и возвращает его номер
+static long long writer_submit(AsyncWriter *writer, const void *data, size_t size, uint64_t offset) {
+    WriteJob job = { data, size, offset };
+    if (!writer->threaded) {
+        if (write_fully(writer->fd, &job) != 0) writer->failed = 1;
+        return ++writer->completed;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->submitted - writer->completed >= WRITER_QUEUE) {
+        pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    writer->queue[writer->submitted % WRITER_QUEUE] = job;
+    long long id = ++writer->submitted;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+    return id;
+}
+
+// Ждет выполнения задания с номером id (и всех предыдущих)
+static void writer_wait(AsyncWriter *writer, long long id) {
+    if (!writer->threaded) return;
+    pthread_mutex_lock(&writer->lock);
+    while (writer->completed < id) {
+        pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// Дожидается всех заданий, останавливает поток; возвращает 0, если все записи удались
+static int writer_finish(AsyncWriter *writer) {
+    if (writer->threaded) {
+        pthread_mutex_lock(&writer->lock);
+        writer->stopping = 1;
+        pthread_cond_broadcast(&writer->changed);
+        pthread_mutex_unlock(&writer->lock);
+        pthread_join(writer->thread, NULL);
+    }
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+    return writer->failed ? -1 : 0;
+}
+
+int stream_plot_data_binary(const char *filename, const char *title, double x_min, double x_max,
+                            int64_t points_count, PlotDensity density, const void *ctx,
+                            const double *sample, int64_t sample_size) {
+    if (filename == NULL || density == NULL || points_count < 2 || sample_size < 0) {
+        return -1;
+    }
+    if (sample == NULL) sample_size = 0;
+
+    PlotFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PLOT_FILE_MAGIC, sizeof(header.magic));
+    header.version = PLOT_FILE_VERSION;
+    header.dtype[0] = native_byte_order();
+    header.dtype[1] = 'f';
+    header.dtype[2] = '8';
+    header.points_count = points_count;
+    header.empirical_size = sample_size;
+    header.x_offset = align_offset(sizeof(PlotFileHeader));
+    header.y_offset = align_offset(header.x_offset + points_count * sizeof(double));
+    header.empirical_offset = align_offset(header.y_offset + points_count * sizeof(double));
+    if (title) {
+        size_t title_length = strlen(title);
+        if (title_length > sizeof(header.title) - 1) title_length = sizeof(header.title) - 1;
+        memcpy(header.title, title, title_length);
+    }
+
+    // Два буфера кривой (x и y подряд): один заполняется, другой в это время записывается
+    double *buffers = (double*)malloc(2 * 2 * PLOT_STREAM_CHUNK * sizeof(double));
+    if (!buffers) return -1;
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(buffers);
+        return -1;
+    }
+    // Файл сразу получает окончательный размер - промежутки выравнивания остаются нулевыми
+    uint64_t file_size = header.empirical_offset + (uint64_t)sample_size * sizeof(double);
+    int status = ftruncate(fd, (off_t)file_size) == 0 ? 0 : -1;
+
+    AsyncWriter writer;
+    writer_start(&writer, fd);
+    writer_submit(&writer, &header, sizeof(header), 0);
+    // Выборка уходит на запись первой и пишется, пока считается кривая
+    if (sample_size > 0) {
+        writer_submit(&writer, sample, (size_t)sample_size * sizeof(double), header.empirical_offset);
+    }
+
+    long long pending[2] = { 0, 0 };   // Номер последнего задания каждого буфера
+    for (int64_t start = 0, chunk = 0; start < points_count && status == 0; start += PLOT_STREAM_CHUNK, chunk++) {
+        int count = (points_count - start < PLOT_STREAM_CHUNK) ? (int)(points_count - start) : PLOT_STREAM_CHUNK;
+        int slot = (int)(chunk & 1);
+        double *xs = buffers + slot * 2 * PLOT_STREAM_CHUNK;
+        double *ys = xs + PLOT_STREAM_CHUNK;
+
+        writer_wait(&writer, pending[slot]);
+        for (int i = 0; i < count; i++) {
+            // Та же формула узлов, что и в generate_plot_data
+            xs[i] = x_min + (x_max - x_min) * (start + i) / (points_count - 1);
+        }
+        density(ctx, xs, ys, count);
+
+        writer_submit(&writer, xs, count * sizeof(double), header.x_offset + start * sizeof(double));
+        pending[slot] = writer_submit(&writer, ys, count * sizeof(double), header.y_offset + start * sizeof(double));
+    }
+
+    if (writer_finish(&writer) != 0) status = -1;
+    if (close(fd) != 0) status = -1;
+    free(buffers);
+
+    if (status == 0 && plot_messages_enabled()) {
+        fprintf(stderr, "Данные сохранены в файл: %s\n", filename);
+    }
+    return status;
+}
+
+static void plot_density_main(const void *ctx, const double *xs, double *ys, int n) {
+    pdf_sh_dist_batch((const SHDist*)ctx, xs, ys, n);
+}
+
+static void plot_density_mixture(const void *ctx, const double *xs, double *ys, int n) {
+    pdf_mixture_batch(xs, ys, n, (MixtureParams*)ctx);
+}
+
+int stream_plot_case(const char *test_case, const MixtureParams *params, int is_mixture,
+                     const double *sample, int sample_size) {
+    return stream_plot_case_grid(test_case, params, is_mixture, NULL, sample, sample_size);
+}
+
+int stream_plot_case_grid(const char *test_case, const MixtureParams *params, int is_mixture,
+                          const PlotGridOptions *options, const double *sample, int sample_size) {
+    if (test_case == NULL || params == NULL) return -1;
+
+    PlotGridOptions defaults;
+    if (options == NULL) {
+        default_plot_grid_options(&defaults);
+        options = &defaults;
+    }
+    if (options->points_count < 2) return -1;
+
+    char filename[160];
+    snprintf(filename, sizeof(filename), "data/plot_data_%s.bin", test_case);
+
+    if (options->adaptive) {
+        // Неравномерную сетку нельзя считать кусками по порядку x: строим ее целиком.
+        // Адаптивной сетке и так нужно на порядок меньше точек, чем равномерной
+        PlotData data;
+        memset(&data, 0, sizeof(data));
+        size_t title_length = strnlen(test_case, sizeof(data.title) - 1);
+        memcpy(data.title, test_case, title_length);
+        data.points_count = options->points_count;
+        data.x_values = (double*)malloc(options->points_count * sizeof(double));
+        data.y_values = (double*)malloc(options->points_count * sizeof(double));
+        data.empirical_data = (double*)sample;
+        data.empirical_size = sample ? sample_size : 0;
+
+        int result = -1;
+        if (data.x_values && data.y_values) {
+            data.points_count = build_plot_grid(params, is_mixture, options, data.x_values, data.y_values);
+            if (data.points_count >= 0) {
+                result = save_plot_data_binary(&data, filename);
+            }
+        }
+        free(data.x_values);
+        free(data.y_values);
+        return result;
+    }
+
+    double x_min, x_max;
+    plot_range_tail(params, is_mixture, options->tail_probability, &x_min, &x_max);
+
+    if (is_mixture) {
+        return stream_plot_data_binary(filename, test_case, x_min, x_max, options->points_count,
+                                       plot_density_mixture, params, sample, sample_size);
+    }
+    SHDist dist;
+    prepare_sh_dist(&dist, params->mu1, params->lambda1, params->v1);
+    return stream_plot_data_binary(filename, test_case, x_min, x_max, options->points_count,
+                                   plot_density_main, &dist, sample, sample_size);
+}
+
+// --- ЧТЕНИЕ ЧЕРЕЗ ОТОБРАЖЕНИЕ В ПАМЯТЬ ---
+
+MappedPlotData* map_plot_data(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(PlotFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // Отображение остается действительным и после закрытия файла
+    if (mapping == MAP_FAILED) return NULL;
+
+    // Проверка формата: сигнатура, версия, тип и то, что все столбцы целиком лежат в файле
+    const PlotFileHeader *header = (const PlotFileHeader*)mapping;
+    int valid = memcmp(header->magic, PLOT_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == PLOT_FILE_VERSION &&
+                header->dtype[0] == native_byte_order() && header->dtype[1] == 'f' && header->dtype[2] == '8' &&
+                header->points_count >= 0 && header->empirical_size >= 0 &&
+                header->x_offset % sizeof(double) == 0 &&
+                header->y_offset % sizeof(double) == 0 &&
+                header->empirical_offset % sizeof(double) == 0 &&
+                header->x_offset <= size && (size - header->x_offset) / sizeof(double) >= (uint64_t)header->points_count &&
+                header->y_offset <= size && (size - header->y_offset) / sizeof(double) >= (uint64_t)header->points_count &&
+                (header->empirical_size == 0 ||
+                 (header->empirical_offset <= size &&
+                  (size - header->empirical_offset) / sizeof(double) >= (uint64_t)header->empirical_size));
+    MappedPlotData *data = valid ? (MappedPlotData*)malloc(sizeof(MappedPlotData)) : NULL;
+    if (!data) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    const char *base = (const char*)mapping;
+    memcpy(data->title, header->title, sizeof(data->title));
+    data->title[sizeof(data->title) - 1] = '\0';
+    data->points_count = header->points_count;
+    data->empirical_size = header->empirical_size;
+    data->x_values = (const double*)(base + header->x_offset);
+    data->y_values = (const double*)(base + header->y_offset);
+    data->empirical_data = header->empirical_size > 0 ? (const double*)(base + header->empirical_offset) : NULL;
+    data->mapping = mapping;
+    data->mapping_size = size;
+    return data;
+}
+
+void unmap_plot_data(MappedPlotData *data) {
+    if (data) {
+        munmap(data->mapping, data->mapping_size);
+        free(data);
+    }
+}
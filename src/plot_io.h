@@ -0,0 +1,119 @@
+#ifndef PLOT_IO_H
+#define PLOT_IO_H
+
+#include <stdint.h>
+
+#include "distributions.h"
+
+// --- ДВОИЧНЫЙ ФОРМАТ ДАННЫХ ГРАФИКОВ ---
+// Файл data/plot_data_<тест>.bin:
+//   заголовок 128 байт (PlotFileHeader),
+//   столбец x (points_count чисел double), столбец y (points_count), выборка (empirical_size).
+// Каждый столбец начинается со смещения, кратного 64 байтам, и записан подряд без разделителей,
+// поэтому файл читается отображением в память: в C - map_plot_data, в Python - numpy.memmap
+// со смещениями из заголовка. Числа хранятся с полной точностью double.
+
+#define PLOT_FILE_MAGIC "SHPLOT\0\0"
+#define PLOT_FILE_VERSION 1
+#define PLOT_FILE_ALIGN 64
+
+/**
+ * @brief Заголовок двоичного файла графика (128 байт).
+ * @note dtype - строка типа в обозначениях numpy: "<f8" (little-endian double) или ">f8".
+ */
+typedef struct {
+    char magic[8];              // PLOT_FILE_MAGIC
+    uint32_t version;           // PLOT_FILE_VERSION
+    char dtype[4];              // "<f8" или ">f8"
+    int64_t points_count;       // Точек теоретической кривой
+    int64_t empirical_size;     // Значений выборки
+    uint64_t x_offset;          // Смещение столбца x от начала файла, байт
+    uint64_t y_offset;          // Смещение столбца y
+    uint64_t empirical_offset;  // Смещение выборки
+    char title[72];             // Название теста (строка с нулем в конце)
+} PlotFileHeader;
+
+/**
+ * @brief Сохраняет данные графика в двоичном формате.
+ * @param data Данные для сохранения.
+ * @param filename Имя файла (NULL - data/plot_data_<title>.bin).
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int save_plot_data_binary(const PlotData *data, const char *filename);
+
+// --- ПОТОКОВАЯ ЗАПИСЬ ---
+// Кривая считается кусками по PLOT_STREAM_CHUNK точек в один из двух буферов, пока фоновый поток
+// записывает предыдущий кусок, поэтому вычисления и ввод-вывод идут одновременно, а память не зависит
+// от числа точек. Выборка записывается прямо из массива вызывающего, без копирования.
+// Получается тот же двоичный формат, что и у save_plot_data_binary.
+
+#define PLOT_STREAM_CHUNK 65536
+
+/**
+ * @brief Плотность в n точках: ys[i] = f(xs[i]).
+ * @param ctx Параметры плотности.
+ */
+typedef void (*PlotDensity)(const void *ctx, const double *xs, double *ys, int n);
+
+/**
+ * @brief Потоково записывает кривую на равномерной сетке и выборку в двоичный файл.
+ * @param filename Имя файла.
+ * @param title Название графика.
+ * @param x_min Левая граница сетки.
+ * @param x_max Правая граница сетки.
+ * @param points_count Число точек сетки (не меньше 2).
+ * @param density Функция плотности.
+ * @param ctx Параметры для density.
+ * @param sample Выборка (может быть NULL). Массив не должен меняться до возврата из функции.
+ * @param sample_size Размер выборки.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int stream_plot_data_binary(const char *filename, const char *title, double x_min, double x_max,
+                            int64_t points_count, PlotDensity density, const void *ctx,
+                            const double *sample, int64_t sample_size);
+
+/**
+ * @brief Потоковый аналог generate_plot_data + save_plot_data_binary для одного теста.
+ * @note Пишет data/plot_data_<test_case>.bin: 10000 точек на отрезке plot_range и выборку.
+ */
+int stream_plot_case(const char *test_case, const MixtureParams *params, int is_mixture,
+                     const double *sample, int sample_size);
+
+/**
+ * @brief То же, что stream_plot_case, но с настраиваемой сеткой кривой.
+ * @param options Настройки сетки (NULL - как в stream_plot_case).
+ * @note Равномерная сетка пишется потоково на отрезке plot_range_tail; адаптивная
+ *       строится в памяти через build_plot_grid и сохраняется save_plot_data_binary.
+ */
+int stream_plot_case_grid(const char *test_case, const MixtureParams *params, int is_mixture,
+                          const PlotGridOptions *options, const double *sample, int sample_size);
+
+/**
+ * @brief Двоичный файл графика, отображенный в память только для чтения.
+ * @note Указатели на столбцы ведут прямо в отображение - данные не копируются
+ *       и подгружаются с диска по мере обращения.
+ */
+typedef struct {
+    char title[72];
+    int64_t points_count;
+    int64_t empirical_size;
+    const double *x_values;
+    const double *y_values;
+    const double *empirical_data;   // NULL, если выборки нет
+    void *mapping;                  // Начало отображения
+    size_t mapping_size;            // Длина отображения, байт
+} MappedPlotData;
+
+/**
+ * @brief Открывает двоичный файл графика через mmap.
+ * @param filename Имя файла.
+ * @return Указатель на структуру или NULL (нет файла, неверный формат, чужой порядок байт).
+ */
+MappedPlotData* map_plot_data(const char *filename);
+
+/**
+ * @brief Закрывает отображение и освобождает структуру.
+ */
+void unmap_plot_data(MappedPlotData *data);
+
+#endif
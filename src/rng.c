@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "rng.h"
+
+#include <math.h>
+#include <pthread.h>
+
+// --- ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ ---
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64 - используется только для заполнения состояния из одного числа
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// --- ИНИЦИАЛИЗАЦИЯ ---
+
+void rng_seed(RngState *rng, uint64_t seed) {
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&x);
+    }
+}
+
+void rng_seed_stream(RngState *rng, uint64_t seed, uint64_t stream) {
+    // Номер потока перемешивается отдельно, чтобы соседние seed и stream
+    // не давали пересекающихся начальных точек splitmix64
+    uint64_t x = stream;
+    uint64_t key = splitmix64(&x);
+    rng_seed(rng, seed ^ key);
+}
+
+// --- ГЕНЕРАЦИЯ ---
+
+uint64_t rng_next(RngState *rng) {
+    uint64_t *s = rng->s;
+    const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+double rng_uniform(RngState *rng) {
+    // Старшие 53 бита -> [0, 1) с шагом 2^-53
+    return (double)(rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+double rng_uniform_open(RngState *rng) {
+    // Середины ячеек сетки 2^-52: (0.5 .. 2^52 - 0.5) * 2^-52
+    return ((double)(rng_next(rng) >> 12) + 0.5) * 0x1.0p-52;
+}
+
+uint64_t rng_bounded(RngState *rng, uint64_t n) {
+    // Отбрасываем "хвост", который не делится на n нацело - так нет смещения к малым числам
+    uint64_t threshold = (0 - n) % n;
+    for (;;) {
+        uint64_t r = rng_next(rng);
+        if (r >= threshold) {
+            return r % n;
+        }
+    }
+}
+
+// --- НОРМАЛЬНОЕ РАСПРЕДЕЛЕНИЕ (ЗИККУРАТ) ---
+// Вариант Doornik (2005): 128 слоев одинаковой площади, x[i] - правые границы слоев,
+// ratio[i] = x[i+1] / x[i] - доля слоя, целиком лежащая под кривой плотности.
+
+#define ZIG_LAYERS 128
+#define ZIG_R 3.442619855899          // Правая граница нижнего слоя (начало хвоста)
+#define ZIG_V 9.91256303526217e-3     // Площадь одного слоя
+
+static double zig_x[ZIG_LAYERS + 1];
+static double zig_ratio[ZIG_LAYERS];
+static pthread_once_t zig_once = PTHREAD_ONCE_INIT;
+
+static void zig_init(void) {
+    double f = exp(-0.5 * ZIG_R * ZIG_R);
+    zig_x[0] = ZIG_V / f; // Нижний слой вместе с хвостом: V / f(R)
+    zig_x[1] = ZIG_R;
+    zig_x[ZIG_LAYERS] = 0.0;
+    for (int i = 2; i < ZIG_LAYERS; i++) {
+        zig_x[i] = sqrt(-2.0 * log(ZIG_V / zig_x[i - 1] + f));
+        f = exp(-0.5 * zig_x[i] * zig_x[i]);
+    }
+    for (int i = 0; i < ZIG_LAYERS; i++) {
+        zig_ratio[i] = zig_x[i + 1] / zig_x[i];
+    }
+}
+
+// Хвост |x| > R (метод Марсальи)
+static double zig_tail(RngState *rng, int negative, uint64_t *draws) {
+    double x, y;
+    do {
+        x = log(rng_uniform_open(rng)) / ZIG_R;
+        y = log(rng_uniform_open(rng));
+        if (draws) *draws += 2;
+    } while (-2.0 * y < x * x);
+    return negative ? x - ZIG_R : ZIG_R - x;
+}
+
+// draws - счетчик слов генератора или NULL (проверки исчезают при встраивании)
+static inline double zig_normal(RngState *rng, uint64_t *draws) {
+    for (;;) {
+        uint64_t bits = rng_next(rng);
+        if (draws) *draws += 1;
+        int i = (int)(bits & 0x7F);                          // Номер слоя - младшие 7 бит
+        double u = 2.0 * ((double)(bits >> 11) * 0x1.0p-53) - 1.0; // Старшие 53 бита -> [-1, 1)
+
+        // Быстрый путь: точка внутри прямоугольника под кривой
+        if (fabs(u) < zig_ratio[i]) {
+            return u * zig_x[i];
+        }
+        if (i == 0) {
+            return zig_tail(rng, u < 0, draws);
+        }
+
+        // Точка в "клине" между прямоугольником и кривой - проверяем по плотности
+        double x = u * zig_x[i];
+        double f0 = exp(-0.5 * (zig_x[i] * zig_x[i] - x * x));
+        double f1 = exp(-0.5 * (zig_x[i + 1] * zig_x[i + 1] - x * x));
+        if (draws) *draws += 1;
+        if (f1 + rng_uniform(rng) * (f0 - f1) < 1.0) {
+            return x;
+        }
+    }
+}
+
+double rng_normal(RngState *rng) {
+    pthread_once(&zig_once, zig_init);
+    return zig_normal(rng, NULL);
+}
+
+double rng_normal_counted(RngState *rng, uint64_t *draws) {
+    pthread_once(&zig_once, zig_init);
+    return zig_normal(rng, draws);
+}
+
+void rng_normal_n(RngState *rng, double *out, int n) {
+    pthread_once(&zig_once, zig_init);
+    for (int i = 0; i < n; i++) {
+        out[i] = zig_normal(rng, NULL);
+    }
+}
+
+// --- НЕЗАВИСИМЫЕ ПОТОКИ ---
+
+void rng_jump(RngState *rng) {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (UINT64_C(1) << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+void rng_split(RngState *parent, RngState *child) {
+    *child = *parent;
+    rng_jump(parent);
+}
+
+// --- ГЕНЕРАТОР ПО УМОЛЧАНИЮ ---
+
+// Фиксированное начальное состояние, чтобы программа без seed_random тоже работала
+static RngState default_state = {{ 0x9E3779B97F4A7C15ULL, 0xBF58476D1CE4E5B9ULL,
+                                   0x94D049BB133111EBULL, 0x2545F4914F6CDD1DULL }};
+
+RngState* rng_default(void) {
+    return &default_state;
+}
+
+double van_der_corput(uint64_t index, double shift) {
+    // Обращение порядка бит: меняем местами половины, затем четверти и т.д.
+    index = (index >> 32) | (index << 32);
+    index = ((index >> 16) & 0x0000FFFF0000FFFFULL) | ((index & 0x0000FFFF0000FFFFULL) << 16);
+    index = ((index >> 8) & 0x00FF00FF00FF00FFULL) | ((index & 0x00FF00FF00FF00FFULL) << 8);
+    index = ((index >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((index & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    index = ((index >> 2) & 0x3333333333333333ULL) | ((index & 0x3333333333333333ULL) << 2);
+    index = ((index >> 1) & 0x5555555555555555ULL) | ((index & 0x5555555555555555ULL) << 1);
+    
+    // Сдвиг прибавляется к номеру ячейки сетки 2^-52 по модулю 2^52: сложение в double
+    // могло округлить u + shift до 1, и после вычитания 1 получался 0
+    uint64_t cell = index >> 12;
+    if (shift != 0.0) {
+        cell += (uint64_t)((shift - floor(shift)) * 0x1.0p52);
+        cell &= (1ULL << 52) - 1;
+    }
+    // Середина ячейки, как в rng_uniform_open - никогда не 0 и не 1
+    return ((double)cell + 0.5) * 0x1.0p-52;
+}
+
+void seed_random(uint64_t seed) {
+    rng_seed(&default_state, seed);
+}
@@ -0,0 +1,114 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// --- ГЕНЕРАТОР ПСЕВДОСЛУЧАЙНЫХ ЧИСЕЛ ---
+// Явное состояние генератора xoshiro256++ вместо глобального rand().
+// Каждый поток (или каждая независимая серия опытов) держит свое состояние,
+// поэтому генераторы не мешают друг другу и прогон можно воспроизвести по seed.
+
+/**
+ * @brief Состояние генератора xoshiro256++ (256 бит).
+ * @note Нулевое состояние недопустимо - всегда инициализируйте через rng_seed или rng_seed_stream.
+ */
+typedef struct {
+    uint64_t s[4];
+} RngState;
+
+/**
+ * @brief Инициализирует генератор по числу seed (через splitmix64).
+ * @param rng Указатель на состояние генератора.
+ * @param seed Начальное значение.
+ */
+void rng_seed(RngState *rng, uint64_t seed);
+
+/**
+ * @brief Инициализирует генератор для потока с номером stream.
+ * @param rng Указатель на состояние генератора.
+ * @param seed Общее начальное значение для всех потоков.
+ * @param stream Номер потока.
+ * @note Разные stream при одном seed дают разные, статистически независимые последовательности.
+ *       Удобно, когда номер потока (реплики, задания) известен заранее.
+ */
+void rng_seed_stream(RngState *rng, uint64_t seed, uint64_t stream);
+
+/**
+ * @brief Возвращает следующие 64 случайных бита.
+ */
+uint64_t rng_next(RngState *rng);
+
+/**
+ * @brief Равномерная величина на [0, 1) с 53 значащими битами.
+ */
+double rng_uniform(RngState *rng);
+
+/**
+ * @brief Равномерная величина на (0, 1) - никогда не равна 0 и 1, безопасна для log().
+ */
+double rng_uniform_open(RngState *rng);
+
+/**
+ * @brief Равномерное целое на [0, n) без смещения (в отличие от rand() % n).
+ * @param n Верхняя граница (n > 0).
+ */
+uint64_t rng_bounded(RngState *rng, uint64_t n);
+
+/**
+ * @brief Стандартная нормальная величина (метод зиккурата, 128 слоев).
+ * @note В ~99% случаев стоит одного вызова rng_next, одного умножения и одного сравнения.
+ *       Таблицы строятся один раз при первом обращении (потокобезопасно).
+ */
+double rng_normal(RngState *rng);
+
+/**
+ * @brief То же, что rng_normal, но добавляет к *draws число использованных слов генератора.
+ * @note Обычно одно слово; клин и хвост зиккурата требуют больше.
+ */
+double rng_normal_counted(RngState *rng, uint64_t *draws);
+
+/**
+ * @brief Заполняет массив n стандартными нормальными величинами.
+ */
+void rng_normal_n(RngState *rng, double *out, int n);
+
+/**
+ * @brief Прыжок на 2^128 шагов вперед.
+ * @note Последовательности до и после прыжка не пересекаются на практике,
+ *       поэтому k прыжков дают k-й независимый поток.
+ */
+void rng_jump(RngState *rng);
+
+/**
+ * @brief Отделяет независимый поток: child получает текущее состояние, parent прыгает вперед.
+ * @param parent Исходный генератор (сдвигается на 2^128 шагов).
+ * @param child Новый генератор.
+ */
+void rng_split(RngState *parent, RngState *child);
+
+/**
+ * @brief Точка квазислучайной последовательности ван дер Корпута (основание 2).
+ * @param index Номер точки.
+ * @param shift Случайный сдвиг по модулю 1 (0 - без сдвига).
+ * @return Число из (0, 1): двоичные разряды index в обратном порядке плюс shift
+ *         (сдвиг округляется вниз до кратного 2^-52).
+ * @note Первые 2^k точек ложатся по одной в каждый из 2^k равных отрезков, поэтому
+ *       вместе с обращением функции распределения (см. InversionTable) дают оценки
+ *       с дисперсией заметно меньше, чем у псевдослучайных чисел. Сдвиг одинаков для всей серии;
+ *       разные случайные сдвиги дают независимые несмещенные серии для оценки погрешности.
+ */
+double van_der_corput(uint64_t index, double shift);
+
+/**
+ * @brief Возвращает генератор по умолчанию, которым пользуются функции без суффикса _r.
+ * @note Этот генератор общий для всей программы и не потокобезопасен -
+ *       в многопоточном коде используйте свои состояния и функции с суффиксом _r.
+ */
+RngState* rng_default(void);
+
+/**
+ * @brief Инициализирует генератор по умолчанию (замена srand).
+ */
+void seed_random(uint64_t seed);
+
+#endif